@@ -1,7 +1,10 @@
+option(CSLIBS_NDT_USE_OMP "Run the parallel loops of cslibs_ndt thread pools in OpenMP parallel regions" OFF)
+
 if(${CSLIBS_NDT_USE_OMP})
     find_package(OpenMP  REQUIRED)
     set(CMAKE_C_FLAGS   "${CMAKE_C_FLAGS} ${OpenMP_C_FLAGS}")
     set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
     set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} ${OpenMP_EXE_LINKER_FLAGS}")
+    add_definitions(-DCSLIBS_NDT_USE_OMP)
     message("[${PROJECT_NAME}]: Compiling with OpenMP!")
 endif()
@@ -0,0 +1,115 @@
+#ifndef CSLIBS_NDT_COMMON_BOUNDED_QUEUE_HPP
+#define CSLIBS_NDT_COMMON_BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace cslibs_ndt {
+namespace common {
+/**
+ * @brief Blocking FIFO with a fixed capacity to connect the stages of a pipeline.
+ *        A full queue blocks the producer, so a slow stage throttles its predecessors
+ *        instead of letting work pile up. After close, pushing fails and popping
+ *        drains the remaining elements.
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+    inline explicit BoundedQueue(const std::size_t capacity) :
+        capacity_(capacity > 0 ? capacity : 1),
+        closed_(false)
+    {
+    }
+
+    /**
+     * @brief Wait for a free slot and append an element.
+     * @return false if the queue was closed, the element is dropped then
+     */
+    inline bool push(const T &t)
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            not_full_.wait(l, [this]() { return closed_ || queue_.size() < capacity_; });
+            if (closed_)
+                return false;
+            queue_.emplace_back(t);
+        }
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Wait for an element and take it from the front.
+     * @return false if the queue is closed and empty
+     */
+    inline bool pop(T &t)
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            not_empty_.wait(l, [this]() { return closed_ || !queue_.empty(); });
+            if (queue_.empty())
+                return false;
+            t = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        not_full_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Take the front element if there is one, does not block.
+     */
+    inline bool tryPop(T &t)
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            if (queue_.empty())
+                return false;
+            t = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        not_full_.notify_one();
+        return true;
+    }
+
+    inline void close()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    inline bool closed() const
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        return closed_;
+    }
+
+    inline std::size_t size() const
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        return queue_.size();
+    }
+
+    inline std::size_t capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    const std::size_t       capacity_;
+    bool                    closed_;
+    std::deque<T>           queue_;
+    mutable std::mutex      mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_BOUNDED_QUEUE_HPP
@@ -0,0 +1,118 @@
+#ifndef CSLIBS_NDT_COMMON_GAUSSIAN_KERNEL_HPP
+#define CSLIBS_NDT_COMMON_GAUSSIAN_KERNEL_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace cslibs_ndt {
+namespace common {
+/**
+ * EXACT       : std::exp, results are bit identical to sampling the distributions directly
+ * APPROXIMATE : exponents below log(GAUSSIAN_CUTOFF), i.e. squared mahalanobis distances
+ *               above 23.03, are rejected as 0 without exponentiation, everything else
+ *               is evaluated by approximateExp with a relative error below 4e-6
+ */
+enum class Kernel { EXACT, APPROXIMATE };
+
+/// the smallest value the approximate kernel does not reject, the same cutoff matching applies to scores
+constexpr double GAUSSIAN_CUTOFF     = 1e-5;
+/// log(GAUSSIAN_CUTOFF)
+constexpr double GAUSSIAN_LOG_CUTOFF = -11.512925464970229;
+
+/**
+ * @brief Branch free exp, x = n ln2 + r with |r| <= ln2 / 2 and exp(x) = 2^n exp(r),
+ *        where exp(r) is a degree 5 polynomial. The relative error is below 4e-6 for
+ *        x in [-708, 709]. Below that range 0 is returned, above infinity and NaN is
+ *        passed on, like std::exp does. There are neither branches nor calls into libm,
+ *        loops over it are vectorized by gcc if floating point comparisons may not trap,
+ *        i.e. with -fno-trapping-math, and 64 bit integer comparisons are available,
+ *        i.e. from SSE4.2 on.
+ *
+ *        Safe with -ffast-math: n is rounded by an integer conversion instead of adding
+ *        and subtracting a large constant, which may be folded, and NaN is detected on the
+ *        bits, since x == x may be folded as well.
+ */
+inline double approximateExp(const double x)
+{
+    static constexpr double        LOG2E    = 1.4426950408889634;
+    static constexpr double        LN2_HI   = 0.693145751953125;
+    static constexpr double        LN2_LO   = 1.4286068203094173e-06;
+    /// keeps the argument of the truncation positive, so that it rounds to the nearest integer
+    static constexpr std::int32_t  BIAS     = 1024;
+    static constexpr std::uint64_t ABS_MASK = 0x7fffffffffffffffull;
+    static constexpr std::uint64_t INF_BITS = 0x7ff0000000000000ull;
+
+    std::uint64_t x_bits;
+    std::memcpy(&x_bits, &x, sizeof(x_bits));
+    const bool nan = (x_bits & ABS_MASK) > INF_BITS;
+
+    /// the exponent bits below must not overflow, NaN is mapped into the range as well
+    double c = x >= -708.0 ? x : -708.0;
+    c = c <= 709.0 ? c : 709.0;
+    c = nan ? 0.0 : c;
+
+    const std::int32_t k = static_cast<std::int32_t>(c * LOG2E + (BIAS + 0.5)) - BIAS;
+    const double n = static_cast<double>(k);
+    const double r = (c - n * LN2_HI) - n * LN2_LO;
+    const double p = 1.0 + r * (1.0 + r * (1.0 / 2.0 + r * (1.0 / 6.0 + r * (1.0 / 24.0 + r * (1.0 / 120.0)))));
+
+    /// 2^n assembled from the exponent bits, n is in [-1021, 1023]
+    const std::uint64_t bits = static_cast<std::uint64_t>(k + 1023) << 52;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+
+    const double value = p * scale;
+    const double low   = x < -708.0 ? 0.0 : value;
+    return nan ? x : (x > 709.0 ? std::numeric_limits<double>::infinity() : low);
+}
+
+/**
+ * @brief exp(exponent) of a gaussian, exponent = -0.5 * squared mahalanobis distance.
+ */
+inline double gaussian(const double exponent,
+                       const Kernel kernel)
+{
+    if (kernel == Kernel::EXACT)
+        return std::exp(exponent);
+
+    /// a select instead of a branch, the rejection is hard to predict
+    const double value = approximateExp(exponent);
+    return exponent < GAUSSIAN_LOG_CUTOFF ? 0.0 : value;
+}
+
+/**
+ * @brief Like gaussian, but values below GAUSSIAN_CUTOFF are rejected before exponentiation
+ *        with either kernel. Only for callers which drop those values anyway, the exact
+ *        kernel then still yields the same results as std::exp.
+ */
+inline double gaussianCutoff(const double exponent,
+                             const Kernel kernel)
+{
+    if (exponent < GAUSSIAN_LOG_CUTOFF)
+        return 0.0;
+    return kernel == Kernel::EXACT ? std::exp(exponent) : approximateExp(exponent);
+}
+
+/**
+ * @brief Non normalized density of a distribution at a point, the exact kernel forwards
+ *        to the distribution itself.
+ */
+template<typename distribution_t, typename point_t>
+inline double sampleNonNormalized(const distribution_t &d,
+                                  const point_t &p,
+                                  const Kernel kernel)
+{
+    if (kernel == Kernel::EXACT)
+        return d.sampleNonNormalized(p);
+    if (!d.valid())
+        return 0.0;
+
+    const auto q = (p.data() - d.getMean()).eval();
+    return gaussian(-0.5 * q.dot(d.getInformationMatrix() * q), kernel);
+}
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_GAUSSIAN_KERNEL_HPP
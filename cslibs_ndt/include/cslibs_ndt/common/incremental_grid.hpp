@@ -0,0 +1,222 @@
+#ifndef CSLIBS_NDT_COMMON_INCREMENTAL_GRID_HPP
+#define CSLIBS_NDT_COMMON_INCREMENTAL_GRID_HPP
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace cslibs_ndt {
+namespace common {
+/**
+ * @brief Bookkeeping of a 2D output grid kept up to date from the dirty bundle record of
+ *        a map, shared by the incremental conversions. The grid is made of square blocks
+ *        of cells, each block belongs to one 2D block index, e.g. a bundle or a column
+ *        of bundles.
+ *
+ *        The grid grows by at least margin blocks, or half its size, at every side where
+ *        it has to grow, so reallocations are amortized. Cells of new blocks are 0.
+ */
+template<typename grid_t>
+class IncrementalGrid
+{
+public:
+    using block_t = std::array<int, 2>;
+
+    /**
+     * @brief The cells [x, x + width) x [y, y + height) of the output changed.
+     */
+    struct Region
+    {
+        std::size_t x           = 0;
+        std::size_t y           = 0;
+        std::size_t width       = 0;
+        std::size_t height      = 0;
+        bool        reallocated = false;    /// the output was replaced, origin and size may differ
+
+        inline bool empty() const
+        {
+            return width == 0 || height == 0;
+        }
+    };
+
+    /**
+     * @param margin - minimum growth of the grid in blocks
+     */
+    inline explicit IncrementalGrid(const std::size_t margin) :
+        margin_(static_cast<int>(margin))
+    {
+    }
+
+    /**
+     * @brief The bundles changed since the previous call. Without a complete record of
+     *        the changes, i.e. on the first call, after a reset or if another consumer
+     *        took over the record, the grid is dropped and all bundles are returned.
+     * @param map     - the map, always the same one
+     * @param changed - the changed bundle indices
+     * @return if all bundles are returned
+     */
+    template<typename map_t>
+    inline bool takeChanges(map_t &map,
+                            std::vector<typename map_t::index_t> &changed)
+    {
+        if (grid_ && map.tracksDirtyBundles(this)) {
+            map.takeDirtyBundles(this, changed);
+            return false;
+        }
+
+        grid_.reset();
+        map.trackDirtyBundles(this);
+        map.getBundleIndices(changed);
+        return true;
+    }
+
+    /**
+     * @brief Add the 3x3 blocks around each block, a changed distribution is shared by
+     *        all of them. The blocks are sorted and unique afterwards.
+     */
+    inline static void dilate(std::vector<block_t> &blocks)
+    {
+        const std::size_t size = blocks.size();
+        blocks.reserve(9 * size);
+        for (std::size_t i = 0 ; i < size ; ++i) {
+            const block_t b = blocks[i];
+            for (int dx = -1 ; dx <= 1 ; ++dx) {
+                for (int dy = -1 ; dy <= 1 ; ++dy) {
+                    if (dx != 0 || dy != 0)
+                        blocks.emplace_back(block_t{{b[0] + dx, b[1] + dy}});
+                }
+            }
+        }
+        std::sort(blocks.begin(), blocks.end());
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    }
+
+    /**
+     * @brief The bounding box [lo, hi] of the blocks.
+     * @return false if there are no blocks
+     */
+    inline static bool bounds(const std::vector<block_t> &blocks,
+                              block_t &lo,
+                              block_t &hi)
+    {
+        lo = {{std::numeric_limits<int>::max(), std::numeric_limits<int>::max()}};
+        hi = {{std::numeric_limits<int>::min(), std::numeric_limits<int>::min()}};
+        for (const block_t &b : blocks) {
+            for (std::size_t i = 0 ; i < 2 ; ++i) {
+                lo[i] = std::min(lo[i], b[i]);
+                hi[i] = std::max(hi[i], b[i]);
+            }
+        }
+        return !blocks.empty();
+    }
+
+    /**
+     * @brief Make the grid cover the blocks [lo, hi], the cells of the previous grid are kept.
+     * @param lo         - lower block, lo > hi gives an empty grid if there is none yet
+     * @param hi         - upper block
+     * @param block_size - cells per block and side
+     * @param resolution - cell size
+     * @param origin     - origin(block) is the pose of the lower corner of a block
+     * @return if the grid was reallocated
+     */
+    template<typename origin_t>
+    inline bool reserve(const block_t &lo,
+                        const block_t &hi,
+                        const int block_size,
+                        const double resolution,
+                        const origin_t &origin)
+    {
+        if (grid_ &&
+                lo[0] >= min_[0] && lo[1] >= min_[1] &&
+                hi[0] <= max_[0] && hi[1] <= max_[1])
+            return false;
+
+        block_t min = lo;
+        block_t max = hi;
+        if (grid_) {
+            for (std::size_t i = 0 ; i < 2 ; ++i) {
+                const int slack = std::max(margin_, (max_[i] - min_[i] + 1) / 2);
+                min[i] = lo[i] < min_[i] ? lo[i] - slack : min_[i];
+                max[i] = hi[i] > max_[i] ? hi[i] + slack : max_[i];
+            }
+        }
+
+        typename grid_t::Ptr grid(new grid_t(origin(min),
+                                             resolution,
+                                             static_cast<std::size_t>((max[1] - min[1] + 1) * block_size),
+                                             static_cast<std::size_t>((max[0] - min[0] + 1) * block_size)));
+        std::fill(grid->getData().begin(), grid->getData().end(), 0);
+
+        if (grid_) {
+            const std::size_t offset_x = static_cast<std::size_t>((min_[0] - min[0]) * block_size);
+            const std::size_t offset_y = static_cast<std::size_t>((min_[1] - min[1]) * block_size);
+            const std::size_t width    = grid_->getWidth();
+            for (std::size_t y = 0 ; y < grid_->getHeight() ; ++y)
+                std::copy(&grid_->at(0, y), &grid_->at(0, y) + width, &grid->at(offset_x, offset_y + y));
+        }
+
+        grid_ = grid;
+        min_  = min;
+        max_  = max;
+        return true;
+    }
+
+    /**
+     * @brief The cells of the blocks [lo, hi], the whole grid if it was reallocated.
+     */
+    inline Region region(const block_t &lo,
+                         const block_t &hi,
+                         const int block_size,
+                         const bool reallocated) const
+    {
+        Region region;
+        region.reallocated = reallocated;
+        if (reallocated) {
+            region.width  = grid_->getWidth();
+            region.height = grid_->getHeight();
+        } else {
+            region.x      = static_cast<std::size_t>((lo[0] - min_[0]) * block_size);
+            region.y      = static_cast<std::size_t>((lo[1] - min_[1]) * block_size);
+            region.width  = static_cast<std::size_t>((hi[0] - lo[0] + 1) * block_size);
+            region.height = static_cast<std::size_t>((hi[1] - lo[1] + 1) * block_size);
+        }
+        return region;
+    }
+
+    /**
+     * @brief The grid, nullptr before the first reserve.
+     */
+    inline const typename grid_t::Ptr& getGrid() const
+    {
+        return grid_;
+    }
+
+    /**
+     * @brief The block at the lower corner of the grid.
+     */
+    inline const block_t& getMin() const
+    {
+        return min_;
+    }
+
+    /**
+     * @brief Drop the grid, the next takeChanges returns all bundles.
+     */
+    inline void reset()
+    {
+        grid_.reset();
+    }
+
+private:
+    const int            margin_;
+
+    typename grid_t::Ptr grid_;
+    block_t              min_;
+    block_t              max_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_INCREMENTAL_GRID_HPP
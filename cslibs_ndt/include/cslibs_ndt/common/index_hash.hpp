@@ -0,0 +1,26 @@
+#ifndef CSLIBS_NDT_COMMON_INDEX_HASH_HPP
+#define CSLIBS_NDT_COMMON_INDEX_HASH_HPP
+
+#include <array>
+#include <functional>
+
+namespace cslibs_ndt {
+namespace common {
+/**
+ * @brief Hash for integer grid indices, to be used with unordered containers.
+ */
+template<std::size_t Dim>
+struct IndexHash
+{
+    inline std::size_t operator()(const std::array<int, Dim> &index) const
+    {
+        std::size_t h = 0;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            h = h * 73856093u ^ std::hash<int>()(index[i]) * 19349663u;
+        return h;
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_INDEX_HASH_HPP
@@ -113,15 +113,24 @@ public:
             return occupancy_;
 
         inverse_model_ = &inverse_model;
-        occupancy_ = distribution_ ?
+        occupancy_ = computeOccupancy(inverse_model);
+        return occupancy_;
+    }
+
+    /**
+     * @brief Compute the occupancy without touching the cached value, thus safe to call
+     *        concurrently.
+     */
+    inline double computeOccupancy(const cslibs_gridmaps::utility::InverseModel &inverse_model) const
+    {
+        return distribution_ ?
                     cslibs_math::common::LogOdds::from(
-                        num_free_ * inverse_model_->getLogOddsFree() +
-                        distribution_->getN() * inverse_model_->getLogOddsOccupied() -
-                        (num_free_ + distribution_->getN()) * inverse_model_->getLogOddsPrior()) :
+                        num_free_ * inverse_model.getLogOddsFree() +
+                        distribution_->getN() * inverse_model.getLogOddsOccupied() -
+                        (num_free_ + distribution_->getN()) * inverse_model.getLogOddsPrior()) :
                     cslibs_math::common::LogOdds::from(
-                        num_free_ * inverse_model_->getLogOddsFree() -
-                        num_free_ * inverse_model_->getLogOddsPrior());
-        return occupancy_;
+                        num_free_ * inverse_model.getLogOddsFree() -
+                        num_free_ * inverse_model.getLogOddsPrior());
     }
 
     inline const distribution_ptr_t &getDistribution() const
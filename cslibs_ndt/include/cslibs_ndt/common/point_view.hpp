@@ -0,0 +1,177 @@
+#ifndef CSLIBS_NDT_COMMON_POINT_VIEW_HPP
+#define CSLIBS_NDT_COMMON_POINT_VIEW_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+namespace cslibs_ndt {
+namespace common {
+/**
+ * @brief Read only view on points stored in an interleaved buffer, e.g. the data of a
+ *        PointCloud2 message. Every point consists of Dim consecutive values of type
+ *        scalar_t at a byte offset within a record of stride bytes. Points are converted
+ *        on access, so the view can be passed as iterator range to insert, match, the
+ *        voxel filter and scorePoses without copying the buffer into a point cloud.
+ *
+ *        The buffer must outlive the view.
+ */
+template<typename point_t, typename scalar_t = float>
+class PointView
+{
+public:
+    using type_t = typename point_t::type_t;
+
+    static constexpr std::size_t DIM = static_cast<std::size_t>(type_t::RowsAtCompileTime);
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = point_t;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = point_t;
+
+        inline const_iterator() = default;
+        inline const_iterator(const std::uint8_t *data,
+                              const std::size_t   stride) :
+            data_(data),
+            stride_(static_cast<difference_type>(stride))
+        {
+        }
+
+        inline point_t operator * () const
+        {
+            /// the buffer may be unaligned, copying avoids misaligned and aliased loads
+            scalar_t values[DIM];
+            std::memcpy(values, data_, sizeof(values));
+
+            type_t p;
+            for (std::size_t i = 0 ; i < DIM ; ++i)
+                p(static_cast<int>(i)) = static_cast<typename type_t::Scalar>(values[i]);
+            return point_t(p);
+        }
+
+        inline point_t operator [] (const difference_type n) const
+        {
+            return *(*this + n);
+        }
+
+        inline const_iterator& operator ++ ()
+        {
+            data_ += stride_;
+            return *this;
+        }
+
+        inline const_iterator operator ++ (int)
+        {
+            const_iterator tmp(*this);
+            data_ += stride_;
+            return tmp;
+        }
+
+        inline const_iterator& operator -- ()
+        {
+            data_ -= stride_;
+            return *this;
+        }
+
+        inline const_iterator operator -- (int)
+        {
+            const_iterator tmp(*this);
+            data_ -= stride_;
+            return tmp;
+        }
+
+        inline const_iterator& operator += (const difference_type n)
+        {
+            data_ += n * stride_;
+            return *this;
+        }
+
+        inline const_iterator& operator -= (const difference_type n)
+        {
+            data_ -= n * stride_;
+            return *this;
+        }
+
+        inline const_iterator operator + (const difference_type n) const
+        {
+            return const_iterator(*this) += n;
+        }
+
+        inline const_iterator operator - (const difference_type n) const
+        {
+            return const_iterator(*this) -= n;
+        }
+
+        inline difference_type operator - (const const_iterator &other) const
+        {
+            return (data_ - other.data_) / stride_;
+        }
+
+        inline bool operator == (const const_iterator &other) const { return data_ == other.data_; }
+        inline bool operator != (const const_iterator &other) const { return data_ != other.data_; }
+        inline bool operator <  (const const_iterator &other) const { return data_ <  other.data_; }
+        inline bool operator >  (const const_iterator &other) const { return data_ >  other.data_; }
+        inline bool operator <= (const const_iterator &other) const { return data_ <= other.data_; }
+        inline bool operator >= (const const_iterator &other) const { return data_ >= other.data_; }
+
+    private:
+        const std::uint8_t *data_   = nullptr;
+        difference_type     stride_ = 0;
+    };
+
+    using iterator = const_iterator;
+
+    /**
+     * @param data   - start of the buffer
+     * @param size   - number of points
+     * @param stride - bytes from one point to the next, 0 for densely packed points
+     * @param offset - byte offset of the first coordinate within a point
+     */
+    inline PointView(const void        *data,
+                     const std::size_t  size,
+                     const std::size_t  stride = 0,
+                     const std::size_t  offset = 0) :
+        data_(static_cast<const std::uint8_t*>(data) + offset),
+        size_(size),
+        stride_(stride > 0 ? stride : DIM * sizeof(scalar_t))
+    {
+    }
+
+    inline const_iterator begin() const
+    {
+        return const_iterator(data_, stride_);
+    }
+
+    inline const_iterator end() const
+    {
+        return const_iterator(data_ + size_ * stride_, stride_);
+    }
+
+    inline point_t operator [] (const std::size_t i) const
+    {
+        return begin()[static_cast<std::ptrdiff_t>(i)];
+    }
+
+    inline std::size_t size() const
+    {
+        return size_;
+    }
+
+    inline bool empty() const
+    {
+        return size_ == 0;
+    }
+
+private:
+    const std::uint8_t *data_;
+    std::size_t         size_;
+    std::size_t         stride_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_POINT_VIEW_HPP
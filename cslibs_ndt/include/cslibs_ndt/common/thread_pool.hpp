@@ -0,0 +1,330 @@
+#ifndef CSLIBS_NDT_COMMON_THREAD_POOL_HPP
+#define CSLIBS_NDT_COMMON_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef CSLIBS_NDT_USE_OMP
+#include <omp.h>
+#endif
+
+namespace cslibs_ndt {
+namespace common {
+/**
+ * SERIAL  : everything runs on the calling thread
+ * THREADS : worker threads of the pool, chunks are claimed dynamically so idle threads
+ *           take over the remaining work of slow ones
+ * OPENMP  : parallel loops run in OpenMP parallel regions, only available if compiled with
+ *           CSLIBS_NDT_USE_OMP, falls back to THREADS otherwise; enqueue runs on the caller
+ */
+enum class Backend { SERIAL, THREADS, OPENMP };
+
+/**
+ * @brief Fixed set of worker threads which are kept alive between calls, so
+ *        that per-iteration parallel loops do not pay for thread creation.
+ *        The calling thread always takes part in parallelFor, which makes
+ *        nested calls from within a worker safe.
+ *
+ *        Everything parallel in the library takes a pool, by default the shared one
+ *        from getDefault. Its size is the core budget of the library, it is taken from
+ *        the environment variable CSLIBS_NDT_NUM_THREADS or set with setDefault.
+ */
+class ThreadPool
+{
+public:
+    using Ptr = std::shared_ptr<ThreadPool>;
+
+    /**
+     * @brief Create a pool.
+     * @param concurrency - the number of threads working on a parallel loop,
+     *                      including the caller; 0 selects the hardware concurrency
+     * @param backend     - what runs the parallel loops
+     */
+    inline explicit ThreadPool(const std::size_t concurrency = 0,
+                               const Backend backend = defaultBackend()) :
+        stop_(false),
+        backend_(backend),
+        concurrency_(1)
+    {
+#ifndef CSLIBS_NDT_USE_OMP
+        if (backend_ == Backend::OPENMP)
+            backend_ = Backend::THREADS;
+#endif
+        if (backend_ == Backend::SERIAL)
+            return;
+
+        concurrency_ = concurrency == 0 ?
+                    std::max(1u, std::thread::hardware_concurrency()) : concurrency;
+        if (backend_ == Backend::THREADS) {
+            for (std::size_t i = 1 ; i < concurrency_ ; ++i)
+                workers_.emplace_back([this]() { loop(); });
+        }
+    }
+
+    inline virtual ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            stop_ = true;
+        }
+        notify_.notify_all();
+        for (std::thread &w : workers_)
+            w.join();
+    }
+
+    ThreadPool(const ThreadPool &other) = delete;
+    ThreadPool& operator = (const ThreadPool &other) = delete;
+
+    /**
+     * @brief The number of threads which can work on one parallel loop.
+     *        Per-thread accumulators passed to parallelFor should have this size.
+     */
+    inline std::size_t concurrency() const
+    {
+        return concurrency_;
+    }
+
+    inline Backend backend() const
+    {
+        return backend_;
+    }
+
+    /**
+     * @brief False if enqueue runs tasks on the caller, i.e. for SERIAL, OPENMP and single threaded pools.
+     */
+    inline bool hasWorkers() const
+    {
+        return !workers_.empty();
+    }
+
+    /**
+     * @brief Split [begin, end) into chunks of at most grain elements and process them
+     *        in parallel. Blocks until all chunks are done.
+     * @param fn - called as fn(slot, chunk_begin, chunk_end), slot < concurrency() is unique
+     *             per participating thread for the duration of the call
+     */
+    template<typename Fn>
+    inline void parallelFor(const std::size_t begin,
+                            const std::size_t end,
+                            const std::size_t grain,
+                            const Fn &fn)
+    {
+        if (end <= begin)
+            return;
+
+        const std::size_t g = std::max<std::size_t>(1, grain);
+        const std::size_t chunks = (end - begin + g - 1) / g;
+#ifdef CSLIBS_NDT_USE_OMP
+        if (backend_ == Backend::OPENMP && chunks > 1) {
+            parallelForOpenMP(begin, end, g, chunks, fn);
+            return;
+        }
+#endif
+        const std::size_t helpers = std::min(workers_.size(), chunks - 1);
+        if (helpers == 0) {
+            fn(std::size_t(0), begin, end);
+            return;
+        }
+
+        /// state is shared with helpers which might only start after the caller returned
+        std::shared_ptr<Loop> loop(new Loop(begin, end, g));
+        auto work = [loop, &fn](const std::size_t slot) {
+            std::size_t b;
+            while ((b = loop->next.fetch_add(loop->grain)) < loop->end) {
+                try {
+                    fn(slot, b, std::min(b + loop->grain, loop->end));
+                } catch (...) {
+                    std::unique_lock<std::mutex> l(loop->mutex);
+                    if (!loop->exception)
+                        loop->exception = std::current_exception();
+                }
+            }
+        };
+
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            for (std::size_t i = 1 ; i <= helpers ; ++i) {
+                tasks_.emplace_back([loop, work, i]() {
+                    {
+                        std::unique_lock<std::mutex> l(loop->mutex);
+                        if (loop->closed)
+                            return;
+                        ++loop->active;
+                    }
+                    work(i);
+                    {
+                        std::unique_lock<std::mutex> l(loop->mutex);
+                        --loop->active;
+                    }
+                    loop->done.notify_all();
+                });
+            }
+        }
+        notify_.notify_all();
+
+        work(0);
+
+        /// helpers which have not started yet will not touch fn anymore
+        std::unique_lock<std::mutex> l(loop->mutex);
+        loop->closed = true;
+        loop->done.wait(l, [&loop]() { return loop->active == 0; });
+        if (loop->exception)
+            std::rethrow_exception(loop->exception);
+    }
+
+    /**
+     * @brief Run a single task asynchronously on one of the workers.
+     *        Falls back to the caller if the pool has no workers.
+     */
+    inline void enqueue(const std::function<void()> &task)
+    {
+        if (workers_.empty()) {
+            task();
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            tasks_.emplace_back(task);
+        }
+        notify_.notify_one();
+    }
+
+    /**
+     * @brief A lazily created pool shared by everyone not bringing their own.
+     */
+    inline static Ptr getDefault()
+    {
+        std::unique_lock<std::mutex> l(defaultMutex());
+        Ptr &pool = defaultPool();
+        if (!pool)
+            pool.reset(new ThreadPool(defaultConcurrency()));
+        return pool;
+    }
+
+    /**
+     * @brief Replace the shared pool, e.g. to limit the library to a core budget.
+     *        Calls which already hold the previous pool finish on it.
+     * @param pool - the new shared pool, null restores the lazily created one
+     */
+    inline static void setDefault(const Ptr &pool)
+    {
+        std::unique_lock<std::mutex> l(defaultMutex());
+        defaultPool() = pool;
+    }
+
+private:
+    struct Loop {
+        Loop(const std::size_t b, const std::size_t e, const std::size_t g) :
+            next(b), end(e), grain(g), active(0), closed(false)
+        {
+        }
+
+        std::atomic<std::size_t> next;
+        const std::size_t        end;
+        const std::size_t        grain;
+        std::size_t              active;
+        bool                     closed;
+        std::exception_ptr       exception;
+        std::mutex               mutex;
+        std::condition_variable  done;
+    };
+
+    std::vector<std::thread>            workers_;
+    std::deque<std::function<void()>>   tasks_;
+    std::mutex                          mutex_;
+    std::condition_variable             notify_;
+    bool                                stop_;
+    Backend                             backend_;
+    std::size_t                         concurrency_;
+
+    inline static Backend defaultBackend()
+    {
+#ifdef CSLIBS_NDT_USE_OMP
+        return Backend::OPENMP;
+#else
+        return Backend::THREADS;
+#endif
+    }
+
+    /**
+     * @brief CSLIBS_NDT_NUM_THREADS if set to a positive number, 0 for the hardware concurrency.
+     */
+    inline static std::size_t defaultConcurrency()
+    {
+        const char *env = std::getenv("CSLIBS_NDT_NUM_THREADS");
+        if (!env)
+            return 0;
+        const long n = std::strtol(env, nullptr, 10);
+        return n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+
+    inline static std::mutex& defaultMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    inline static Ptr& defaultPool()
+    {
+        static Ptr pool;
+        return pool;
+    }
+
+#ifdef CSLIBS_NDT_USE_OMP
+    template<typename Fn>
+    inline void parallelForOpenMP(const std::size_t begin,
+                                  const std::size_t end,
+                                  const std::size_t grain,
+                                  const std::size_t chunks,
+                                  const Fn &fn)
+    {
+        /// exceptions must not leave the parallel region
+        std::exception_ptr exception;
+        std::mutex         mutex;
+        const int threads = static_cast<int>(std::min(concurrency_, chunks));
+        const long n      = static_cast<long>(chunks);
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+        for (long c = 0 ; c < n ; ++c) {
+            const std::size_t b = begin + static_cast<std::size_t>(c) * grain;
+            try {
+                fn(static_cast<std::size_t>(omp_get_thread_num()), b, std::min(b + grain, end));
+            } catch (...) {
+                std::unique_lock<std::mutex> l(mutex);
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        }
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+#endif
+
+    inline void loop()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> l(mutex_);
+                notify_.wait(l, [this]() { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_COMMON_THREAD_POOL_HPP
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace cslibs_ndt {
+namespace matching {
+/**
+ * @brief Stops a running match from the outside. A match checks the token before every
+ *        gradient pass and returns the best transform found so far with
+ *        Termination::DEADLINE once it is cancelled or its deadline has passed.
+ *        Cancelling is thread safe, a token can be shared by several matches.
+ */
+class CancellationToken
+{
+public:
+    using Ptr        = std::shared_ptr<CancellationToken>;
+    using clock_t    = std::chrono::steady_clock;
+    using time_t     = clock_t::time_point;
+    using duration_t = clock_t::duration;
+
+    inline explicit CancellationToken(const time_t &deadline = time_t::max()) :
+        cancelled_(false),
+        deadline_(deadline)
+    {
+    }
+
+    inline static Ptr create(const time_t &deadline = time_t::max())
+    {
+        return Ptr(new CancellationToken(deadline));
+    }
+
+    /**
+     * @brief A token which expires the given time from now.
+     */
+    template<typename rep_t, typename period_t>
+    inline static Ptr createTimeout(const std::chrono::duration<rep_t, period_t> &timeout)
+    {
+        return create(clock_t::now() + std::chrono::duration_cast<duration_t>(timeout));
+    }
+
+    inline void cancel()
+    {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    inline bool cancelled() const
+    {
+        return cancelled_.load(std::memory_order_relaxed);
+    }
+
+    inline const time_t& deadline() const
+    {
+        return deadline_;
+    }
+
+    /**
+     * @brief True if the token was cancelled or the deadline has passed. The clock is
+     *        only read if a deadline is set.
+     */
+    inline bool expired() const
+    {
+        return cancelled() || (deadline_ != time_t::max() && clock_t::now() >= deadline_);
+    }
+
+private:
+    std::atomic<bool> cancelled_;
+    const time_t      deadline_;
+};
+}
+}
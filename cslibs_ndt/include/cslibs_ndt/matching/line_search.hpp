@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace impl {
+namespace more_thuente {
+/// cubic interpolation of two points given values and derivatives
+inline double cubicMinimizer(const double a_l, const double f_l, const double g_l,
+                             const double a_t, const double f_t, const double g_t)
+{
+    const double z = 3.0 * (f_t - f_l) / (a_t - a_l) - g_t - g_l;
+    const double w = std::sqrt(std::max(0.0, z * z - g_t * g_l));
+    return a_l + (a_t - a_l) * (w - g_l - z) / (g_t - g_l + 2.0 * w);
+}
+
+/**
+ * @brief Trial value selection, More and Thuente (1994), section 4.
+ *        a_l is the best step so far, a_u the other end of the interval and a_t the
+ *        last trial which has not been merged into the interval yet.
+ */
+inline double selectTrialValue(const double a_l, const double f_l, const double g_l,
+                               const double a_u, const double f_u, const double g_u,
+                               const double a_t, const double f_t, const double g_t,
+                               const double a_min, const double a_max,
+                               bool &bracketed)
+{
+    /// case 1: higher function value, the minimum is bracketed
+    if (f_t > f_l) {
+        bracketed = true;
+        const double a_c = cubicMinimizer(a_l, f_l, g_l, a_t, f_t, g_t);
+        const double a_q = a_l + 0.5 * g_l / ((f_l - f_t) / (a_t - a_l) + g_l) * (a_t - a_l);
+        return std::fabs(a_c - a_l) < std::fabs(a_q - a_l) ? a_c : a_c + 0.5 * (a_q - a_c);
+    }
+
+    const double a_s = a_t + g_t / (g_t - g_l) * (a_l - a_t);
+    /// case 2: derivatives have opposite sign, the minimum is bracketed
+    if (g_t * g_l < 0.0) {
+        bracketed = true;
+        const double a_c = cubicMinimizer(a_l, f_l, g_l, a_t, f_t, g_t);
+        return std::fabs(a_c - a_t) >= std::fabs(a_s - a_t) ? a_c : a_s;
+    }
+
+    /// case 3: derivative decreases in magnitude
+    if (std::fabs(g_t) <= std::fabs(g_l)) {
+        double a_c = cubicMinimizer(a_l, f_l, g_l, a_t, f_t, g_t);
+        if (!std::isfinite(a_c))
+            a_c = a_t > a_l ? a_max : a_min;
+        if (bracketed) {
+            const double a_n = std::fabs(a_c - a_t) < std::fabs(a_s - a_t) ? a_c : a_s;
+            return a_t > a_l ? std::min(a_t + 0.66 * (a_u - a_t), a_n)
+                             : std::max(a_t + 0.66 * (a_u - a_t), a_n);
+        }
+        const double a_n = std::fabs(a_c - a_t) > std::fabs(a_s - a_t) ? a_c : a_s;
+        return a_t > a_l ? std::min(a_max, a_n) : std::max(a_min, a_n);
+    }
+
+    /// case 4: derivative does not decrease in magnitude
+    if (bracketed)
+        return cubicMinimizer(a_u, f_u, g_u, a_t, f_t, g_t);
+    return a_t > a_l ? a_max : a_min;
+}
+
+/**
+ * @brief Interval update, More and Thuente (1994), section 2.
+ * @return true if the interval has collapsed
+ */
+inline bool updateInterval(double &a_l, double &f_l, double &g_l,
+                           double &a_u, double &f_u, double &g_u,
+                           const double a_t, const double f_t, const double g_t)
+{
+    if (f_t > f_l) {
+        a_u = a_t; f_u = f_t; g_u = g_t;
+        return false;
+    }
+    if (g_t * (a_l - a_t) > 0.0) {
+        a_l = a_t; f_l = f_t; g_l = g_t;
+        return false;
+    }
+    if (g_t * (a_l - a_t) < 0.0) {
+        a_u = a_l; f_u = f_l; g_u = g_l;
+        a_l = a_t; f_l = f_t; g_l = g_t;
+        return false;
+    }
+    return true;
+}
+}
+
+/**
+ * @brief More-Thuente line search for a step length satisfying the strong Wolfe
+ *        conditions, as used by Magnusson for NDT. Minimizes phi along a descent
+ *        direction, i.e. d_phi_0 has to be negative.
+ * @param phi             - called as phi(step, value, derivative), evaluates the objective
+ *                          and its directional derivative at the given step length
+ * @param phi_0           - objective at step length 0
+ * @param d_phi_0         - directional derivative at step length 0
+ * @param step_init       - first trial step length
+ * @param step_min        - lower bound on the step length
+ * @param step_max        - upper bound on the step length
+ * @param max_iterations  - maximum number of trial evaluations after the first one
+ * @param mu              - sufficient decrease constant
+ * @param nu              - curvature constant
+ * @return the accepted step length, which is always the last one phi was evaluated at
+ */
+template<typename function_t>
+inline double moreThuente(const function_t &phi,
+                          const double phi_0,
+                          const double d_phi_0,
+                          const double step_init,
+                          const double step_min,
+                          const double step_max,
+                          const std::size_t max_iterations,
+                          const double mu,
+                          const double nu)
+{
+    /// the auxiliary function psi is used until a trial with psi <= 0 and phi' >= 0 is found
+    const auto psi   = [phi_0, d_phi_0, mu](const double a, const double f) { return f - phi_0 - mu * d_phi_0 * a; };
+    const auto d_psi = [d_phi_0, mu](const double g) { return g - mu * d_phi_0; };
+
+    double a_l = 0.0, f_l = 0.0, g_l = d_psi(d_phi_0);
+    double a_u = 0.0, f_u = 0.0, g_u = g_l;
+
+    bool auxiliary = true;
+    bool bracketed = false;
+    double width   = step_max - step_min;
+    double width_1 = 2.0 * width;
+
+    double a_t = std::min(std::max(step_init, step_min), step_max);
+    double phi_t, d_phi_t;
+    phi(a_t, phi_t, d_phi_t);
+
+    for (std::size_t iteration = 0 ; iteration < max_iterations ; ++iteration) {
+        const double psi_t = psi(a_t, phi_t);
+        if (psi_t <= 0.0 && std::fabs(d_phi_t) <= -nu * d_phi_0)
+            break;
+        if (bracketed && (a_t <= std::min(a_l, a_u) || a_t >= std::max(a_l, a_u)))
+            break;
+        if (bracketed && std::fabs(a_u - a_l) <= 1e-10 * std::max(a_l, a_u))
+            break;
+
+        if (auxiliary && psi_t <= 0.0 && d_phi_t >= 0.0) {
+            auxiliary = false;
+            f_l += phi_0 + mu * d_phi_0 * a_l;
+            g_l += mu * d_phi_0;
+            f_u += phi_0 + mu * d_phi_0 * a_u;
+            g_u += mu * d_phi_0;
+        }
+
+        /// bounds of the next trial, extrapolate if the minimum is not bracketed yet
+        const double a_min = bracketed ? std::min(a_l, a_u) : a_t;
+        const double a_max = bracketed ? std::max(a_l, a_u) : a_t + 4.0 * (a_t - a_l);
+
+        const double f_t = auxiliary ? psi_t          : phi_t;
+        const double g_t = auxiliary ? d_psi(d_phi_t) : d_phi_t;
+        double a_n = more_thuente::selectTrialValue(a_l, f_l, g_l, a_u, f_u, g_u, a_t, f_t, g_t,
+                                                    a_min, a_max, bracketed);
+        if (more_thuente::updateInterval(a_l, f_l, g_l, a_u, f_u, g_u, a_t, f_t, g_t))
+            break;
+
+        /// bisect if the interval does not shrink fast enough
+        if (bracketed) {
+            if (std::fabs(a_u - a_l) >= 0.66 * width_1)
+                a_n = a_l + 0.5 * (a_u - a_l);
+            width_1 = width;
+            width   = std::fabs(a_u - a_l);
+        }
+
+        if (!std::isfinite(a_n))
+            a_n = bracketed ? a_l + 0.5 * (a_u - a_l) : a_max;
+        a_n = std::min(std::max(a_n, step_min), step_max);
+        if (a_n == a_t)
+            break;
+
+        a_t = a_n;
+        phi(a_t, phi_t, d_phi_t);
+    }
+    return a_t;
+}
+}
+}
+}
@@ -2,38 +2,206 @@
 
 #include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
 #include <cslibs_ndt/matching/match_traits.hpp>
+#include <cslibs_ndt/matching/cancellation_token.hpp>
 #include <cslibs_ndt/matching/parameter.hpp>
 #include <cslibs_ndt/matching/result.hpp>
+#include <cslibs_ndt/matching/line_search.hpp>
+#include <cslibs_ndt/matching/solver.hpp>
+#include <cslibs_ndt/matching/voxel_filter.hpp>
 
 namespace cslibs_ndt {
 namespace matching {
 
-template<typename iterator_t, typename ndt_t, typename traits_t = MatchTraits<ndt_t>>
-auto match(const iterator_t& points_begin,
-           const iterator_t& points_end,
-           const ndt_t& map,
-           const typename traits_t::parameter_t& param,
-           const typename ndt_t::transform_t& initial_transform)
--> Result<typename ndt_t::transform_t>
+namespace impl {
+/**
+ * @brief Newton iterations with a More-Thuente line search along the newton direction.
+ *        Only the first trial of every search computes the hessian, further trials
+ *        accumulate score and gradient only. If the first trial is accepted, its
+ *        evaluation is reused for the next newton step.
+ */
+template<typename traits_t, typename evaluate_t>
+auto optimizeMoreThuente(const evaluate_t& evaluate,
+                         const Parameter& param,
+                         const typename traits_t::transform_t& initial_transform,
+                         const CancellationToken::Ptr& cancellation = CancellationToken::Ptr())
+-> Result<typename traits_t::transform_t>
 {
     static constexpr int DIMS = traits_t::LINEAR_DIMS + traits_t::ANGULAR_DIMS;
-    using point_t             = typename ndt_t::point_t;
-    using transform_t         = typename ndt_t::transform_t;
+    using transform_t         = typename traits_t::transform_t;
     using result_t            = Result<transform_t>;
 
-    using JacobianCompute = typename traits_t::Jacobian;
-    using HessianCompute  = typename traits_t::Hessian;
-
     using linear_t      = Eigen::Matrix<double, traits_t::LINEAR_DIMS, 1>;
     using angular_t     = Eigen::Matrix<double, traits_t::ANGULAR_DIMS, 1>;
     using gradient_t    = Eigen::Matrix<double, DIMS, 1>;
     using hessian_t     = Eigen::Matrix<double, DIMS, DIMS>;
 
-    // todo: pre transform points, should be externalized or made completely optional...
-    std::vector<point_t> points_prime;
-    points_prime.reserve(std::distance(points_begin, points_end));
-    std::transform(points_begin, points_end, std::back_inserter(points_prime),
-                   [&](const point_t& point) { return initial_transform * point; });
+    std::size_t iteration = 0;
+
+    linear_t  linear  = linear_t::Zero();
+    angular_t angular = angular_t::Zero();
+
+    // state at the current parameters
+    double      score = 0.0;
+    gradient_t  g     = gradient_t::Zero();
+    hessian_t   h     = hessian_t::Zero();
+    bool        has_hessian = false;
+
+    // state of the last line search trial
+    double      trial_score = 0.0;
+    gradient_t  trial_g     = gradient_t::Zero();
+    hessian_t   trial_h     = hessian_t::Zero();
+    std::size_t trials      = 0;
+
+    // best trial of the current line search
+    double      best_step  = 0.0;
+    double      best_score = 0.0;
+    gradient_t  best_g     = gradient_t::Zero();
+    std::size_t best_trial = 0;
+
+    const double step_min = 0.5 * std::min(param.translationEpsilon(), param.rotationEpsilon());
+
+    /// only improving steps are accepted, linear and angular thus always hold the best parameters
+    const auto terminate = [&](Termination reason)
+    {
+        return result_t{
+            score,
+                    iteration,
+                    traits_t::makeTransform(linear, angular) * initial_transform,
+                    reason };
+    };
+
+    for (iteration = 0; iteration < param.maxIterations(); ++iteration)
+    {
+        if (cancellation && cancellation->expired())
+            return terminate(Termination::DEADLINE);
+
+        if (!has_hessian)
+        {
+            score = 0.0;
+            g.setZero();
+            h.setZero();
+            evaluate(linear, angular, score, g, &h);
+        }
+
+        /// the search controls the step length, damping only has to make the system definite
+        gradient_t dp;
+        double damping = param.damping();
+        solve(h, g, param, damping, dp);
+
+        /// phi(a) = -score(x + a * d), the newton direction is only a descent direction if h is negative definite
+        double d_phi_0 = g.dot(dp);
+        if (!std::isfinite(d_phi_0))
+            return terminate(Termination::NONE);
+        if (d_phi_0 > 0.0)
+        {
+            dp = -dp;
+            d_phi_0 = -d_phi_0;
+        }
+
+        const double dp_norm = dp.norm();
+        if (dp_norm == 0.0)
+            return terminate(Termination::DELTA_EPSILON);
+
+        const gradient_t d = dp / dp_norm;
+        d_phi_0 /= dp_norm;
+
+        trials     = 0;
+        best_step  = 0.0;
+        best_score = score;
+        const auto phi = [&](const double a, double& value, double& derivative)
+        {
+            const linear_t  trial_linear  = linear  + a * d.template head<traits_t::LINEAR_DIMS>();
+            const angular_t trial_angular = angular + a * d.template tail<traits_t::ANGULAR_DIMS>();
+
+            trial_score = 0.0;
+            trial_g.setZero();
+            if (trials == 0)
+            {
+                trial_h.setZero();
+                evaluate(trial_linear, trial_angular, trial_score, trial_g, &trial_h);
+            }
+            else
+            {
+                evaluate(trial_linear, trial_angular, trial_score, trial_g, static_cast<hessian_t*>(nullptr));
+            }
+            ++trials;
+
+            if (trial_score > best_score)
+            {
+                best_step  = a;
+                best_score = trial_score;
+                best_g     = trial_g;
+                best_trial = trials;
+            }
+
+            value      = -trial_score;
+            derivative = trial_g.dot(d);
+        };
+
+        const double step_max  = param.maxStepLength();
+        const double step_init = std::min(dp_norm, step_max);
+        moreThuente(phi, -score, d_phi_0,
+                    step_init, step_min, step_max,
+                    param.maxLineSearchIterations(),
+                    param.sufficientDecrease(),
+                    param.curvature());
+
+        /// the search can end on a worse trial if the objective is not smooth, e.g. at cell borders,
+        /// the best trial is taken instead, without any improving trial the parameters are kept
+        if (best_step == 0.0)
+            return terminate(Termination::MAX_STEP_READJUSTMENTS);
+
+        const gradient_t delta = best_step * d;
+        linear  += delta.template head<traits_t::LINEAR_DIMS>();
+        angular += delta.template tail<traits_t::ANGULAR_DIMS>();
+
+        score = best_score;
+        g     = best_g;
+        has_hessian = best_trial == 1;
+        if (has_hessian)
+            h = trial_h;
+
+        if ((delta.template head<traits_t::LINEAR_DIMS>().array().abs() < param.translationEpsilon()).all()
+                && (delta.template tail<traits_t::ANGULAR_DIMS>().array().abs() < param.rotationEpsilon()).all())
+        {
+            ++iteration;
+            return terminate(Termination::DELTA_EPSILON);
+        }
+    }
+
+    return terminate(Termination::MAX_ITERATIONS);
+}
+
+/**
+ * @brief Newton iterations shared by all matching front ends.
+ * @param evaluate - called as evaluate(linear, angular, score, g, h), has to accumulate
+ *                   score, gradient and hessian of the objective at the given parameters;
+ *                   h is a pointer which is null if only score and gradient are required
+ * @param param    - the optimizer parameters, lineSearch() selects the step size control;
+ *                   without line search a rejected step is shortened by alpha() and the best
+ *                   parameters are evaluated again with FULL_PIV_LU, while DAMPED_LDLT raises
+ *                   the damping and retries from the derivatives at the best parameters
+ * @param initial_transform - the transform the parameters are relative to
+ * @param cancellation - checked before every evaluation, optional
+ */
+template<typename traits_t, typename evaluate_t>
+auto optimize(const evaluate_t& evaluate,
+              const Parameter& param,
+              const typename traits_t::transform_t& initial_transform,
+              const CancellationToken::Ptr& cancellation = CancellationToken::Ptr())
+-> Result<typename traits_t::transform_t>
+{
+    if (param.lineSearch() == LineSearch::MORE_THUENTE)
+        return optimizeMoreThuente<traits_t>(evaluate, param, initial_transform, cancellation);
+
+    static constexpr int DIMS = traits_t::LINEAR_DIMS + traits_t::ANGULAR_DIMS;
+    using transform_t         = typename traits_t::transform_t;
+    using result_t            = Result<transform_t>;
+
+    using linear_t      = Eigen::Matrix<double, traits_t::LINEAR_DIMS, 1>;
+    using angular_t     = Eigen::Matrix<double, traits_t::ANGULAR_DIMS, 1>;
+    using gradient_t    = Eigen::Matrix<double, DIMS, 1>;
+    using hessian_t     = Eigen::Matrix<double, DIMS, DIMS>;
 
     // initialize result
     double max_score        = std::numeric_limits<double>::lowest();
@@ -48,9 +216,14 @@ auto match(const iterator_t& points_begin,
     linear_t  linear_delta  = linear_t::Constant(std::numeric_limits<double>::max());
     angular_t angular_delta = angular_t::Constant(std::numeric_limits<double>::max());
 
-    double lambda = 1.0;
+    double lambda  = 1.0;
+    double damping = param.damping();
     std::size_t step_adjustments = 0;
 
+    // derivatives at the best parameters, rejected DAMPED_LDLT steps are retried from here
+    gradient_t  g_max = gradient_t::Zero();
+    hessian_t   h_max = hessian_t::Zero();
+
     // termination criteria
     const auto test_eps = [&]()
     {
@@ -73,60 +246,83 @@ auto match(const iterator_t& points_begin,
                     reason };
     };
 
+    // newton step from the best parameters, damped by lambda or the solver
+    const auto step = [&]()
+    {
+        gradient_t dp;
+        solve(h_max, g_max, param, damping, dp);
+        if (param.solver() == Solver::FULL_PIV_LU)
+            dp *= lambda;
+
+        linear_delta = dp.template head<traits_t::LINEAR_DIMS>();
+        linear = linear_old + linear_delta;
+
+        // todo: verify if we have to normalize here
+        angular_delta = dp.template tail<traits_t::ANGULAR_DIMS>();
+        angular = angular_old + angular_delta;
+    };
+
     // iterations
     for (iteration = 0; iteration < param.maxIterations(); ++iteration)
     {
         if (test_readjustments())
+        {
+            linear  = linear_old;
+            angular = angular_old;
             return terminate(Termination::MAX_STEP_READJUSTMENTS);
+        }
 
-        const auto t = traits_t::makeTransform(linear, angular);
-
-        JacobianCompute J;
-        JacobianCompute::get(angular, J);
-        HessianCompute H;
-        HessianCompute::get(angular, H);
+        if (cancellation && cancellation->expired())
+        {
+            /// the best parameters, nothing has been evaluated in the first iteration
+            linear  = linear_old;
+            angular = angular_old;
+            if (iteration == 0)
+                max_score = 0.0;
+            return terminate(Termination::DEADLINE);
+        }
 
         gradient_t  g = gradient_t::Zero();
         hessian_t   h = hessian_t::Zero();
 
         double score = 0.0;
-        // todo: reimplement parallelization
-        for (const point_t& point_prime : points_prime)
+        evaluate(linear, angular, score, g, &h);
+
+        if (score < max_score && param.solver() == Solver::FULL_PIV_LU)
         {
-            const point_t point = t * point_prime;
-            traits_t::computeGradient(map, point, J, H, param, score, g, h);
+            /// evaluate the best parameters again and take a shorter step from there
+            lambda  *= param.alpha();
+            linear  = linear_old;
+            angular = angular_old;
+            ++step_adjustments;
+            continue;
         }
 
         if (score < max_score)
         {
-            lambda *= param.alpha();
-            linear = linear_old;
-            angular = angular_old;
+            /// retry from the best parameters without evaluating them again
+            lambda  *= param.alpha();
+            damping *= param.dampingFactor();
             ++step_adjustments;
+            step();
+            if (test_eps())
+                return terminate(Termination::DELTA_EPSILON);
             continue;
         }
 
         if (score > max_score)
         {
             max_score = score;
-            lambda = std::max(1.0, lambda / param.alpha());
+            lambda  = std::max(1.0, lambda / param.alpha());
+            damping = std::max(param.damping(), damping / param.dampingFactor());
             step_adjustments = 0;
         }
 
-        /// limit H
-        // cslibs_math::statistics::LimitEigenValuesByZero<DIMS>::apply(h);
-        gradient_t dp = h.fullPivLu().solve(g);
-        dp *= lambda;
-
-        linear_old = linear;
+        g_max = g;
+        h_max = h;
+        linear_old  = linear;
         angular_old = angular;
-
-        linear_delta = dp.template head<traits_t::LINEAR_DIMS>();
-        linear += linear_delta;
-
-        // todo: verify if we have to normalize here
-        angular_delta = dp.template tail<traits_t::ANGULAR_DIMS>();
-        angular += angular_delta;
+        step();
 
         if (test_eps())
             return terminate(Termination::DELTA_EPSILON);
@@ -134,7 +330,242 @@ auto match(const iterator_t& points_begin,
 
     return terminate(Termination::MAX_ITERATIONS);
 }
+}
+
+namespace impl {
+template<typename T>
+struct Void { using type = void; };
+
+/**
+ * @brief Per match state of the traits. Traits which provide a cache_t get it prepared
+ *        once per match with the initially transformed points and passed to their
+ *        computeGradient overloads after the map, all others are called as usual.
+ *        A cache is filled lazily, points are thus only evaluated concurrently without one.
+ */
+template<typename traits_t, typename Enable = void>
+struct TraitsCache
+{
+    struct type {};
+
+    static constexpr bool CONCURRENT = true;
+
+    template<typename ndt_t, typename points_t>
+    static void prepare(const ndt_t&, const typename traits_t::parameter_t&, const points_t&, type&)
+    {}
+
+    template<typename ndt_t, typename... args_t>
+    static void computeGradient(const ndt_t& map, type&, args_t&&... args)
+    {
+        traits_t::computeGradient(map, std::forward<args_t>(args)...);
+    }
+};
+
+template<typename traits_t>
+struct TraitsCache<traits_t, typename Void<typename traits_t::cache_t>::type>
+{
+    using type = typename traits_t::cache_t;
+
+    static constexpr bool CONCURRENT = false;
+
+    template<typename ndt_t, typename points_t>
+    static void prepare(const ndt_t& map, const typename traits_t::parameter_t& param, const points_t& points, type& cache)
+    {
+        traits_t::prepareCache(map, param, points, cache);
+    }
+
+    template<typename ndt_t, typename... args_t>
+    static void computeGradient(const ndt_t& map, type& cache, args_t&&... args)
+    {
+        traits_t::computeGradient(map, cache, std::forward<args_t>(args)...);
+    }
+};
+
+/**
+ * @brief Buffers of a point to distribution match which can be reused between calls.
+ *        A workspace must not be shared by concurrent matches.
+ */
+template<typename traits_t>
+struct Workspace
+{
+    static constexpr int DIMS = traits_t::LINEAR_DIMS + traits_t::ANGULAR_DIMS;
+    using point_t          = typename traits_t::point_t;
+    /// the points can have more dimensions than the optimized translation, e.g. planar matching in 3D
+    using filter_t         = VoxelFilter<point_t::type_t::RowsAtCompileTime>;
+    using pool_t           = common::ThreadPool;
+    using gradient_t       = Eigen::Matrix<double, DIMS, 1>;
+    using hessian_t        = Eigen::Matrix<double, DIMS, DIMS>;
+    using gradient_array_t = std::vector<gradient_t, Eigen::aligned_allocator<gradient_t>>;
+    using hessian_array_t  = std::vector<hessian_t, Eigen::aligned_allocator<hessian_t>>;
+
+    /**
+     * @param pool     - the pool the downsampling runs on, the shared default if empty
+     * @param parallel - evaluate the points on the pool as well, requires traits_t::prepare(map)
+     *                   before matching and is ignored for traits with a cache_t
+     */
+    explicit Workspace(const pool_t::Ptr& pool = pool_t::Ptr(),
+                       const bool parallel = false) :
+            pool(pool),
+            parallel(parallel),
+            filter_resolution(0.0)
+    {}
+
+    std::vector<point_t>            points_prime;
+    pool_t::Ptr                     pool;
+    bool                            parallel;
+    std::shared_ptr<filter_t>       filter;
+    double                          filter_resolution;
+    typename TraitsCache<traits_t>::type cache;
+
+    /// per slot accumulators of parallel evaluations
+    std::vector<double>             scores;
+    gradient_array_t                gradients;
+    hessian_array_t                 hessians;
+};
+
+template<typename iterator_t, typename ndt_t, typename traits_t>
+auto match(const iterator_t& points_begin,
+           const iterator_t& points_end,
+           const ndt_t& map,
+           const typename traits_t::parameter_t& param,
+           const typename ndt_t::transform_t& initial_transform,
+           Workspace<traits_t>& workspace,
+           const CancellationToken::Ptr& cancellation = CancellationToken::Ptr())
+-> Result<typename ndt_t::transform_t>
+{
+    static constexpr int DIMS = traits_t::LINEAR_DIMS + traits_t::ANGULAR_DIMS;
+    using point_t             = typename ndt_t::point_t;
+
+    using JacobianCompute = typename traits_t::Jacobian;
+    using HessianCompute  = typename traits_t::Hessian;
+    using cache_t         = TraitsCache<traits_t>;
+
+    using linear_t      = Eigen::Matrix<double, traits_t::LINEAR_DIMS, 1>;
+    using angular_t     = Eigen::Matrix<double, traits_t::ANGULAR_DIMS, 1>;
+    using gradient_t    = Eigen::Matrix<double, DIMS, 1>;
+    using hessian_t     = Eigen::Matrix<double, DIMS, DIMS>;
+
+    // todo: pre transform points, should be externalized or made completely optional...
+    std::vector<point_t>& points_prime = workspace.points_prime;
+    points_prime.clear();
+    if (param.downsamplingResolution() > 0.0)
+    {
+        if (!workspace.filter || workspace.filter_resolution != param.downsamplingResolution())
+        {
+            workspace.filter.reset(new typename Workspace<traits_t>::filter_t(
+                    param.downsamplingResolution(), VoxelFilterMode::CENTROID, false, workspace.pool));
+            workspace.filter_resolution = param.downsamplingResolution();
+        }
+        workspace.filter->apply(points_begin, points_end);
+        points_prime.reserve(workspace.filter->size());
+        for (const auto& point : workspace.filter->points())
+            points_prime.emplace_back(initial_transform * point_t(point));
+    }
+    else
+    {
+        points_prime.reserve(std::distance(points_begin, points_end));
+        std::transform(points_begin, points_end, std::back_inserter(points_prime),
+                       [&](const point_t& point) { return initial_transform * point; });
+    }
+
+    /// per match state of the traits, e.g. occupancy weights
+    cache_t::prepare(map, param, points_prime, workspace.cache);
+
+    const common::ThreadPool::Ptr pool = workspace.pool ? workspace.pool : common::ThreadPool::getDefault();
+    const bool parallel = workspace.parallel && cache_t::CONCURRENT && pool->concurrency() > 1;
+    if (parallel)
+    {
+        workspace.scores.resize(pool->concurrency());
+        workspace.gradients.resize(pool->concurrency());
+        workspace.hessians.resize(pool->concurrency());
+    }
+
+    const auto evaluate = [&](const linear_t& linear, const angular_t& angular,
+                              double& score, gradient_t& g, hessian_t* h)
+    {
+        const auto t = traits_t::makeTransform(linear, angular);
+
+        JacobianCompute J;
+        JacobianCompute::get(angular, J);
+
+        if (parallel)
+        {
+            /// per slot accumulators, summed up after the loop
+            HessianCompute H;
+            if (h)
+                HessianCompute::get(angular, H);
+
+            std::fill(workspace.scores.begin(),    workspace.scores.end(),    0.0);
+            std::fill(workspace.gradients.begin(), workspace.gradients.end(), gradient_t::Zero());
+            std::fill(workspace.hessians.begin(),  workspace.hessians.end(),  hessian_t::Zero());
+
+            pool->parallelFor(0, points_prime.size(), 512,
+                              [&](const std::size_t slot, const std::size_t begin, const std::size_t end)
+            {
+                for (std::size_t k = begin; k < end; ++k)
+                {
+                    const point_t& point_prime = points_prime[k];
+                    const point_t  point       = t * point_prime;
+                    if (h)
+                        cache_t::computeGradient(map, workspace.cache, point, point_prime, J, H, param,
+                                                 workspace.scores[slot], workspace.gradients[slot], workspace.hessians[slot]);
+                    else
+                        cache_t::computeGradient(map, workspace.cache, point, point_prime, J, param,
+                                                 workspace.scores[slot], workspace.gradients[slot]);
+                }
+            });
+
+            for (std::size_t slot = 0; slot < workspace.scores.size(); ++slot)
+            {
+                score += workspace.scores[slot];
+                g     += workspace.gradients[slot];
+                if (h)
+                    *h += workspace.hessians[slot];
+            }
+        }
+        else if (h)
+        {
+            HessianCompute H;
+            HessianCompute::get(angular, H);
+            for (const point_t& point_prime : points_prime)
+            {
+                const point_t point = t * point_prime;
+                cache_t::computeGradient(map, workspace.cache, point, point_prime, J, H, param, score, g, *h);
+            }
+        }
+        else
+        {
+            for (const point_t& point_prime : points_prime)
+            {
+                const point_t point = t * point_prime;
+                cache_t::computeGradient(map, workspace.cache, point, point_prime, J, param, score, g);
+            }
+        }
+    };
+
+    return impl::optimize<traits_t>(evaluate, param, initial_transform, cancellation);
+}
+}
+
+/**
+ * @param cancellation - stops the match early with the best transform so far, optional
+ */
+template<typename iterator_t, typename ndt_t, typename traits_t = MatchTraits<ndt_t>>
+auto match(const iterator_t& points_begin,
+           const iterator_t& points_end,
+           const ndt_t& map,
+           const typename traits_t::parameter_t& param,
+           const typename ndt_t::transform_t& initial_transform,
+           const CancellationToken::Ptr& cancellation = CancellationToken::Ptr())
+-> Result<typename ndt_t::transform_t>
+{
+    impl::Workspace<traits_t> workspace;
+    return impl::match<iterator_t, ndt_t, traits_t>(points_begin, points_end, map, param, initial_transform, workspace, cancellation);
+}
 
+/**
+ * @brief Distribution to distribution matching. The source distributions already summarize
+ *        the points per cell, downsamplingResolution() is thus not applied.
+ */
 template<typename ndt_t, typename traits_t = MatchTraits<ndt_t>>
 auto match(const ndt_t& src,
            const ndt_t& dst,
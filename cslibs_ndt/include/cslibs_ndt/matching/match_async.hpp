@@ -0,0 +1,63 @@
+#pragma once
+
+#include <future>
+#include <memory>
+
+#include <cslibs_math/linear/pointcloud.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/cancellation_token.hpp>
+#include <cslibs_ndt/matching/match.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+/**
+ * @brief Match a cloud against a map on the pool and return immediately. The match stops
+ *        at the deadline of the token or when it is cancelled, the result then holds the
+ *        best transform so far and Termination::DEADLINE. Exceptions are passed on
+ *        through the future.
+ *
+ *        Pools without workers would run the match on the caller, it then gets a thread
+ *        of its own instead, whose future waits for the match when it is destroyed.
+ *
+ *        The cloud is kept alive by the task, the map has to outlive the future and must
+ *        not be modified until the match is done.
+ * @param cancellation - deadline and cancellation of the match, optional
+ * @param pool         - the pool to run on, the shared default if empty
+ */
+template<typename ndt_t, typename traits_t = MatchTraits<ndt_t>>
+auto matchAsync(const typename cslibs_math::linear::Pointcloud<typename traits_t::point_t>::ConstPtr& src,
+                const ndt_t& map,
+                const typename traits_t::parameter_t& param,
+                const typename ndt_t::transform_t& initial_transform,
+                const CancellationToken::Ptr& cancellation = CancellationToken::Ptr(),
+                const common::ThreadPool::Ptr& pool = common::ThreadPool::getDefault())
+-> std::future<Result<typename ndt_t::transform_t>>
+{
+    using transform_t = typename ndt_t::transform_t;
+    using result_t    = Result<transform_t>;
+    using promise_t   = std::promise<result_t>;
+
+    const auto run = [src, &map, param, initial_transform, cancellation]() -> result_t {
+        if (!src || src->getPoints().empty())
+            return result_t(0.0, 0, initial_transform, Termination::NONE);
+        return match<decltype(src->begin()), ndt_t, traits_t>(
+                    src->begin(), src->end(), map, param, initial_transform, cancellation);
+    };
+
+    const common::ThreadPool::Ptr p = pool ? pool : common::ThreadPool::getDefault();
+    if (!p->hasWorkers())
+        return std::async(std::launch::async, run);
+
+    std::shared_ptr<promise_t> promise(new promise_t);
+    std::future<result_t> result = promise->get_future();
+    p->enqueue([promise, run]() {
+        try {
+            promise->set_value(run());
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return result;
+}
+}
+}
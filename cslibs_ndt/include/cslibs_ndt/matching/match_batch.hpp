@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include <cslibs_math/linear/pointcloud.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/match.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+/**
+ * @brief Match many clouds against one map. Every cloud is matched on its own, the
+ *        matches are distributed over the pool, an idle thread takes the next pending
+ *        cloud. Each thread works in its own workspace, the map is only read.
+ *
+ *        The traits have to provide prepare(map), which is called once up front, and
+ *        the map must not be modified during the call.
+ * @param sources            - the clouds to match, empty clouds yield an empty result
+ * @param initial_transforms - one initial transform per cloud
+ * @param pool               - the pool to run on, the shared default if empty
+ * @return one result per cloud, in input order
+ */
+template<typename ndt_t, typename traits_t = MatchTraits<ndt_t>>
+auto matchBatch(const std::vector<typename cslibs_math::linear::Pointcloud<typename traits_t::point_t>::ConstPtr>& sources,
+                const std::vector<typename ndt_t::transform_t, Eigen::aligned_allocator<typename ndt_t::transform_t>>& initial_transforms,
+                const ndt_t& map,
+                const typename traits_t::parameter_t& param,
+                const common::ThreadPool::Ptr& pool = common::ThreadPool::getDefault())
+-> std::vector<Result<typename ndt_t::transform_t>, Eigen::aligned_allocator<Result<typename ndt_t::transform_t>>>
+{
+    using transform_t = typename ndt_t::transform_t;
+    using result_t    = Result<transform_t>;
+    using pool_t      = common::ThreadPool;
+
+    if (sources.size() != initial_transforms.size())
+        throw std::runtime_error("[matchBatch]: number of sources and initial transforms differ");
+
+    std::vector<result_t, Eigen::aligned_allocator<result_t>> results(sources.size());
+    const pool_t::Ptr p = pool ? pool : pool_t::getDefault();
+
+    traits_t::prepare(map);
+
+    /// downsampling runs inline, the matches themselves already occupy all threads
+    const pool_t::Ptr serial(new pool_t(1));
+    std::vector<impl::Workspace<traits_t>> workspaces(p->concurrency(), impl::Workspace<traits_t>(serial));
+
+    p->parallelFor(0, sources.size(), 1, [&](const std::size_t slot,
+                                             const std::size_t begin,
+                                             const std::size_t end) {
+        for (std::size_t i = begin ; i < end ; ++i) {
+            const auto& src = sources[i];
+            if (!src || src->getPoints().empty()) {
+                results[i] = result_t(0.0, 0, initial_transforms[i], Termination::NONE);
+                continue;
+            }
+            results[i] = impl::match<decltype(src->begin()), ndt_t, traits_t>(
+                        src->begin(), src->end(), map, param, initial_transforms[i], workspaces[slot]);
+        }
+    });
+    return results;
+}
+}
+}
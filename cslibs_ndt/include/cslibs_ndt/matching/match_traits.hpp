@@ -21,17 +21,43 @@ Required Interface:
 
     using point_t       = void;
     using transform_t   = void;
+    using parameter_t   = void;
 
     static transform_t makeTransform(const Eigen::Matrix<double, LINEAR_DIMS, 1>& linear,
                                      const Eigen::Matrix<double, ANGULAR_DIMS, 1>& angular);
 
+    // point is the transformed point, derivatives are evaluated at point_prime
     static void computeGradient(const MapT& map,
                                 const point_t& point,
+                                const point_t& point_prime,
                                 const Jacobian& J,
                                 const Hessian& H,
+                                const parameter_t& param,
                                 double& score,
                                 gradient_t& g,
                                 hessian_t& h);
+
+    // score and gradient only, used by the line search trials
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g);
+
+    // optional, makes concurrent evaluations read only, required by matchBatch
+    static void prepare(const MapT& map);
+
+    // optional, per match state kept in the workspace, e.g. resolved occupancy weights;
+    // if cache_t is defined, prepareCache is called once per match and the gradient is
+    // computed by the overloads taking the cache right after the map
+    using cache_t = void;
+    template<typename points_t>
+    static void prepareCache(const MapT& map,
+                             const parameter_t& param,
+                             const points_t& points,
+                             cache_t& cache);
 };
 */
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <cslibs_ndt/matching/parameter.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+
+/**
+ * @brief One level of a coarse-to-fine matching pyramid: the map resolution and
+ *        the optimizer settings (iteration budget, epsilons, ...) used on it.
+ */
+class ResolutionLevel
+{
+public:
+    explicit ResolutionLevel(double resolution,
+                             const Parameter& parameter = Parameter()) :
+            resolution_(resolution),
+            parameter_(parameter)
+    {}
+
+    double resolution() const { return resolution_; }
+    const Parameter& parameter() const { return parameter_; }
+
+    double& resolution() { return resolution_; }
+    Parameter& parameter() { return parameter_; }
+
+private:
+    double resolution_;
+    Parameter parameter_;
+};
+
+class MultiResolutionParameter
+{
+public:
+    using levels_t = std::vector<ResolutionLevel>;
+
+    MultiResolutionParameter() = default;
+
+    explicit MultiResolutionParameter(const levels_t& levels) :
+            levels_(levels)
+    {
+        sort();
+    }
+
+    /**
+     * @brief Convenience constructor sharing one parameter set across all levels,
+     *        with an individual iteration budget per resolution.
+     */
+    explicit MultiResolutionParameter(const std::vector<double>& resolutions,
+                                      const std::vector<std::size_t>& max_iterations,
+                                      const Parameter& parameter = Parameter())
+    {
+        for (std::size_t i = 0; i < resolutions.size(); ++i)
+        {
+            Parameter p(parameter);
+            if (i < max_iterations.size())
+                p.maxIterations() = max_iterations[i];
+            levels_.emplace_back(resolutions[i], p);
+        }
+        sort();
+    }
+
+    void addLevel(double resolution, const Parameter& parameter = Parameter())
+    {
+        levels_.emplace_back(resolution, parameter);
+        sort();
+    }
+
+    /// levels are always ordered coarse to fine
+    const levels_t& levels() const { return levels_; }
+    std::size_t size() const { return levels_.size(); }
+    bool empty() const { return levels_.empty(); }
+
+private:
+    levels_t levels_;
+
+    void sort()
+    {
+        std::stable_sort(levels_.begin(), levels_.end(),
+                         [](const ResolutionLevel& a, const ResolutionLevel& b)
+        { return a.resolution() > b.resolution(); });
+    }
+};
+
+}
+}
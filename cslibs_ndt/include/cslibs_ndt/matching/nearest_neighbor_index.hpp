@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <vector>
+#include <unordered_map>
+
+#include <cslibs_math/linear/pointcloud.hpp>
+#include <cslibs_ndt/common/index_hash.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+/**
+ * @brief Radius bounded nearest neighbor search over a fixed set of points.
+ *        Points are bucketed into a voxel hash with the search radius as cell size,
+ *        so a query only visits the 3^Dim cells around the query point. The indices
+ *        of every cell are stored contiguously.
+ *
+ *        Queries do not modify the index and can run concurrently.
+ */
+template<std::size_t Dim>
+class NearestNeighborIndex
+{
+public:
+    using Ptr           = std::shared_ptr<NearestNeighborIndex>;
+    using ConstPtr      = std::shared_ptr<const NearestNeighborIndex>;
+    using index_t       = std::array<int, Dim>;
+    using point_t       = cslibs_math::linear::Vector<double, Dim>;
+    using pointcloud_t  = cslibs_math::linear::Pointcloud<point_t>;
+
+    static constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Build the index.
+     * @param points     - the points to search in, kept alive by the index
+     * @param max_radius - the radius queries are bounded by, an infinite radius makes the
+     *                     search unbounded, a radius which is not positive finds nothing
+     */
+    inline NearestNeighborIndex(const typename pointcloud_t::ConstPtr &points,
+                                const double max_radius) :
+        points_(points),
+        max_radius_(max_radius > 0.0 ? max_radius : 0.0),
+        resolution_inv_(max_radius > 0.0 ? 1.0 / max_radius : 0.0)
+    {
+        const auto &pts = points_->getPoints();
+
+        /// step one: count the points per cell
+        std::vector<range_t*> cell_of_point(pts.size(), nullptr);
+        for (std::size_t i = 0 ; i < pts.size() ; ++i) {
+            if (!pts[i].isNormal())
+                continue;
+            range_t &r = cells_[getIndex(pts[i])];
+            ++r.second;
+            cell_of_point[i] = &r;
+        }
+
+        /// step two: assign every cell a contiguous range
+        std::size_t offset = 0;
+        for (auto &c : cells_) {
+            c.second.first = offset;
+            offset += c.second.second;
+            c.second.second = c.second.first;
+        }
+
+        /// step three: fill the ranges in input order
+        indices_.resize(offset);
+        for (std::size_t i = 0 ; i < pts.size() ; ++i) {
+            if (cell_of_point[i])
+                indices_[cell_of_point[i]->second++] = i;
+        }
+    }
+
+    /**
+     * @brief Find the closest point within the maximum radius.
+     * @param p          - the query point
+     * @param distance2  - the squared distance to the neighbor
+     * @return the index of the neighbor in the indexed cloud, NONE if there is none
+     */
+    inline std::size_t nearest(const point_t &p,
+                               double &distance2) const
+    {
+        std::size_t nearest = NONE;
+        distance2 = max_radius_ * max_radius_;
+        if (max_radius_ == 0.0)
+            return nearest;
+
+        const auto &pts = points_->getPoints();
+        const index_t center = getIndex(p);
+
+        index_t offset;
+        offset.fill(-1);
+        while (true) {
+            index_t cell;
+            for (std::size_t i = 0 ; i < Dim ; ++i)
+                cell[i] = center[i] + offset[i];
+
+            const auto c = cells_.find(cell);
+            if (c != cells_.end()) {
+                for (std::size_t k = c->second.first ; k < c->second.second ; ++k) {
+                    const std::size_t j = indices_[k];
+                    const double d2 = (pts[j] - p).length2();
+                    if (d2 < distance2) {
+                        distance2 = d2;
+                        nearest   = j;
+                    }
+                }
+            }
+
+            /// next of the 3^Dim neighboring cells
+            std::size_t i = 0;
+            for (; i < Dim ; ++i) {
+                if (++offset[i] <= 1)
+                    break;
+                offset[i] = -1;
+            }
+            if (i == Dim)
+                break;
+        }
+        return nearest;
+    }
+
+    inline double maxRadius() const
+    {
+        return max_radius_;
+    }
+
+    inline const typename pointcloud_t::ConstPtr& points() const
+    {
+        return points_;
+    }
+
+private:
+    /// [begin, end) in indices_
+    using range_t = std::pair<std::size_t, std::size_t>;
+    using table_t = std::unordered_map<index_t, range_t, cslibs_ndt::common::IndexHash<Dim>>;
+
+    typename pointcloud_t::ConstPtr points_;
+    double                          max_radius_;
+    double                          resolution_inv_;
+    table_t                         cells_;
+    std::vector<std::size_t>        indices_;
+
+    inline index_t getIndex(const point_t &p) const
+    {
+        index_t index;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            index[i] = static_cast<int>(std::floor(p(i) * resolution_inv_));
+        return index;
+    }
+};
+
+template<std::size_t Dim>
+constexpr std::size_t NearestNeighborIndex<Dim>::NONE;
+}
+}
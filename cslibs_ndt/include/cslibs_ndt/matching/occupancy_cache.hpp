@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+#include <cslibs_gridmaps/utility/inverse_model.hpp>
+#include <cslibs_ndt/common/index_hash.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+/**
+ * @brief Occupancy weights of the bundles a scan touches during one match. Every bundle
+ *        is resolved once to its valid distributions and their occupancy, so scoring a
+ *        point costs one hash lookup instead of a bundle lookup and an occupancy update
+ *        per distribution. Bundles below the occupancy threshold are kept as empty entries.
+ *
+ *        The map is only read, distributions are never allocated and their cached
+ *        occupancy is not touched. A cache must not be shared by concurrent matches.
+ */
+template<typename map_t>
+class OccupancyCache
+{
+public:
+    using index_t           = typename map_t::index_t;
+    using point_t           = typename map_t::point_t;
+    using pose_t            = typename map_t::pose_t;
+    using bundle_t          = typename map_t::distribution_const_bundle_t::data_t;
+    using distribution_t    = typename map_t::distribution_t::distribution_t;
+    using inverse_model_t   = cslibs_gridmaps::utility::InverseModel;
+
+    static constexpr std::size_t DIM  = std::tuple_size<index_t>::value;
+    static constexpr std::size_t SIZE = std::tuple_size<bundle_t>::value;
+
+    struct Entry
+    {
+        std::array<const distribution_t*, SIZE> distributions;
+        std::array<double, SIZE>                occupancy;
+        std::size_t                             size = 0;
+    };
+
+    /**
+     * @brief Drop all entries, the storage is kept for the next match.
+     * @param threshold - bundles with a lower mean occupancy are ignored, 0 disables the check
+     */
+    inline void reset(const map_t &map,
+                      const inverse_model_t &inverse_model,
+                      const double threshold)
+    {
+        map_                   = &map;
+        inverse_model_         = &inverse_model;
+        threshold_             = threshold;
+        m_T_w_                 = map.getInitialOrigin().inverse();
+        bundle_resolution_inv_ = 1.0 / map.getBundleResolution();
+        entries_.clear();
+    }
+
+    /**
+     * @brief The entry of the bundle containing a point, it is resolved on first access.
+     */
+    inline const Entry& get(const point_t &p)
+    {
+        const index_t bi = toBundleIndex(m_T_w_ * p, bundle_resolution_inv_);
+        auto it = entries_.find(bi);
+        if (it == entries_.end()) {
+            it = entries_.emplace(bi, Entry()).first;
+            resolve(*map_, bi, *inverse_model_, threshold_, it->second);
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief Resolve the bundle containing a point without caching it.
+     */
+    inline static void resolve(const map_t &map,
+                               const point_t &p,
+                               const inverse_model_t &inverse_model,
+                               const double threshold,
+                               Entry &entry)
+    {
+        const point_t p_m = map.getInitialOrigin().inverse() * p;
+        resolve(map, toBundleIndex(p_m, 1.0 / map.getBundleResolution()), inverse_model, threshold, entry);
+    }
+
+    /**
+     * @brief Resolve one bundle without caching it.
+     */
+    inline static void resolve(const map_t &map,
+                               const index_t &bi,
+                               const inverse_model_t &inverse_model,
+                               const double threshold,
+                               Entry &entry)
+    {
+        entry.size = 0;
+
+        bundle_t bundle;
+        if (!map.lookupDistributionBundle(bi, bundle))
+            return;
+
+        /// distributions which do not exist count like empty ones for the threshold
+        const double empty_occupancy = typename map_t::distribution_t().computeOccupancy(inverse_model);
+
+        double mean_occupancy = 0.0;
+        std::array<double, SIZE> occupancy;
+        for (std::size_t i = 0 ; i < SIZE ; ++i) {
+            occupancy[i] = bundle[i] ? bundle[i]->computeOccupancy(inverse_model) : empty_occupancy;
+            mean_occupancy += occupancy[i];
+        }
+        if (threshold > 0.0 && mean_occupancy / static_cast<double>(SIZE) < threshold)
+            return;
+
+        for (std::size_t i = 0 ; i < SIZE ; ++i) {
+            if (!bundle[i])
+                continue;
+            const auto &d = bundle[i]->getDistribution();
+            if (!d || d->getN() < DIM + 1)
+                continue;
+            entry.distributions[entry.size] = d.get();
+            entry.occupancy[entry.size]     = occupancy[i];
+            ++entry.size;
+        }
+    }
+
+private:
+    inline static index_t toBundleIndex(const point_t &p_m,
+                                        const double bundle_resolution_inv)
+    {
+        index_t bi;
+        for (std::size_t i = 0 ; i < DIM ; ++i)
+            bi[i] = static_cast<int>(std::floor(p_m(i) * bundle_resolution_inv));
+        return bi;
+    }
+
+    const map_t                                                         *map_ = nullptr;
+    const inverse_model_t                                               *inverse_model_ = nullptr;
+    double                                                               threshold_ = 0.0;
+    pose_t                                                               m_T_w_;
+    double                                                               bundle_resolution_inv_ = 1.0;
+    std::unordered_map<index_t, Entry, cslibs_ndt::common::IndexHash<DIM>> entries_;
+};
+}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cslibs_ndt/matching/parameter.hpp>
+#include <cslibs_gridmaps/utility/inverse_model.hpp>
 
 namespace cslibs_ndt {
 namespace matching {
@@ -12,7 +13,8 @@ public:
                                 const cslibs_gridmaps::utility::InverseModel& inverse_model,
                                 double occupancy_threshold = 0.0) :
             Parameter(parameter),
-            inverse_model_(inverse_model)
+            inverse_model_(inverse_model),
+            occupancy_threshold_(occupancy_threshold)
     {}
 
     cslibs_gridmaps::utility::InverseModel& inverseModel() { return inverse_model_; }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cslibs_ndt {
+namespace matching {
+
+/**
+ * @brief Settings of the pipelined scan-to-map odometry. A scan is inserted into the map
+ *        if any enabled update policy triggers, with all policies disabled every scan is.
+ *
+ * queueCapacity          : scans a stage may run ahead of the next one
+ * downsamplingResolution : voxel size scans are downsampled to for matching, 0 disables it
+ * insertEvery            : insert every n-th scan, 0 disables the policy
+ * minTranslation         : insert once the pose moved that far from the last inserted one, 0 disables it
+ * minRotation            : insert once the pose turned that much from the last inserted one, 0 disables it
+ */
+class OdometryParameter
+{
+public:
+    OdometryParameter() :
+        queue_capacity_(2),
+        downsampling_resolution_(0.0),
+        insert_every_(1),
+        min_translation_(0.0),
+        min_rotation_(0.0)
+    {
+    }
+
+    std::size_t queueCapacity() const { return queue_capacity_; }
+    double downsamplingResolution() const { return downsampling_resolution_; }
+    std::size_t insertEvery() const { return insert_every_; }
+    double minTranslation() const { return min_translation_; }
+    double minRotation() const { return min_rotation_; }
+
+    std::size_t& queueCapacity() { return queue_capacity_; }
+    double& downsamplingResolution() { return downsampling_resolution_; }
+    std::size_t& insertEvery() { return insert_every_; }
+    double& minTranslation() { return min_translation_; }
+    double& minRotation() { return min_rotation_; }
+
+private:
+    std::size_t queue_capacity_;
+    double downsampling_resolution_;
+    std::size_t insert_every_;
+    double min_translation_;
+    double min_rotation_;
+};
+
+}
+}
@@ -2,9 +2,24 @@
 
 #include <cstdint>
 
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+
 namespace cslibs_ndt {
 namespace matching {
 
+/**
+ * NONE         : damped newton steps, the damping is adapted by alpha on rejected steps
+ * MORE_THUENTE : More-Thuente line search along the newton direction
+ */
+enum class LineSearch { NONE, MORE_THUENTE };
+
+/**
+ * FULL_PIV_LU : solve the newton system as is
+ * DAMPED_LDLT : LDLT of the negated hessian with levenberg-marquardt damping, the damping
+ *               is raised on rejected steps and until the system is positive definite
+ */
+enum class Solver { FULL_PIV_LU, DAMPED_LDLT };
+
 class Parameter
 {
 public:
@@ -13,7 +28,17 @@ public:
         translation_epsilon_(1e-3),
         rotation_epsilon_(1e-3),
         max_step_readjustments_(5),
-        alpha_(1.1)
+        alpha_(1.1),
+        line_search_(LineSearch::NONE),
+        max_step_length_(0.1),
+        max_line_search_iterations_(10),
+        sufficient_decrease_(1e-4),
+        curvature_(0.9),
+        solver_(Solver::FULL_PIV_LU),
+        damping_(1e-3),
+        damping_factor_(10.0),
+        downsampling_resolution_(0.0),
+        kernel_(common::Kernel::EXACT)
     {
     }
 
@@ -26,7 +51,17 @@ public:
             translation_epsilon_(translation_epsilon),
             rotation_epsilon_(rotation_epsilon),
             max_step_readjustments_(max_step_readjustments),
-            alpha_(alpha)
+            alpha_(alpha),
+            line_search_(LineSearch::NONE),
+            max_step_length_(0.1),
+            max_line_search_iterations_(10),
+            sufficient_decrease_(1e-4),
+            curvature_(0.9),
+            solver_(Solver::FULL_PIV_LU),
+            damping_(1e-3),
+            damping_factor_(10.0),
+            downsampling_resolution_(0.0),
+            kernel_(common::Kernel::EXACT)
     {}
 
     std::size_t maxIterations() const { return max_iterations_; }
@@ -34,12 +69,35 @@ public:
     double rotationEpsilon() const { return rotation_epsilon_; }
     std::size_t maxStepReadjustments() const { return max_step_readjustments_; }
     double alpha() const { return alpha_; }
+    LineSearch lineSearch() const { return line_search_; }
+    double maxStepLength() const { return max_step_length_; }
+    std::size_t maxLineSearchIterations() const { return max_line_search_iterations_; }
+    double sufficientDecrease() const { return sufficient_decrease_; }
+    double curvature() const { return curvature_; }
+    Solver solver() const { return solver_; }
+    double damping() const { return damping_; }
+    double dampingFactor() const { return damping_factor_; }
+    /// voxel size the source points are downsampled to before matching, 0 disables downsampling;
+    /// distribution to distribution matching ignores it, its source is already a voxel grid
+    double downsamplingResolution() const { return downsampling_resolution_; }
+    /// evaluation of the gaussians, scores below 1e-5 are dropped by the traits with either kernel
+    common::Kernel kernel() const { return kernel_; }
 
     std::size_t& maxIterations() { return max_iterations_; }
     double& translationEpsilon() { return translation_epsilon_; }
     double& rotationEpsilon() { return rotation_epsilon_; }
     std::size_t& maxStepReadjustments() { return max_step_readjustments_; }
     double& alpha() { return alpha_; }
+    LineSearch& lineSearch() { return line_search_; }
+    double& maxStepLength() { return max_step_length_; }
+    std::size_t& maxLineSearchIterations() { return max_line_search_iterations_; }
+    double& sufficientDecrease() { return sufficient_decrease_; }
+    double& curvature() { return curvature_; }
+    Solver& solver() { return solver_; }
+    double& damping() { return damping_; }
+    double& dampingFactor() { return damping_factor_; }
+    double& downsamplingResolution() { return downsampling_resolution_; }
+    common::Kernel& kernel() { return kernel_; }
 
 
 private:
@@ -48,6 +106,16 @@ private:
     double rotation_epsilon_;
     std::size_t max_step_readjustments_;
     double alpha_;
+    LineSearch line_search_;
+    double max_step_length_;
+    std::size_t max_line_search_iterations_;
+    double sufficient_decrease_;
+    double curvature_;
+    Solver solver_;
+    double damping_;
+    double damping_factor_;
+    double downsampling_resolution_;
+    common::Kernel kernel_;
 };
 
 }
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Eigen/Eigen>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace impl {
+/**
+ * @brief Accumulate gradient and hessian of one weighted gaussian term of a planar
+ *        (x, y, yaw) match, s = a * exp(-c/2 * q^T info q) with q the point relative
+ *        to the mean. The translational columns of the jacobian are the first two unit
+ *        vectors, so only the yaw column and its second derivative are required.
+ * @param q_info - info * q
+ * @param info   - the information matrix of the distribution
+ * @param J_yaw  - the derivative of the point by yaw
+ * @param H_yaw  - the second derivative of the point by yaw, unused without h
+ * @param s      - the score of the term
+ * @param c      - the scaling of the exponent
+ * @param g      - accumulates -ds/dp
+ * @param h      - accumulates d^2s/dp^2 if not null
+ */
+template<int Dim>
+inline void accumulatePlanar(const Eigen::Matrix<double, Dim, 1>&   q_info,
+                             const Eigen::Matrix<double, Dim, Dim>& info,
+                             const Eigen::Matrix<double, Dim, 1>&   J_yaw,
+                             const Eigen::Matrix<double, Dim, 1>&   H_yaw,
+                             const double                           s,
+                             const double                           c,
+                             Eigen::Matrix<double, 3, 1>&           g,
+                             Eigen::Matrix<double, 3, 3>*           h)
+{
+    const double cs           = c * s;
+    const double q_info_J_yaw = q_info.dot(J_yaw);
+    g(0) += cs * q_info(0);
+    g(1) += cs * q_info(1);
+    g(2) += cs * q_info_J_yaw;
+
+    if (!h)
+        return;
+
+    const Eigen::Matrix<double, Dim, 1> info_J_yaw = info * J_yaw;
+    const double h_00 = cs * (c * q_info(0) * q_info(0) - info(0, 0));
+    const double h_01 = cs * (c * q_info(0) * q_info(1) - info(0, 1));
+    const double h_11 = cs * (c * q_info(1) * q_info(1) - info(1, 1));
+    const double h_02 = cs * (c * q_info(0) * q_info_J_yaw - info_J_yaw(0));
+    const double h_12 = cs * (c * q_info(1) * q_info_J_yaw - info_J_yaw(1));
+    const double h_22 = cs * (c * q_info_J_yaw * q_info_J_yaw - J_yaw.dot(info_J_yaw) - q_info.dot(H_yaw));
+    (*h)(0, 0) += h_00;
+    (*h)(0, 1) += h_01;
+    (*h)(1, 0) += h_01;
+    (*h)(1, 1) += h_11;
+    (*h)(0, 2) += h_02;
+    (*h)(2, 0) += h_02;
+    (*h)(1, 2) += h_12;
+    (*h)(2, 1) += h_12;
+    (*h)(2, 2) += h_22;
+}
+}
+}
+}
@@ -6,7 +6,10 @@
 namespace cslibs_ndt {
 namespace matching {
 
-enum class Termination { NONE, MAX_ITERATIONS, DELTA_EPSILON, MAX_STEP_READJUSTMENTS };
+/**
+ * DEADLINE : the match was cancelled or ran out of time, the result is the best transform so far
+ */
+enum class Termination { NONE, MAX_ITERATIONS, DELTA_EPSILON, MAX_STEP_READJUSTMENTS, DEADLINE };
 
 template<typename transform_t>
 class EIGEN_ALIGN16 Result
@@ -59,6 +62,7 @@ inline std::string to_string(const cslibs_ndt::matching::Termination& terminatio
         case Termination::MAX_ITERATIONS: return "MAX_ITERATIONS";
         case Termination::DELTA_EPSILON: return "DELTA_EPSILON";
         case Termination::MAX_STEP_READJUSTMENTS: return "MAX_STEP_READJUSTMENTS";
+        case Termination::DEADLINE: return "DEADLINE";
     }
 }
 
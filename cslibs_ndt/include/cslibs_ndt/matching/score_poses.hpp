@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <iterator>
+#include <algorithm>
+
+#include <eigen3/Eigen/Eigen>
+
+#include <cslibs_gridmaps/utility/inverse_model.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace impl {
+/**
+ * @brief Score one set of points under many poses.
+ *        The points are copied into one matrix, so every pose transforms all of them
+ *        with a single vectorized product. Poses are ordered by the map cell of their
+ *        translation and processed in blocks, within a block every point is sampled
+ *        under all poses in a row, so poses which overlap hit the same bundles while
+ *        they are still cached.
+ * @param sample - sample(point) is the score of a single point, it must be safe to
+ *                 call concurrently
+ */
+template<typename point_t, typename pose_t, typename iterator_t, typename sample_t>
+inline std::vector<double> scorePoses(const iterator_t& points_begin,
+                                      const iterator_t& points_end,
+                                      const std::vector<pose_t, Eigen::aligned_allocator<pose_t>>& poses,
+                                      const double resolution,
+                                      const common::ThreadPool::Ptr& pool,
+                                      const sample_t& sample)
+{
+    static constexpr std::size_t BLOCK = 8;
+
+    using vector_t      = typename std::decay<decltype(std::declval<point_t>().data())>::type;
+    static constexpr int DIMS = vector_t::RowsAtCompileTime;
+    using points_t      = Eigen::Matrix<double, DIMS, Eigen::Dynamic>;
+    using rotation_t    = Eigen::Matrix<double, DIMS, DIMS>;
+    using translation_t = Eigen::Matrix<double, DIMS, 1>;
+
+    std::vector<double> scores(poses.size(), 0.0);
+
+    const std::size_t n = static_cast<std::size_t>(std::distance(points_begin, points_end));
+    if (n == 0 || poses.empty())
+        return scores;
+
+    points_t points(DIMS, n);
+    {
+        std::size_t i = 0;
+        for (iterator_t itr = points_begin ; itr != points_end ; ++itr)
+            points.col(i++) = (*itr).data();
+    }
+
+    /// neighbouring poses end up in the same block
+    const double resolution_inv = 1.0 / resolution;
+    std::vector<std::size_t> order(poses.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<Eigen::Matrix<long, DIMS, 1>, Eigen::aligned_allocator<Eigen::Matrix<long, DIMS, 1>>> cells(poses.size());
+    for (std::size_t k = 0 ; k < poses.size() ; ++k)
+        cells[k] = ((poses[k] * point_t(translation_t::Zero())).data() * resolution_inv).array().floor().template cast<long>();
+    std::sort(order.begin(), order.end(), [&cells](const std::size_t a, const std::size_t b) {
+        return std::lexicographical_compare(cells[a].data(), cells[a].data() + DIMS,
+                                            cells[b].data(), cells[b].data() + DIMS);
+    });
+
+    const common::ThreadPool::Ptr p = pool ? pool : common::ThreadPool::getDefault();
+    std::vector<std::vector<points_t>> buffers(p->concurrency(), std::vector<points_t>(BLOCK));
+
+    const std::size_t blocks = (poses.size() + BLOCK - 1) / BLOCK;
+    p->parallelFor(0, blocks, 1, [&](const std::size_t slot,
+                                     const std::size_t begin,
+                                     const std::size_t end) {
+        std::vector<points_t> &transformed = buffers[slot];
+        for (std::size_t b = begin ; b < end ; ++b) {
+            const std::size_t first = b * BLOCK;
+            const std::size_t count = std::min(BLOCK, poses.size() - first);
+
+            /// step one: transform all points under every pose of the block
+            for (std::size_t j = 0 ; j < count ; ++j) {
+                const pose_t &pose = poses[order[first + j]];
+                const translation_t t = (pose * point_t(translation_t::Zero())).data();
+                rotation_t R;
+                for (int d = 0 ; d < DIMS ; ++d)
+                    R.col(d) = (pose * point_t(translation_t::Unit(d))).data() - t;
+
+                transformed[j].noalias() = R * points;
+                transformed[j].colwise() += t;
+            }
+
+            /// step two: sample point by point across the block
+            double block_scores[BLOCK] = {};
+            for (std::size_t i = 0 ; i < n ; ++i)
+                for (std::size_t j = 0 ; j < count ; ++j)
+                    block_scores[j] += sample(point_t(transformed[j].col(i)));
+
+            for (std::size_t j = 0 ; j < count ; ++j)
+                scores[order[first + j]] = block_scores[j];
+        }
+    });
+    return scores;
+}
+}
+
+/**
+ * @brief The non normalized score of a set of points under every pose, e.g. for the
+ *        weighting of particles. Only map lookups are done, neither gradients nor
+ *        hessians. The map must not be modified during the call.
+ * @param points_begin - the points in the frame of the poses
+ * @param points_end   - end of the points
+ * @param poses        - the poses to score
+ * @param map          - a 2D or 3D gridmap
+ * @param pool         - the pool to run on, the shared default if empty
+ * @param kernel       - evaluation of the gaussians, see common::Kernel
+ * @return one score per pose, the sum of the point samples
+ */
+template<typename iterator_t, typename map_t>
+inline std::vector<double> scorePoses(const iterator_t& points_begin,
+                                      const iterator_t& points_end,
+                                      const std::vector<typename map_t::transform_t,
+                                                        Eigen::aligned_allocator<typename map_t::transform_t>>& poses,
+                                      const map_t& map,
+                                      const common::ThreadPool::Ptr& pool = common::ThreadPool::getDefault(),
+                                      const common::Kernel kernel = common::Kernel::EXACT)
+{
+    using point_t = typename map_t::point_t;
+
+    /// distributions compute their moments lazily, do it once up front
+    for (const auto& storage : map.getStorages())
+    {
+        storage->traverse([](const typename map_t::index_t&, const typename map_t::distribution_t& d)
+        {
+            d.data().getInformationMatrix();
+        });
+    }
+
+    return impl::scorePoses<point_t>(points_begin, points_end, poses, map.getResolution(), pool,
+                                     [&map, kernel](const point_t& p) { return map.sampleNonNormalized(p, kernel); });
+}
+
+/**
+ * @brief The non normalized score of a set of points under every pose for 2D or 3D
+ *        occupancy gridmaps, see above.
+ * @param inverse_model - the inverse model the occupancy is computed with
+ */
+template<typename iterator_t, typename map_t>
+inline std::vector<double> scorePoses(const iterator_t& points_begin,
+                                      const iterator_t& points_end,
+                                      const std::vector<typename map_t::transform_t,
+                                                        Eigen::aligned_allocator<typename map_t::transform_t>>& poses,
+                                      const map_t& map,
+                                      const cslibs_gridmaps::utility::InverseModel::Ptr& inverse_model,
+                                      const common::ThreadPool::Ptr& pool = common::ThreadPool::getDefault(),
+                                      const common::Kernel kernel = common::Kernel::EXACT)
+{
+    using point_t = typename map_t::point_t;
+
+    if (!inverse_model)
+        throw std::runtime_error("[scorePoses]: inverse model not set");
+
+    /// the occupancy is cached per inverse model, fill the caches before sampling concurrently
+    for (const auto& storage : map.getStorages())
+    {
+        storage->traverse([&inverse_model](const typename map_t::index_t&, const typename map_t::distribution_t& d)
+        {
+            d.getOccupancy(inverse_model);
+            if (d.getDistribution())
+                d.getDistribution()->getInformationMatrix();
+        });
+    }
+
+    return impl::scorePoses<point_t>(points_begin, points_end, poses, map.getResolution(), pool,
+                                     [&map, &inverse_model, kernel](const point_t& p) { return map.sampleNonNormalized(p, inverse_model, kernel); });
+}
+}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <eigen3/Eigen/Eigen>
+#include <limits>
+
+#include <cslibs_ndt/matching/parameter.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+namespace impl {
+/**
+ * @brief Solve the newton system h * dp = g, where h is the hessian of the score
+ *        and g the negated gradient, i.e. dp is an ascent step.
+ * @param damping - relative levenberg-marquardt damping, only used by Solver::DAMPED_LDLT;
+ *                  raised in place until the damped system is positive definite
+ * @return false if the damped system could not be factorized and a scaled
+ *         gradient step was returned instead
+ */
+template<typename gradient_t, typename hessian_t>
+inline bool solve(const hessian_t& h,
+                  const gradient_t& g,
+                  const Parameter& param,
+                  double& damping,
+                  gradient_t& dp)
+{
+    static constexpr std::size_t MAX_DAMPING_ADJUSTMENTS = 32;
+
+    if (param.solver() == Solver::FULL_PIV_LU)
+    {
+        dp = h.fullPivLu().solve(g);
+        return true;
+    }
+
+    /// near the optimum -h is positive definite, damping is relative to its largest diagonal entry
+    const hessian_t a     = -h;
+    const double    scale = std::max(a.diagonal().cwiseAbs().maxCoeff(), std::numeric_limits<double>::epsilon());
+
+    Eigen::LDLT<hessian_t> ldlt;
+    for (std::size_t i = 0; i < MAX_DAMPING_ADJUSTMENTS; ++i)
+    {
+        ldlt.compute(a + (damping * scale) * hessian_t::Identity());
+        if (ldlt.info() == Eigen::Success && (ldlt.vectorD().array() > 0.0).all())
+        {
+            dp = -ldlt.solve(g);
+            return true;
+        }
+        damping = damping > 0.0 ? damping * param.dampingFactor() : std::numeric_limits<float>::epsilon();
+    }
+
+    /// indefinite beyond repair, fall back to a scaled gradient step
+    dp = -g / scale;
+    return false;
+}
+}
+}
+}
@@ -35,23 +35,31 @@ public:
     inline virtual ~Voxel() = default;
 
     inline Voxel(const Voxel &other) :
+        n_(other.n_),
+        n_1_(other.n_1_),
         mean_(other.mean_)
     {
     }
 
-   inline  Voxel(Voxel &&other) :
+    inline Voxel(Voxel &&other) :
+        n_(other.n_),
+        n_1_(other.n_1_),
         mean_(std::move(other.mean_))
     {
     }
 
     inline Voxel& operator = (const Voxel &other)
     {
+        n_    = other.n_;
+        n_1_  = other.n_1_;
         mean_ = other.mean_;
         return *this;
     }
 
     inline Voxel& operator = (Voxel &&other)
     {
+        n_    = other.n_;
+        n_1_  = other.n_1_;
         mean_ = std::move(other.mean_);
         return *this;
     }
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include <cslibs_math/linear/pointcloud.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/common/index_hash.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+
+/**
+ * CENTROID    : every voxel is represented by the mean of its points
+ * FIRST_POINT : every voxel is represented by its first point in input order
+ */
+enum class VoxelFilterMode { CENTROID, FIRST_POINT };
+
+/**
+ * @brief Hash based voxel grid downsampling. Only occupied voxels are stored, so the
+ *        memory does not depend on the extent of the input. Points are accumulated in
+ *        parallel into per thread tables which are split into shards by hash, the shards
+ *        are then merged in parallel as well.
+ *
+ *        The output is deterministic: voxels are ordered by the input position of their
+ *        first point, independent of the number of threads.
+ */
+template<std::size_t Dim>
+class EIGEN_ALIGN16 VoxelFilter
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Ptr           = std::shared_ptr<VoxelFilter>;
+    using index_t       = std::array<int, Dim>;
+    using point_t       = cslibs_math::linear::Vector<double, Dim>;
+    using pointcloud_t  = cslibs_math::linear::Pointcloud<point_t>;
+    using mean_t        = Eigen::Matrix<double, Dim, 1>;
+    using covariance_t  = Eigen::Matrix<double, Dim, Dim>;
+    using pool_t        = cslibs_ndt::common::ThreadPool;
+
+    using point_array_t      = std::vector<point_t, Eigen::aligned_allocator<point_t>>;
+    using covariance_array_t = std::vector<covariance_t, Eigen::aligned_allocator<covariance_t>>;
+
+    /**
+     * @brief Create a filter.
+     * @param resolution           - the voxel size
+     * @param mode                 - how a voxel is represented
+     * @param compute_covariances  - also compute the sample covariance of every voxel
+     * @param pool                 - the pool to run on, the shared default if empty
+     */
+    inline explicit VoxelFilter(const double resolution,
+                                const VoxelFilterMode mode = VoxelFilterMode::CENTROID,
+                                const bool compute_covariances = false,
+                                const pool_t::Ptr &pool = pool_t::getDefault()) :
+        resolution_inv_(1.0 / resolution),
+        mode_(mode),
+        compute_covariances_(compute_covariances),
+        pool_(pool ? pool : pool_t::getDefault())
+    {
+    }
+
+    /**
+     * @brief Downsample a range of points, the result replaces the previous one.
+     *        Points which are not finite are dropped.
+     */
+    template<typename iterator_t>
+    inline void apply(const iterator_t &points_begin,
+                      const iterator_t &points_end)
+    {
+        const std::size_t n      = static_cast<std::size_t>(std::distance(points_begin, points_end));
+        const std::size_t slots  = pool_->concurrency();
+        const std::size_t shards = slots;
+
+        tables_.resize(slots);
+        for (auto &t : tables_) {
+            t.resize(shards);
+            for (auto &s : t)
+                s.clear();
+        }
+
+        /// step one: accumulate chunks of the input into per thread tables
+        pool_->parallelFor(0, n, GRAIN, [this, &points_begin, shards](const std::size_t slot,
+                                                                      const std::size_t begin,
+                                                                      const std::size_t end) {
+            std::vector<table_t> &tables = tables_[slot];
+            iterator_t itr = std::next(points_begin, static_cast<typename std::iterator_traits<iterator_t>::difference_type>(begin));
+            for (std::size_t i = begin ; i < end ; ++i, ++itr) {
+                const point_t &p = *itr;
+                if (!p.isNormal())
+                    continue;
+
+                const index_t index = getIndex(p);
+                accumulator_t &a = tables[shard(index, shards)][index];
+                a.add(p.data(), i, compute_covariances_);
+            }
+        });
+
+        /// step two: merge every shard over all threads
+        pool_->parallelFor(0, shards, 1, [this, slots](const std::size_t,
+                                                       const std::size_t begin,
+                                                       const std::size_t end) {
+            for (std::size_t s = begin ; s < end ; ++s) {
+                table_t &merged = tables_[0][s];
+                for (std::size_t t = 1 ; t < slots ; ++t) {
+                    for (const auto &entry : tables_[t][s])
+                        merged[entry.first].merge(entry.second, compute_covariances_);
+                    tables_[t][s].clear();
+                }
+            }
+        });
+
+        /// step three: order the voxels by their first point
+        voxels_.clear();
+        for (const table_t &s : tables_[0])
+            for (const auto &entry : s)
+                voxels_.emplace_back(&entry.second);
+        std::sort(voxels_.begin(), voxels_.end(),
+                  [](const accumulator_t *a, const accumulator_t *b) { return a->first_index < b->first_index; });
+
+        const std::size_t v = voxels_.size();
+        points_.resize(v);
+        counts_.resize(v);
+        covariances_.resize(compute_covariances_ ? v : 0);
+        pool_->parallelFor(0, v, GRAIN, [this](const std::size_t,
+                                               const std::size_t begin,
+                                               const std::size_t end) {
+            for (std::size_t i = begin ; i < end ; ++i) {
+                const accumulator_t &a = *voxels_[i];
+                points_[i] = point_t(mode_ == VoxelFilterMode::CENTROID ? a.mean : a.first);
+                counts_[i] = a.n;
+                if (compute_covariances_)
+                    covariances_[i] = a.n > 1 ? covariance_t(a.squared / static_cast<double>(a.n - 1)) : covariance_t::Zero();
+            }
+        });
+    }
+
+    inline void apply(const typename pointcloud_t::ConstPtr &points)
+    {
+        apply(points->begin(), points->end());
+    }
+
+    /**
+     * @brief Downsample a cloud into a new cloud.
+     */
+    inline typename pointcloud_t::Ptr filter(const typename pointcloud_t::ConstPtr &points)
+    {
+        apply(points);
+        typename pointcloud_t::Ptr filtered(new pointcloud_t);
+        for (const point_t &p : points_)
+            filtered->insert(p);
+        return filtered;
+    }
+
+    inline std::size_t size() const
+    {
+        return points_.size();
+    }
+
+    inline const point_array_t& points() const
+    {
+        return points_;
+    }
+
+    inline const std::vector<std::size_t>& counts() const
+    {
+        return counts_;
+    }
+
+    /**
+     * @brief Sample covariances of the voxels, empty unless enabled on construction.
+     */
+    inline const covariance_array_t& covariances() const
+    {
+        return covariances_;
+    }
+
+    inline index_t getIndex(const point_t &p) const
+    {
+        index_t index;
+        for (std::size_t i = 0 ; i < Dim ; ++i)
+            index[i] = static_cast<int>(std::floor(p(i) * resolution_inv_));
+        return index;
+    }
+
+private:
+    static constexpr std::size_t GRAIN = 4096;
+
+    using hash_t = cslibs_ndt::common::IndexHash<Dim>;
+
+    /// the upper bits select the shard, the lower ones are left to the bucket selection
+    static inline std::size_t shard(const index_t &index, const std::size_t shards)
+    {
+        return (hash_t()(index) >> 24) % shards;
+    }
+
+    /// mean and scatter are merged with the pairwise update of Chan et al.
+    struct EIGEN_ALIGN16 accumulator_t {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        std::size_t  n           = 0;
+        std::size_t  first_index = std::numeric_limits<std::size_t>::max();
+        mean_t       first       = mean_t::Zero();
+        mean_t       mean        = mean_t::Zero();
+        covariance_t squared     = covariance_t::Zero();
+
+        inline void add(const mean_t &p, const std::size_t index, const bool scatter)
+        {
+            ++n;
+            const mean_t delta = p - mean;
+            mean += delta / static_cast<double>(n);
+            if (scatter)
+                squared += delta * (p - mean).transpose();
+            if (index < first_index) {
+                first_index = index;
+                first       = p;
+            }
+        }
+
+        inline void merge(const accumulator_t &other, const bool scatter)
+        {
+            if (other.n == 0)
+                return;
+            const std::size_t n_merged = n + other.n;
+            const mean_t      delta    = other.mean - mean;
+            if (scatter)
+                squared += other.squared + delta * delta.transpose() *
+                        (static_cast<double>(n) * static_cast<double>(other.n) / static_cast<double>(n_merged));
+            mean += delta * (static_cast<double>(other.n) / static_cast<double>(n_merged));
+            n = n_merged;
+            if (other.first_index < first_index) {
+                first_index = other.first_index;
+                first       = other.first;
+            }
+        }
+    };
+
+    using table_t = std::unordered_map<index_t, accumulator_t, hash_t, std::equal_to<index_t>,
+                                       Eigen::aligned_allocator<std::pair<const index_t, accumulator_t>>>;
+
+    double                              resolution_inv_;
+    VoxelFilterMode                     mode_;
+    bool                                compute_covariances_;
+    pool_t::Ptr                         pool_;
+
+    std::vector<std::vector<table_t>>   tables_;
+    std::vector<const accumulator_t*>   voxels_;
+
+    point_array_t                       points_;
+    std::vector<std::size_t>            counts_;
+    covariance_array_t                  covariances_;
+};
+}
+}
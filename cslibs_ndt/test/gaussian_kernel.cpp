@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+using cslibs_ndt::common::Kernel;
+
+/// std::isnan is folded to false with -ffinite-math-only, which the release flags imply
+bool isNaN(const double x)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x7fffffffffffffffull) > 0x7ff0000000000000ull;
+}
+
+TEST(Test_cslibs_ndt, testApproximateExpRelativeError)
+{
+    double max_error = 0.0;
+    for (double x = -708.0 ; x <= 709.0 ; x += 1e-3) {
+        const double exact = std::exp(x);
+        max_error = std::max(max_error, std::fabs(cslibs_ndt::common::approximateExp(x) - exact) / exact);
+    }
+    EXPECT_LT(max_error, 4e-6);
+    EXPECT_EQ(cslibs_ndt::common::approximateExp(0.0), 1.0);
+}
+
+TEST(Test_cslibs_ndt, testApproximateExpOutOfRange)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    EXPECT_EQ(cslibs_ndt::common::approximateExp(-1000.0), 0.0);
+    EXPECT_EQ(cslibs_ndt::common::approximateExp(-inf), 0.0);
+    EXPECT_EQ(cslibs_ndt::common::approximateExp(1000.0), inf);
+    EXPECT_EQ(cslibs_ndt::common::approximateExp(inf), inf);
+    EXPECT_TRUE(isNaN(cslibs_ndt::common::approximateExp(std::numeric_limits<double>::quiet_NaN())));
+}
+
+TEST(Test_cslibs_ndt, testGaussianCutoff)
+{
+    const double below = cslibs_ndt::common::GAUSSIAN_LOG_CUTOFF - 1e-9;
+    const double above = cslibs_ndt::common::GAUSSIAN_LOG_CUTOFF + 1e-9;
+
+    EXPECT_NEAR(std::exp(cslibs_ndt::common::GAUSSIAN_LOG_CUTOFF), cslibs_ndt::common::GAUSSIAN_CUTOFF, 1e-15);
+
+    /// the exact kernel never rejects unless asked to
+    EXPECT_EQ(cslibs_ndt::common::gaussian(below, Kernel::EXACT), std::exp(below));
+    EXPECT_EQ(cslibs_ndt::common::gaussian(-0.5, Kernel::EXACT), std::exp(-0.5));
+    EXPECT_EQ(cslibs_ndt::common::gaussianCutoff(below, Kernel::EXACT), 0.0);
+    EXPECT_EQ(cslibs_ndt::common::gaussianCutoff(above, Kernel::EXACT), std::exp(above));
+
+    EXPECT_EQ(cslibs_ndt::common::gaussian(below, Kernel::APPROXIMATE), 0.0);
+    EXPECT_EQ(cslibs_ndt::common::gaussianCutoff(below, Kernel::APPROXIMATE), 0.0);
+    EXPECT_NEAR(cslibs_ndt::common::gaussian(above, Kernel::APPROXIMATE), std::exp(above), 4e-6 * std::exp(above));
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
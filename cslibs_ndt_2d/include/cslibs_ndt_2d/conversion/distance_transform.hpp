@@ -0,0 +1,174 @@
+#ifndef CSLIBS_NDT_2D_CONVERSION_DISTANCE_TRANSFORM_HPP
+#define CSLIBS_NDT_2D_CONVERSION_DISTANCE_TRANSFORM_HPP
+
+#include <cslibs_ndt/common/thread_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace cslibs_ndt_2d {
+namespace conversion {
+/**
+ * @brief Exact euclidean distance transform of a binary grid, separated into a pass over
+ *        the columns and a pass over the rows, following Felzenszwalb and Huttenlocher,
+ *        "Distance Transforms of Sampled Functions". Both passes are split across the pool,
+ *        blocks of columns are swept row by row to keep the memory accesses contiguous.
+ *
+ *        Distances are clamped to the maximum distance, column distances beyond it are
+ *        clamped as well, which keeps the row pass exact below the maximum and bounds the
+ *        squared distances. The result is mapped cell by cell in the row pass, e.g. to a
+ *        likelihood, so no further pass over the grid is needed.
+ */
+class DistanceTransform
+{
+public:
+    /**
+     * @param resolution       - the cell size
+     * @param maximum_distance - distances are clamped to this value
+     */
+    inline explicit DistanceTransform(const double resolution,
+                                      const double maximum_distance) :
+        resolution_(resolution),
+        maximum_distance_(maximum_distance),
+        maximum_cells_(static_cast<std::size_t>(std::ceil(maximum_distance / resolution)) + 1)
+    {
+    }
+
+    /**
+     * @brief Distances to the nearest occupied cell.
+     * @param occupied  - row major, non zero for occupied cells
+     * @param width     - cells per row
+     * @param distances - the output, resized to the size of the input
+     * @param pool      - the pool to split both passes across
+     */
+    inline void apply(const std::vector<std::uint8_t> &occupied,
+                      const std::size_t width,
+                      std::vector<double> &distances,
+                      const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault()) const
+    {
+        apply(occupied, width, distances, [](const double d) { return d; }, pool);
+    }
+
+    /**
+     * @brief Distances to the nearest occupied cell, mapped by map(distance).
+     * @param occupied  - row major, non zero for occupied cells
+     * @param width     - cells per row
+     * @param distances - the output, resized to the size of the input
+     * @param map       - map(distance) is stored instead of the distance, called concurrently
+     * @param pool      - the pool to split both passes across
+     */
+    template<typename map_fn_t>
+    inline void apply(const std::vector<std::uint8_t> &occupied,
+                      const std::size_t width,
+                      std::vector<double> &distances,
+                      const map_fn_t &map,
+                      const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault()) const
+    {
+        distances.resize(occupied.size());
+        if (width == 0 || occupied.empty())
+            return;
+
+        const std::size_t height = occupied.size() / width;
+        const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
+
+        /// column pass, cells to the nearest occupied cell in the same column
+        p->parallelFor(0, width, COLUMN_BLOCK, [this, &occupied, &distances, width, height]
+                       (const std::size_t, const std::size_t b, const std::size_t e) {
+            columns(occupied, width, height, b, e, distances);
+        });
+
+        /// row pass, the lower envelope of the parabolas rooted at the column distances
+        p->parallelFor(0, height, ROW_BLOCK, [this, &distances, &map, width]
+                       (const std::size_t, const std::size_t b, const std::size_t e) {
+            std::vector<double>      f(width);
+            std::vector<std::size_t> v(width);
+            std::vector<double>      z(width + 1);
+            for (std::size_t y = b ; y < e ; ++y)
+                row(&distances[y * width], width, map, f, v, z);
+        });
+    }
+
+private:
+    static constexpr std::size_t COLUMN_BLOCK = 64;
+    static constexpr std::size_t ROW_BLOCK    = 16;
+
+    const double      resolution_;
+    const double      maximum_distance_;
+    const std::size_t maximum_cells_;
+
+    inline void columns(const std::vector<std::uint8_t> &occupied,
+                        const std::size_t width,
+                        const std::size_t height,
+                        const std::size_t begin,
+                        const std::size_t end,
+                        std::vector<double> &g) const
+    {
+        const double limit = static_cast<double>(maximum_cells_);
+        for (std::size_t x = begin ; x < end ; ++x)
+            g[x] = occupied[x] ? 0.0 : limit;
+
+        for (std::size_t y = 1 ; y < height ; ++y) {
+            const std::uint8_t *o    = &occupied[y * width];
+            const double       *prev = &g[(y - 1) * width];
+            double             *curr = &g[y * width];
+            for (std::size_t x = begin ; x < end ; ++x)
+                curr[x] = o[x] ? 0.0 : std::min(prev[x] + 1.0, limit);
+        }
+
+        for (std::size_t y = height - 1 ; y-- > 0 ;) {
+            const double *next = &g[(y + 1) * width];
+            double       *curr = &g[y * width];
+            for (std::size_t x = begin ; x < end ; ++x)
+                curr[x] = std::min(curr[x], next[x] + 1.0);
+        }
+    }
+
+    template<typename map_fn_t>
+    inline void row(double *d,
+                    const std::size_t width,
+                    const map_fn_t &map,
+                    std::vector<double> &f,
+                    std::vector<std::size_t> &v,
+                    std::vector<double> &z) const
+    {
+        for (std::size_t q = 0 ; q < width ; ++q)
+            f[q] = d[q] * d[q];
+
+        auto intersection = [&f](const std::size_t q, const std::size_t r) {
+            const double dq = static_cast<double>(q);
+            const double dr = static_cast<double>(r);
+            return ((f[q] + dq * dq) - (f[r] + dr * dr)) / (2.0 * (dq - dr));
+        };
+
+        std::size_t k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<double>::infinity();
+        z[1] =  std::numeric_limits<double>::infinity();
+        for (std::size_t q = 1 ; q < width ; ++q) {
+            double s = intersection(q, v[k]);
+            while (s <= z[k]) {
+                --k;
+                s = intersection(q, v[k]);
+            }
+            ++k;
+            v[k]     = q;
+            z[k]     = s;
+            z[k + 1] = std::numeric_limits<double>::infinity();
+        }
+
+        k = 0;
+        for (std::size_t q = 0 ; q < width ; ++q) {
+            while (z[k + 1] < static_cast<double>(q))
+                ++k;
+            const double dq = static_cast<double>(q) - static_cast<double>(v[k]);
+            d[q] = map(std::min(std::sqrt(dq * dq + f[v[k]]) * resolution_, maximum_distance_));
+        }
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CONVERSION_DISTANCE_TRANSFORM_HPP
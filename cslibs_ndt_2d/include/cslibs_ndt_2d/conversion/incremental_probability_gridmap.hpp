@@ -0,0 +1,167 @@
+#ifndef CSLIBS_NDT_2D_CONVERSION_INCREMENTAL_PROBABILITY_GRIDMAP_HPP
+#define CSLIBS_NDT_2D_CONVERSION_INCREMENTAL_PROBABILITY_GRIDMAP_HPP
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <cslibs_ndt/common/incremental_grid.hpp>
+
+#include <cslibs_ndt_2d/conversion/probability_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/rasterization.hpp>
+
+namespace cslibs_ndt_2d {
+namespace conversion {
+/**
+ * @brief Keeps a ProbabilityGridmap of a dynamic 2D map up to date for repeated publishing.
+ *        Only the bundles changed since the previous update are sampled again, the changes
+ *        are taken from the dirty bundle record of the map, which the first update claims.
+ *        A record has a single consumer, another one taking it over makes the next update
+ *        sample everything again. Cells equal those of from(src, dst, sampling_resolution, true).
+ *
+ *        The output grows as an IncrementalGrid of bundles, it may thus extend beyond the
+ *        map, those cells are 0. The map must not be changed during an update.
+ */
+template<typename map_t>
+class IncrementalProbabilityGridmap
+{
+public:
+    using Ptr            = std::shared_ptr<IncrementalProbabilityGridmap>;
+    using index_t        = typename map_t::index_t;
+    using point_t        = typename map_t::point_t;
+    using pose_t         = typename map_t::pose_t;
+    using distribution_t = typename map_t::distribution_t;
+    using dst_map_t      = cslibs_gridmaps::static_maps::ProbabilityGridmap;
+    using weight_t       = std::function<double(const distribution_t &)>;
+    using grid_t         = cslibs_ndt::common::IncrementalGrid<dst_map_t>;
+    using Region         = typename grid_t::Region;
+
+    /**
+     * @brief Unweighted distributions, as for dynamic_maps::Gridmap.
+     * @param sampling_resolution - the cell size of the output
+     * @param margin              - minimum growth of the output in bundles
+     */
+    inline explicit IncrementalProbabilityGridmap(const double sampling_resolution,
+                                                  const std::size_t margin = 16) :
+        IncrementalProbabilityGridmap(sampling_resolution,
+                                      [](const distribution_t &) { return 1.0; },
+                                      margin)
+    {
+    }
+
+    /**
+     * @brief Distributions weighted by their occupancy, as for the occupancy gridmaps.
+     * @param sampling_resolution - the cell size of the output
+     * @param inverse_model       - the inverse model to evaluate the occupancy
+     * @param margin              - minimum growth of the output in bundles
+     */
+    inline explicit IncrementalProbabilityGridmap(const double sampling_resolution,
+                                                  const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
+                                                  const std::size_t margin = 16) :
+        IncrementalProbabilityGridmap(sampling_resolution,
+                                      [inverse_model](const distribution_t &d) { return validate(d.getOccupancy(inverse_model)); },
+                                      margin)
+    {
+    }
+
+    /**
+     * @param sampling_resolution - the cell size of the output
+     * @param weight              - weight(d) scales the gaussian of distribution d, called concurrently
+     * @param margin              - minimum growth of the output in bundles
+     */
+    inline explicit IncrementalProbabilityGridmap(const double sampling_resolution,
+                                                  const weight_t &weight,
+                                                  const std::size_t margin = 16) :
+        sampling_resolution_(sampling_resolution),
+        weight_(weight),
+        grid_(margin)
+    {
+    }
+
+    /**
+     * @brief Sample the bundles changed since the last update, everything on the first one.
+     * @param map    - the map, always the same one
+     * @param kernel - how the gaussians are evaluated
+     * @param pool   - the changed bundles are sampled by this pool
+     * @return the changed cells
+     */
+    inline Region update(map_t &map,
+                         const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT,
+                         const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+    {
+        /// without a complete record of the changes everything is sampled again
+        std::vector<index_t> dirty;
+        grid_.takeChanges(map, dirty);
+
+        const BundleRasterization<map_t> bundles(map, sampling_resolution_, true);
+        const int chunk_step = bundles.getChunkStep();
+        if (dirty.empty() || chunk_step <= 0)
+            return Region();
+
+        std::vector<index_t> affected(dirty.begin(), dirty.end());
+        grid_t::dilate(affected);
+
+        /// lazily updated caches are filled serially, bundles without valid distributions stay 0
+        std::vector<index_t> sampled;
+        sampled.reserve(affected.size());
+        for (const index_t &bi : affected) {
+            if (bundles.prepare(bi, weight_))
+                sampled.emplace_back(bi);
+        }
+
+        index_t lo, hi;
+        if (!grid_t::bounds(sampled, lo, hi))
+            return Region();
+
+        const double bundle_resolution = map.getBundleResolution();
+        const pose_t initial_origin    = map.getInitialOrigin();
+        const bool reallocated = grid_.reserve(lo, hi, chunk_step, sampling_resolution_,
+                                               [&initial_origin, bundle_resolution](const index_t &min_bi) {
+            pose_t origin = initial_origin;
+            origin.translation() += point_t(min_bi[0] * bundle_resolution,
+                                            min_bi[1] * bundle_resolution);
+            return origin;
+        });
+
+        const dst_map_t::Ptr &dst = grid_.getGrid();
+        const index_t min_bi = grid_.getMin();
+        const weight_t &weight = weight_;
+        auto store = [&dst](const std::size_t x, const std::size_t y, const double v) {
+            dst->at(x, y) = validate(v);
+        };
+
+        const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
+        p->parallelFor(0, sampled.size(), 16,
+                       [&sampled, &bundles, &min_bi, &weight, &store, kernel](const std::size_t, const std::size_t b, const std::size_t e) {
+            for (std::size_t i = b ; i < e ; ++i)
+                bundles.rasterize(sampled[i], min_bi, weight, store, kernel);
+        });
+
+        return grid_.region(lo, hi, chunk_step, reallocated);
+    }
+
+    /**
+     * @brief The output, nullptr before the first update.
+     */
+    inline const dst_map_t::Ptr& getGridmap() const
+    {
+        return grid_.getGrid();
+    }
+
+    /**
+     * @brief Drop the output, the next update samples the whole map.
+     */
+    inline void reset()
+    {
+        grid_.reset();
+    }
+
+private:
+    const double   sampling_resolution_;
+    const weight_t weight_;
+    grid_t         grid_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CONVERSION_INCREMENTAL_PROBABILITY_GRIDMAP_HPP
@@ -4,11 +4,14 @@
 #include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
 #include <cslibs_ndt_2d/dynamic_maps/occupancy_gridmap.hpp>
 
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+
 #include <cslibs_ndt_2d/conversion/gridmap.hpp>
 #include <cslibs_ndt_2d/conversion/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/conversion/rasterization.hpp>
+#include <cslibs_ndt_2d/conversion/distance_transform.hpp>
 
 #include <cslibs_gridmaps/static_maps/likelihood_field_gridmap.h>
-#include <cslibs_gridmaps/static_maps/algorithms/distance_transform.hpp>
 
 namespace cslibs_ndt_2d {
 namespace conversion {
@@ -18,56 +21,43 @@ inline void from(
         const double &sampling_resolution,
         const double &maximum_distance = 2.0,
         const double &sigma_hit        = 0.5,
-        const double &threshold        = 0.169)
+        const double &threshold        = 0.169,
+        const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT,
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     if (!src)
         return;
-    src->allocatePartiallyAllocatedBundles();
 
     assert(threshold <= 1.0);
     assert(threshold >= 0.0);
     const double exp_factor_hit = (0.5 * 1.0 / (sigma_hit * sigma_hit));
 
     using src_map_t = cslibs_ndt_2d::dynamic_maps::Gridmap;
-    using dst_map_t = cslibs_gridmaps::static_maps::ProbabilityGridmap;
-    dst.reset(new dst_map_t(src->getOrigin(),
-                            sampling_resolution,
-                            std::ceil(src->getHeight() / sampling_resolution),
-                            std::ceil(src->getWidth()  / sampling_resolution)));
-    std::fill(dst->getData().begin(), dst->getData().end(), 0);
-
-    const double bundle_resolution = src->getBundleResolution();
-    const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
-
-    auto sample = [](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
-        return 0.25 * (bundle.at(0)->data().sampleNonNormalized(p) +
-                       bundle.at(1)->data().sampleNonNormalized(p) +
-                       bundle.at(2)->data().sampleNonNormalized(p) +
-                       bundle.at(3)->data().sampleNonNormalized(p));
+    using dst_map_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap;
+
+    auto weight = [](const src_map_t::distribution_t &) {
+        return 1.0;
     };
+    const Rasterization<src_map_t> raster(*src, sampling_resolution, true, weight);
 
-    using index_t = std::array<int, 2>;
-    const index_t min_bi = src->getMinBundleIndex();
-
-    src->traverse([&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
-        for (int k = 0 ; k < chunk_step ; ++ k) {
-            for (int l = 0 ; l < chunk_step ; ++ l) {
-                const cslibs_math_2d::Point2d p(bi[0] * bundle_resolution + k * sampling_resolution,
-                                                bi[1] * bundle_resolution + l * sampling_resolution);
-                dst->at((bi[0] - min_bi[0]) * chunk_step + k, (bi[1] - min_bi[1]) * chunk_step + l) = sample(p, b);
-            }
-        }
-    });
-
-    std::vector<double> occ = dst->getData();
-    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<double> distance_transform(
-                sampling_resolution, maximum_distance, threshold);
-    distance_transform.apply(occ, dst->getWidth(), dst->getData());
-
-    std::for_each(dst->getData().begin(),
-                  dst->getData().end(),
-                  [&exp_factor_hit] (double &z) {z = std::exp(-z * z * exp_factor_hit);});
+    dst.reset(new dst_map_t(raster.getOrigin(),
+                            sampling_resolution,
+                            std::ceil(raster.getHeight() / sampling_resolution),
+                            std::ceil(raster.getWidth()  / sampling_resolution),
+                            maximum_distance,
+                            sigma_hit));
+
+    /// thresholded while rasterizing, the likelihoods are written straight into the output
+    const std::size_t width = dst->getWidth();
+    std::vector<std::uint8_t> occupied(dst->getData().size(), 0.0 >= threshold);
+    raster.apply(weight, [&occupied, &threshold, width](const std::size_t x, const std::size_t y, const double v) {
+        occupied[y * width + x] = v >= threshold;
+    }, kernel, pool);
+
+    const DistanceTransform distance_transform(sampling_resolution, maximum_distance);
+    distance_transform.apply(occupied, width, dst->getData(), [&exp_factor_hit, kernel](const double z) {
+        return cslibs_ndt::common::gaussian(-z * z * exp_factor_hit, kernel);
+    }, pool);
 }
 
 inline void from(
@@ -77,64 +67,43 @@ inline void from(
         const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
         const double &maximum_distance = 2.0,
         const double &sigma_hit        = 0.5,
-        const double &threshold        = 0.169)
+        const double &threshold        = 0.169,
+        const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT,
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     if (!src || !inverse_model)
         return;
-    src->allocatePartiallyAllocatedBundles();
 
     assert(threshold <= 1.0);
     assert(threshold >= 0.0);
     const double exp_factor_hit = (0.5 * 1.0 / (sigma_hit * sigma_hit));
 
     using src_map_t = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap;
-    using dst_map_t = cslibs_gridmaps::static_maps::ProbabilityGridmap;
-    dst.reset(new dst_map_t(src->getOrigin(),
-                            sampling_resolution,
-                            std::ceil(src->getHeight() / sampling_resolution),
-                            std::ceil(src->getWidth()  / sampling_resolution)));
-    std::fill(dst->getData().begin(), dst->getData().end(), 0);
-
-    const double bundle_resolution = src->getBundleResolution();
-    const int chunk_step = static_cast<int>(bundle_resolution / sampling_resolution);
-
-    auto sample = [&inverse_model](const cslibs_math_2d::Point2d &p, const src_map_t::distribution_bundle_t &bundle) {
-        auto sample = [&p, &inverse_model](const src_map_t::distribution_t *d) {
-            auto do_sample = [&p, &inverse_model, &d]() {
-                const auto &handle = d;
-                return handle->getDistribution() ?
-                            handle->getDistribution()->sampleNonNormalized(p) * handle->getOccupancy(inverse_model) : 0.0;
-            };
-            return d ? do_sample() : 0.0;
-        };
-        return 0.25 * (sample(bundle.at(0)) +
-                       sample(bundle.at(1)) +
-                       sample(bundle.at(2)) +
-                       sample(bundle.at(3)));
+    using dst_map_t = cslibs_gridmaps::static_maps::LikelihoodFieldGridmap;
+
+    auto weight = [&inverse_model](const src_map_t::distribution_t &d) {
+        return d.getOccupancy(inverse_model);
     };
+    const Rasterization<src_map_t> raster(*src, sampling_resolution, true, weight);
 
-    using index_t = std::array<int, 2>;
-    const index_t min_bi = src->getMinBundleIndex();
-
-    src->traverse([&dst, &bundle_resolution, &sampling_resolution, &chunk_step, &min_bi, &sample]
-                  (const index_t &bi, const src_map_t::distribution_bundle_t &b){
-        for (int k = 0 ; k < chunk_step ; ++ k) {
-            for (int l = 0 ; l < chunk_step ; ++ l) {
-                const cslibs_math_2d::Point2d p(bi[0] * bundle_resolution + k * sampling_resolution,
-                                                bi[1] * bundle_resolution + l * sampling_resolution);
-                dst->at((bi[0] - min_bi[0]) * chunk_step + k, (bi[1] - min_bi[1]) * chunk_step + l) = sample(p, b);
-            }
-        }
-    });
-
-    std::vector<double> occ = dst->getData();
-    cslibs_gridmaps::static_maps::algorithms::DistanceTransform<double> distance_transform(
-                sampling_resolution, maximum_distance, threshold);
-    distance_transform.apply(occ, dst->getWidth(), dst->getData());
-
-    std::for_each(dst->getData().begin(),
-                  dst->getData().end(),
-                  [&exp_factor_hit] (double &z) {z = std::exp(-z * z * exp_factor_hit);});
+    dst.reset(new dst_map_t(raster.getOrigin(),
+                            sampling_resolution,
+                            std::ceil(raster.getHeight() / sampling_resolution),
+                            std::ceil(raster.getWidth()  / sampling_resolution),
+                            maximum_distance,
+                            sigma_hit));
+
+    /// thresholded while rasterizing, the likelihoods are written straight into the output
+    const std::size_t width = dst->getWidth();
+    std::vector<std::uint8_t> occupied(dst->getData().size(), 0.0 >= threshold);
+    raster.apply(weight, [&occupied, &threshold, width](const std::size_t x, const std::size_t y, const double v) {
+        occupied[y * width + x] = v >= threshold;
+    }, kernel, pool);
+
+    const DistanceTransform distance_transform(sampling_resolution, maximum_distance);
+    distance_transform.apply(occupied, width, dst->getData(), [&exp_factor_hit, kernel](const double z) {
+        return cslibs_ndt::common::gaussian(-z * z * exp_factor_hit, kernel);
+    }, pool);
 }
 }
 }
@@ -0,0 +1,365 @@
+#ifndef CSLIBS_NDT_2D_CONVERSION_RASTERIZATION_HPP
+#define CSLIBS_NDT_2D_CONVERSION_RASTERIZATION_HPP
+
+#include <cslibs_ndt/common/distribution.hpp>
+#include <cslibs_ndt/common/occupancy_distribution.hpp>
+#include <cslibs_ndt/common/weighted_occupancy_distribution.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+
+#include <cslibs_math/common/array.hpp>
+
+#include <array>
+#include <cmath>
+
+namespace cslibs_ndt_2d {
+namespace conversion {
+namespace impl {
+/// the gaussian of a distribution wrapper, nullptr if there is none
+inline const cslibs_ndt::Distribution<2>::distribution_t* statistics(const cslibs_ndt::Distribution<2> &d)
+{
+    return &d.data();
+}
+
+inline const cslibs_ndt::OccupancyDistribution<2>::distribution_t* statistics(const cslibs_ndt::OccupancyDistribution<2> &d)
+{
+    return d.getDistribution().get();
+}
+
+inline const cslibs_ndt::WeightedOccupancyDistribution<2>::distribution_t* statistics(const cslibs_ndt::WeightedOccupancyDistribution<2> &d)
+{
+    return d.getDistribution().get();
+}
+
+/// whether allocatePartiallyAllocatedBundles of the map allocates the neighbours of a bundle containing d
+inline bool expands(const cslibs_ndt::Distribution<2> &d)
+{
+    return d.data().getN() >= 3;
+}
+
+inline bool expands(const cslibs_ndt::OccupancyDistribution<2> &d)
+{
+    return d.getDistribution() && d.getDistribution()->getN() >= 3;
+}
+
+inline bool expands(const cslibs_ndt::WeightedOccupancyDistribution<2> &d)
+{
+    return d.getDistribution() && d.getDistribution()->getSampleCount() > 0;
+}
+}
+
+/**
+ * @brief Samples single bundles of a dynamic 2D map onto the cells they cover. A cell holds
+ *            0.25 * sum_i w_i * exp(-0.5 * (p - mean_i)^T information_i (p - mean_i))
+ *        over the valid distributions of its bundle, the quadratic forms are set up once per
+ *        bundle instead of once per cell and distribution. Bundles are only read, sampling
+ *        is safe to run concurrently once the lazily updated caches are filled by prepare.
+ */
+template<typename map_t>
+class BundleRasterization
+{
+public:
+    using index_t        = typename map_t::index_t;
+    using distribution_t = typename map_t::distribution_t;
+    using bundle_t       = typename map_t::distribution_const_bundle_t::data_t;
+
+    /**
+     * @param map                 - the map to sample
+     * @param sampling_resolution - the cell size of the output
+     * @param all_bundles         - also sample bundles which were never allocated, through the
+     *                              distributions they share with their neighbours
+     */
+    inline explicit BundleRasterization(const map_t &map,
+                                        const double sampling_resolution,
+                                        const bool all_bundles) :
+        map_(map),
+        sampling_resolution_(sampling_resolution),
+        bundle_resolution_(map.getBundleResolution()),
+        chunk_step_(static_cast<int>(map.getBundleResolution() / sampling_resolution)),
+        all_bundles_(all_bundles)
+    {
+    }
+
+    /**
+     * @brief Cells per bundle side.
+     */
+    inline int getChunkStep() const
+    {
+        return chunk_step_;
+    }
+
+    /**
+     * @brief Fill the lazily updated caches of a distribution, not thread safe.
+     * @param weight - the weight function later passed to rasterize
+     */
+    template<typename weight_fn_t>
+    inline void prepare(const distribution_t &d,
+                        const weight_fn_t &weight) const
+    {
+        weight(d);
+        if (const auto *s = impl::statistics(d)) {
+            if (s->valid())
+                s->getInformationMatrix();
+        }
+    }
+
+    /**
+     * @brief Fill the lazily updated caches of the distributions of a bundle, not thread safe.
+     * @return if the bundle has a valid distribution, i.e. if rasterize writes any cell
+     */
+    template<typename weight_fn_t>
+    inline bool prepare(const index_t &bi,
+                        const weight_fn_t &weight) const
+    {
+        bundle_t bundle;
+        if (!lookup(bi, bundle))
+            return false;
+
+        bool valid = false;
+        for (const distribution_t *d : bundle) {
+            if (!d)
+                continue;
+            prepare(*d, weight);
+            const auto *s = impl::statistics(*d);
+            valid |= s && s->valid();
+        }
+        return valid;
+    }
+
+    /**
+     * @brief Sample the cells of a bundle.
+     * @param bi     - the bundle index
+     * @param min_bi - the bundle at the origin of the output
+     * @param weight - weight(d) scales the gaussian of distribution d
+     * @param store  - store(x, y, value) with cell indices relative to min_bi
+     * @param kernel - how the gaussians are evaluated
+     * @return false, without storing anything, if the bundle has no valid distribution
+     */
+    template<typename weight_fn_t, typename store_fn_t>
+    inline bool rasterize(const index_t &bi,
+                          const index_t &min_bi,
+                          const weight_fn_t &weight,
+                          const store_fn_t &store,
+                          const cslibs_ndt::common::Kernel kernel) const
+    {
+        std::array<Form, 4> forms;
+        const std::size_t n = setup(bi, weight, forms);
+        if (n == 0)
+            return false;
+
+        for (int k = 0 ; k < chunk_step_ ; ++ k) {
+            const double x = bi[0] * bundle_resolution_ + k * sampling_resolution_;
+            for (int l = 0 ; l < chunk_step_ ; ++ l) {
+                const double y = bi[1] * bundle_resolution_ + l * sampling_resolution_;
+                double value = 0.0;
+                for (std::size_t i = 0 ; i < n ; ++i)
+                    value += forms[i].weight * cslibs_ndt::common::gaussian(forms[i].exponent(x, y), kernel);
+                store(static_cast<std::size_t>((bi[0] - min_bi[0]) * chunk_step_ + k),
+                      static_cast<std::size_t>((bi[1] - min_bi[1]) * chunk_step_ + l),
+                      0.25 * value);
+            }
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief Quadratic form of one distribution, the exponent at (x, y) is
+     *        xx dx^2 + xy dx dy + yy dy^2 with (dx, dy) = (x, y) - mean.
+     */
+    struct Form
+    {
+        double mx;
+        double my;
+        double xx;
+        double xy;
+        double yy;
+        double weight;
+
+        inline double exponent(const double x, const double y) const
+        {
+            const double dx = x - mx;
+            const double dy = y - my;
+            return xx * dx * dx + xy * dx * dy + yy * dy * dy;
+        }
+    };
+
+    const map_t &map_;
+    const double sampling_resolution_;
+    const double bundle_resolution_;
+    const int    chunk_step_;
+    const bool   all_bundles_;
+
+    inline bool lookup(const index_t &bi,
+                       bundle_t &bundle) const
+    {
+        if (all_bundles_)
+            return map_.lookupDistributionBundle(bi, bundle);
+
+        const typename map_t::distribution_bundle_t *b = map_.get(bi);
+        if (!b)
+            return false;
+        std::copy(b->begin(), b->end(), bundle.begin());
+        return true;
+    }
+
+    template<typename weight_fn_t>
+    inline std::size_t setup(const index_t &bi,
+                             const weight_fn_t &weight,
+                             std::array<Form, 4> &forms) const
+    {
+        bundle_t bundle;
+        if (!lookup(bi, bundle))
+            return 0;
+
+        std::size_t n = 0;
+        for (const distribution_t *d : bundle) {
+            if (!d)
+                continue;
+            const auto *s = impl::statistics(*d);
+            if (!s || !s->valid())
+                continue;
+
+            const Eigen::Vector2d mean = s->getMean();
+            const Eigen::Matrix2d info = s->getInformationMatrix();
+            Form &f  = forms[n++];
+            f.mx     = mean(0);
+            f.my     = mean(1);
+            f.xx     = -0.5 * info(0, 0);
+            f.xy     = -0.5 * (info(0, 1) + info(1, 0));
+            f.yy     = -0.5 * info(1, 1);
+            f.weight = weight(*d);
+        }
+        return n;
+    }
+};
+
+/**
+ * @brief Samples the bundles of a dynamic 2D map onto a regular grid, as the conversions
+ *        to cslibs_gridmaps do. The map is only read, bundles which were never allocated are
+ *        evaluated through the non-allocating bundle lookup, which yields the same values
+ *        and extent as calling allocatePartiallyAllocatedBundles beforehand.
+ *
+ *        The bundle range is split into square tiles which are rasterized in parallel, every
+ *        cell is written by exactly one tile. Cells are sampled by BundleRasterization.
+ */
+template<typename map_t>
+class Rasterization
+{
+public:
+    using index_t        = typename map_t::index_t;
+    using pose_t         = typename map_t::pose_t;
+    using point_t        = typename map_t::point_t;
+    using distribution_t = typename map_t::distribution_t;
+
+    /// bundles per tile side
+    static constexpr int TILE_SIZE = 16;
+
+    /**
+     * @param map                 - the map to sample
+     * @param sampling_resolution - the cell size of the output
+     * @param all_bundles         - also sample the bundles allocatePartiallyAllocatedBundles would allocate
+     * @param weight              - weight(d) scales the gaussian of distribution d, e.g. by its occupancy
+     */
+    template<typename weight_fn_t>
+    inline explicit Rasterization(const map_t &map,
+                                  const double sampling_resolution,
+                                  const bool all_bundles,
+                                  const weight_fn_t &weight) :
+        map_(map),
+        bundles_(map, sampling_resolution, all_bundles),
+        bundle_resolution_(map.getBundleResolution()),
+        all_bundles_(all_bundles),
+        min_bi_(map.getMinBundleIndex()),
+        max_bi_(map.getMaxBundleIndex())
+    {
+        /// lazily updated caches of the distributions are filled here, the parallel pass only reads them
+        map.traverse([this, &weight](const index_t &bi, const typename map_t::distribution_bundle_t &b) {
+            bool expand = false;
+            for (const distribution_t *d : b) {
+                if (!d)
+                    continue;
+                expand |= impl::expands(*d);
+                bundles_.prepare(*d, weight);
+            }
+            if (all_bundles_ && expand) {
+                min_bi_ = std::min(min_bi_, index_t{{bi[0] - 1, bi[1] - 1}});
+                max_bi_ = std::max(max_bi_, index_t{{bi[0] + 1, bi[1] + 1}});
+            }
+        });
+    }
+
+    /**
+     * @brief The origin of the output, like the one of the map after allocating all bundles.
+     */
+    inline pose_t getOrigin() const
+    {
+        pose_t origin = map_.getInitialOrigin();
+        origin.translation() += point_t(min_bi_[0] * bundle_resolution_,
+                                        min_bi_[1] * bundle_resolution_);
+        return origin;
+    }
+
+    inline double getHeight() const
+    {
+        return (max_bi_[1] - min_bi_[1] + 1) * bundle_resolution_;
+    }
+
+    inline double getWidth() const
+    {
+        return (max_bi_[0] - min_bi_[0] + 1) * bundle_resolution_;
+    }
+
+    /**
+     * @brief Sample all cells covered by bundles.
+     * @param weight - weight(d) scales the gaussian of distribution d, called concurrently
+     * @param store  - store(x, y, value) with cell indices relative to the origin, called
+     *                 concurrently but never twice for the same cell; cells of bundles without
+     *                 any valid distribution are skipped
+     * @param kernel - how the gaussians are evaluated
+     * @param pool   - the tiles are processed by this pool
+     */
+    template<typename weight_fn_t, typename store_fn_t>
+    inline void apply(const weight_fn_t &weight,
+                      const store_fn_t &store,
+                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT,
+                      const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault()) const
+    {
+        if (max_bi_[0] < min_bi_[0] || max_bi_[1] < min_bi_[1] || bundles_.getChunkStep() <= 0)
+            return;
+
+        const int tiles_x = (max_bi_[0] - min_bi_[0]) / TILE_SIZE + 1;
+        const int tiles_y = (max_bi_[1] - min_bi_[1]) / TILE_SIZE + 1;
+
+        auto rasterize_tile = [this, &weight, &store, kernel, tiles_x](const int tile) {
+            const int bx_begin = min_bi_[0] + (tile % tiles_x) * TILE_SIZE;
+            const int by_begin = min_bi_[1] + (tile / tiles_x) * TILE_SIZE;
+            const int bx_end   = std::min(bx_begin + TILE_SIZE, max_bi_[0] + 1);
+            const int by_end   = std::min(by_begin + TILE_SIZE, max_bi_[1] + 1);
+
+            for (int by = by_begin ; by < by_end ; ++by) {
+                for (int bx = bx_begin ; bx < bx_end ; ++bx)
+                    bundles_.rasterize(index_t{{bx, by}}, min_bi_, weight, store, kernel);
+            }
+        };
+
+        const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
+        p->parallelFor(0, static_cast<std::size_t>(tiles_x * tiles_y), 1,
+                       [&rasterize_tile](const std::size_t, const std::size_t b, const std::size_t e) {
+            for (std::size_t t = b ; t < e ; ++t)
+                rasterize_tile(static_cast<int>(t));
+        });
+    }
+
+private:
+    const map_t                    &map_;
+    const BundleRasterization<map_t> bundles_;
+    const double                     bundle_resolution_;
+    const bool                       all_bundles_;
+    index_t                          min_bi_;
+    index_t                          max_bi_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CONVERSION_RASTERIZATION_HPP
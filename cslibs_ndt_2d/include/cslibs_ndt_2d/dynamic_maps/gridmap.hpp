@@ -1,16 +1,20 @@
 #ifndef CSLIBS_NDT_2D_DYNAMIC_MAPS_GRIDMAP_HPP
 #define CSLIBS_NDT_2D_DYNAMIC_MAPS_GRIDMAP_HPP
 
+#include <cassert>
 #include <array>
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <unordered_set>
 
 #include <cslibs_math_2d/linear/pose.hpp>
 #include <cslibs_math_2d/linear/point.hpp>
 
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+#include <cslibs_ndt/common/index_hash.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -45,6 +49,7 @@ public:
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 4>;
     using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::kdtree::KDTree>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
+    using dirty_bundle_set_t                = std::unordered_set<index_t, cslibs_ndt::common::IndexHash<2>>;
 
     inline Gridmap(const double resolution) :
         Gridmap(pose_t::identity(),
@@ -186,6 +191,7 @@ public:
     {
         const index_t bi = toBundleIndex(p);
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->data().add(p);
         bundle->at(1)->data().add(p);
         bundle->at(2)->data().add(p);
@@ -194,10 +200,18 @@ public:
 
     inline void insert(const typename cslibs_math::linear::Pointcloud<point_t>::ConstPtr &points,
                        const pose_t &points_origin = pose_t())
+    {
+        insert(points->begin(), points->end(), points_origin);
+    }
+
+    template<typename iterator_t>
+    inline void insert(const iterator_t &points_begin,
+                       const iterator_t &points_end,
+                       const pose_t &points_origin = pose_t())
     {
         distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = points_origin * p;
+        for (auto itr = points_begin ; itr != points_end ; ++itr) {
+            const point_t pm = points_origin * *itr;
             if (pm.isNormal()) {
                 const index_t &bi = toBundleIndex(pm);
                 distribution_t *d = storage.get(bi);
@@ -207,6 +221,7 @@ public:
 
         storage.traverse([this](const index_t& bi, const distribution_t &d) {
             distribution_bundle_t *bundle = getAllocate(bi);
+            markDirty(bi);
             bundle->at(0)->data() += d.data();
             bundle->at(1)->data() += d.data();
             bundle->at(2)->data() += d.data();
@@ -244,21 +259,23 @@ public:
         return bundle ? evaluate() : 0.0;
     }
 
-    inline double sampleNonNormalized(const point_t &p) const
+    inline double sampleNonNormalized(const point_t &p,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         const index_t bi = toBundleIndex(p);
-        return sampleNonNormalized(p, bi);
+        return sampleNonNormalized(p, bi, kernel);
     }
 
     inline double sampleNonNormalized(const point_t &p,
-                                      const index_t &bi) const
+                                      const index_t &bi,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         distribution_bundle_t *bundle = bundle_storage_->get(bi);
-        auto evaluate = [&p, &bundle]() {
-            return 0.25 * (bundle->at(0)->data().sampleNonNormalized(p) +
-                           bundle->at(1)->data().sampleNonNormalized(p) +
-                           bundle->at(2)->data().sampleNonNormalized(p) +
-                           bundle->at(3)->data().sampleNonNormalized(p));
+        auto evaluate = [&p, &bundle, kernel]() {
+            return 0.25 * (cslibs_ndt::common::sampleNonNormalized(bundle->at(0)->data(), p, kernel) +
+                           cslibs_ndt::common::sampleNonNormalized(bundle->at(1)->data(), p, kernel) +
+                           cslibs_ndt::common::sampleNonNormalized(bundle->at(2)->data(), p, kernel) +
+                           cslibs_ndt::common::sampleNonNormalized(bundle->at(3)->data(), p, kernel));
         };
         return bundle ? evaluate() : 0.0;
     }
@@ -283,6 +300,49 @@ public:
         return getAllocate(bi);
     }
 
+    /**
+     * @brief Get the distributions of a bundle without allocating anything, thus
+     *        safe to call concurrently. Distributions shared with neighbouring bundles
+     *        are found even if the bundle itself was never allocated.
+     * @param bi     - the bundle index
+     * @param bundle - the distributions, nullptr where none exists
+     * @return if at least one distribution exists
+     */
+    inline bool lookupDistributionBundle(const index_t &bi,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        const distribution_bundle_t *b = bundle_storage_->get(bi);
+        if(b) {
+            std::copy(b->begin(), b->end(), bundle.begin());
+            return true;
+        }
+
+        bool found = false;
+        for(std::size_t i = 0 ; i < 4 ; ++i) {
+            bundle[i] = storage_[i]->get(toStorageIndex(bi, i));
+            found |= bundle[i] != nullptr;
+        }
+        return found;
+    }
+
+    inline bool lookupDistributionBundle(const point_t &p,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        return lookupDistributionBundle(toBundleIndex(p), bundle);
+    }
+
+    /**
+     * @brief Get the distribution of one layer at a point without allocating anything.
+     * @param p     - the point
+     * @param layer - the layer / storage index in [0, 4)
+     * @return the distribution or nullptr
+     */
+    inline const distribution_t* lookupDistribution(const point_t &p,
+                                                    const std::size_t layer) const
+    {
+        return storage_[layer]->get(toStorageIndex(toBundleIndex(p), layer));
+    }
+
     inline double getBundleResolution() const
     {
         return bundle_resolution_;
@@ -365,6 +425,43 @@ public:
         }
     }
 
+    /**
+     * @brief Record the bundles whose distributions change from now on, e.g. to update
+     *        a conversion of the map incrementally. Tracking is off by default and copies
+     *        of the map start without it. Changes made through getDistributionBundle are
+     *        not recorded.
+     *
+     *        The record has a single consumer, since taking it clears it. Registering
+     *        another consumer drops the record, the previous one then no longer tracks
+     *        the map and has to start over instead of missing changes.
+     * @param consumer - the consumer of the record, nullptr disables tracking
+     */
+    inline void trackDirtyBundles(const void *consumer)
+    {
+        dirty_bundles_consumer_ = consumer;
+        dirty_bundles_.clear();
+    }
+
+    inline bool tracksDirtyBundles(const void *consumer) const
+    {
+        return consumer && dirty_bundles_consumer_ == consumer;
+    }
+
+    /**
+     * @brief Take the bundles changed since the last call and clear the record. The
+     *        changed distributions are shared with the neighbouring bundles, which
+     *        thus change as well.
+     * @param consumer - the consumer which registered the record
+     * @param bundles  - the changed bundle indices, in no particular order
+     */
+    inline void takeDirtyBundles(const void *consumer,
+                                 std::vector<index_t> &bundles)
+    {
+        assert(tracksDirtyBundles(consumer));
+        bundles.assign(dirty_bundles_.begin(), dirty_bundles_.end());
+        dirty_bundles_.clear();
+    }
+
 protected:
     const double                                    resolution_;
     const double                                    bundle_resolution_;
@@ -376,6 +473,8 @@ protected:
     mutable index_t                                 max_bundle_index_;
     mutable distribution_storage_array_t            storage_;
     mutable distribution_bundle_storage_ptr_t       bundle_storage_;
+    const void                                     *dirty_bundles_consumer_ = nullptr;
+    mutable dirty_bundle_set_t                      dirty_bundles_;
 
     inline distribution_t* getAllocate(const distribution_storage_ptr_t &s,
                                        const index_t &i) const
@@ -415,12 +514,29 @@ protected:
         return get_allocate(bi);
     }
 
+    inline void markDirty(const index_t &bi) const
+    {
+        if (dirty_bundles_consumer_)
+            dirty_bundles_.insert(bi);
+    }
+
     inline void updateIndices(const index_t &chunk_index) const
     {
         min_bundle_index_ = std::min(min_bundle_index_, chunk_index);
         max_bundle_index_ = std::max(max_bundle_index_, chunk_index);
     }
 
+    inline index_t toStorageIndex(const index_t &bi,
+                                  const std::size_t layer) const
+    {
+        const int divx = cslibs_math::common::div<int>(bi[0], 2);
+        const int divy = cslibs_math::common::div<int>(bi[1], 2);
+        const int modx = cslibs_math::common::mod<int>(bi[0], 2);
+        const int mody = cslibs_math::common::mod<int>(bi[1], 2);
+        return {{divx + ((layer & 1ul) ? modx : 0),
+                 divy + ((layer & 2ul) ? mody : 0)}};
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
@@ -0,0 +1,66 @@
+#ifndef CSLIBS_NDT_2D_CORRELATIVE_PARAMS_HPP
+#define CSLIBS_NDT_2D_CORRELATIVE_PARAMS_HPP
+
+#include <cstddef>
+
+namespace cslibs_ndt_2d {
+namespace matching {
+/**
+ * @brief Search window of the correlative scan matcher, centered on the initial pose.
+ */
+class CorrelativeParameter
+{
+public:
+    /**
+     * @param linear_window      - half extent of the search in x and y
+     * @param angular_window     - half extent of the search in yaw
+     * @param angular_resolution - yaw step, 0 derives it from the farthest point
+     */
+    inline explicit CorrelativeParameter(const double linear_window = 0.5,
+                                         const double angular_window = 0.35,
+                                         const double angular_resolution = 0.0) :
+        linear_window_(linear_window),
+        angular_window_(angular_window),
+        angular_resolution_(angular_resolution)
+    {
+    }
+
+    inline double linearWindow() const
+    {
+        return linear_window_;
+    }
+
+    inline double & linearWindow()
+    {
+        return linear_window_;
+    }
+
+    inline double angularWindow() const
+    {
+        return angular_window_;
+    }
+
+    inline double & angularWindow()
+    {
+        return angular_window_;
+    }
+
+    inline double angularResolution() const
+    {
+        return angular_resolution_;
+    }
+
+    inline double & angularResolution()
+    {
+        return angular_resolution_;
+    }
+
+protected:
+    double linear_window_;
+    double angular_window_;
+    double angular_resolution_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CORRELATIVE_PARAMS_HPP
@@ -0,0 +1,245 @@
+#ifndef CSLIBS_NDT_2D_CORRELATIVE_SCAN_MATCHER_HPP
+#define CSLIBS_NDT_2D_CORRELATIVE_SCAN_MATCHER_HPP
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/result.hpp>
+
+#include <cslibs_ndt_2d/conversion/probability_gridmap.hpp>
+#include <cslibs_math_2d/linear/pointcloud.hpp>
+#include <cslibs_ndt_2d/matching/correlative_params.hpp>
+
+namespace cslibs_ndt_2d {
+namespace matching {
+/**
+ * @brief Exhaustive correlative scan matching (Olson) on a rasterized 2D NDT map.
+ *        The map is sampled once into a probability grid, then every pose of the
+ *        search window is scored by summing the grid values at the scan points.
+ *
+ *        The scan is rotated and discretized once per yaw step. For one yaw and one
+ *        row offset every point adds a contiguous slice of its grid row to the scores
+ *        of all column offsets, so the innermost loop is a plain vectorizable addition.
+ *        Yaw steps are searched in parallel.
+ */
+class EIGEN_ALIGN16 CorrelativeScanMatcher
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Ptr           = std::shared_ptr<CorrelativeScanMatcher>;
+    using point_t       = cslibs_math_2d::Point2d;
+    using transform_t   = cslibs_math_2d::Transform2d;
+    using result_t      = cslibs_ndt::matching::Result<transform_t>;
+    using grid_t        = cslibs_gridmaps::static_maps::ProbabilityGridmap;
+    using pool_t        = cslibs_ndt::common::ThreadPool;
+
+    /**
+     * @param pool - the pool to run on, the shared default if empty
+     */
+    inline explicit CorrelativeScanMatcher(const pool_t::Ptr &pool = pool_t::getDefault()) :
+        pool_(pool ? pool : pool_t::getDefault()),
+        width_(0),
+        height_(0),
+        padding_(0),
+        resolution_(0.0)
+    {
+    }
+
+    /**
+     * @brief Rasterize a map, the sampling resolution has to divide its bundle resolution.
+     */
+    inline void setMap(const cslibs_ndt_2d::dynamic_maps::Gridmap::Ptr &map,
+                       const double sampling_resolution)
+    {
+        grid_t::Ptr grid;
+        cslibs_ndt_2d::conversion::from(map, grid, sampling_resolution);
+        setMap(grid);
+    }
+
+    inline void setMap(const cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr &map,
+                       const double sampling_resolution,
+                       const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model)
+    {
+        grid_t::Ptr grid;
+        cslibs_ndt_2d::conversion::from(map, grid, sampling_resolution, inverse_model);
+        setMap(grid);
+    }
+
+    /**
+     * @brief Use an already rasterized map.
+     */
+    inline void setMap(const grid_t::ConstPtr &grid)
+    {
+        grid_ = grid;
+        padding_ = 0;
+        lookup_.clear();
+        if (!grid_)
+            return;
+
+        origin_inv_ = grid_->getOrigin().inverse();
+        resolution_ = grid_->getResolution();
+    }
+
+    /**
+     * @brief Search the window around the initial pose for the best alignment of the points.
+     * @param points_begin  - the points in the sensor frame
+     * @param points_end    - end of the points
+     * @return the best pose, its score is the mean grid value of the points and the
+     *         iterations are the number of scored poses; the initial pose with
+     *         Termination::NONE if no pose of the window overlaps the map
+     */
+    template<typename iterator_t>
+    inline result_t match(const iterator_t &points_begin,
+                          const iterator_t &points_end,
+                          const CorrelativeParameter &param,
+                          const transform_t &initial_transform)
+    {
+        const std::vector<point_t> points(points_begin, points_end);
+        if (!grid_ || points.empty())
+            return result_t(0.0, 0, initial_transform, cslibs_ndt::matching::Termination::NONE);
+
+        const int window = static_cast<int>(std::ceil(param.linearWindow() / resolution_));
+        pad(window);
+
+        /// step one: the yaw steps
+        double range = 0.0;
+        for (const point_t &p : points)
+            range = std::max(range, p.length());
+        double step = param.angularResolution();
+        if (step <= 0.0) {
+            const double r = std::max(range, resolution_);
+            step = std::acos(1.0 - resolution_ * resolution_ / (2.0 * r * r));
+        }
+        const int steps = static_cast<int>(std::ceil(param.angularWindow() / step));
+        const std::size_t yaws = static_cast<std::size_t>(2 * steps + 1);
+
+        /// step two: score all offsets per yaw in parallel
+        const std::size_t offsets = static_cast<std::size_t>(2 * window + 1);
+        const std::size_t slots = pool_->concurrency();
+        scores_.resize(slots);
+        cells_.resize(slots);
+        best_.assign(yaws, Best());
+
+        pool_->parallelFor(0, yaws, 1, [&](const std::size_t slot, const std::size_t begin, const std::size_t end) {
+            std::vector<float> &scores = scores_[slot];
+            std::vector<std::size_t> &cells = cells_[slot];
+            scores.resize(offsets);
+            cells.resize(points.size());
+
+            for (std::size_t k = begin ; k < end ; ++k) {
+                const double yaw = initial_transform.yaw() + (static_cast<int>(k) - steps) * step;
+                const transform_t g_T_s = origin_inv_ * transform_t(initial_transform.translation(), yaw);
+
+                /// the first column of the slice every point adds, at the smallest offsets;
+                /// with the grid padded by twice the window only points which miss it at
+                /// every offset are dropped
+                std::size_t valid = 0;
+                for (const point_t &p : points) {
+                    const point_t c = g_T_s * p;
+                    const int x = static_cast<int>(std::floor(c(0) / resolution_ + 0.5)) - window + padding_;
+                    const int y = static_cast<int>(std::floor(c(1) / resolution_ + 0.5)) - window + padding_;
+                    if (x < 0 || y < 0 || x + static_cast<int>(offsets) > padded_width_ ||
+                            y + static_cast<int>(offsets) > padded_height_)
+                        continue;
+                    cells[valid++] = static_cast<std::size_t>(y) * padded_width_ + x;
+                }
+
+                for (std::size_t dy = 0 ; dy < offsets ; ++dy) {
+                    std::fill(scores.begin(), scores.end(), 0.0f);
+                    const std::size_t row = dy * padded_width_;
+                    for (std::size_t i = 0 ; i < valid ; ++i) {
+                        const float *slice = lookup_.data() + cells[i] + row;
+                        float *s = scores.data();
+                        for (std::size_t dx = 0 ; dx < offsets ; ++dx)
+                            s[dx] += slice[dx];
+                    }
+
+                    const std::size_t dx = static_cast<std::size_t>(std::max_element(scores.begin(), scores.end()) - scores.begin());
+                    if (scores[dx] > best_[k].score) {
+                        best_[k].score = scores[dx];
+                        best_[k].dx    = static_cast<int>(dx) - window;
+                        best_[k].dy    = static_cast<int>(dy) - window;
+                    }
+                }
+            }
+        });
+
+        /// step three: the best over all yaws, ties go to the smallest rotation
+        std::size_t best = static_cast<std::size_t>(steps);
+        const std::size_t iterations = yaws * offsets * offsets;
+        for (std::size_t k = 0 ; k < yaws ; ++k) {
+            if (best_[k].score > best_[best].score ||
+                    (best_[k].score == best_[best].score &&
+                     std::abs(static_cast<int>(k) - steps) < std::abs(static_cast<int>(best) - steps)))
+                best = k;
+        }
+        if (best_[best].score <= 0.0f)
+            return result_t(0.0, iterations, initial_transform, cslibs_ndt::matching::Termination::NONE);
+
+        const double yaw = initial_transform.yaw() + (static_cast<int>(best) - steps) * step;
+        const point_t offset = grid_->getOrigin() * point_t(best_[best].dx * resolution_, best_[best].dy * resolution_) -
+                grid_->getOrigin().translation();
+        const transform_t transform(initial_transform.translation() + offset, yaw);
+        return result_t(best_[best].score / static_cast<double>(points.size()),
+                        iterations,
+                        transform,
+                        cslibs_ndt::matching::Termination::MAX_ITERATIONS);
+    }
+
+    inline result_t match(const cslibs_math_2d::Pointcloud2d::ConstPtr &points,
+                          const CorrelativeParameter &param,
+                          const transform_t &initial_transform)
+    {
+        return match(points->begin(), points->end(), param, initial_transform);
+    }
+
+private:
+    struct Best {
+        float score = 0.0f;
+        int   dx    = 0;
+        int   dy    = 0;
+    };
+
+    pool_t::Ptr                             pool_;
+    grid_t::ConstPtr                        grid_;
+    transform_t                             origin_inv_;
+
+    /// the grid as floats with a zero border twice as wide as the search window
+    std::vector<float>                      lookup_;
+    int                                     width_;
+    int                                     height_;
+    int                                     padding_;
+    int                                     padded_width_;
+    int                                     padded_height_;
+    double                                  resolution_;
+
+    std::vector<std::vector<float>>         scores_;
+    std::vector<std::vector<std::size_t>>   cells_;
+    std::vector<Best>                       best_;
+
+    /// a wider border only adds zeros, so the scores do not depend on earlier windows
+    inline void pad(const int window)
+    {
+        if (!lookup_.empty() && padding_ >= 2 * window)
+            return;
+
+        width_          = static_cast<int>(grid_->getWidth());
+        height_         = static_cast<int>(grid_->getHeight());
+        padding_        = 2 * window;
+        padded_width_   = width_  + 2 * padding_;
+        padded_height_  = height_ + 2 * padding_;
+
+        lookup_.assign(static_cast<std::size_t>(padded_width_) * padded_height_, 0.0f);
+        for (int y = 0 ; y < height_ ; ++y)
+            for (int x = 0 ; x < width_ ; ++x)
+                lookup_[static_cast<std::size_t>(y + padding_) * padded_width_ + x + padding_] =
+                        static_cast<float>(grid_->at(static_cast<std::size_t>(x), static_cast<std::size_t>(y)));
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_2D_CORRELATIVE_SCAN_MATCHER_HPP
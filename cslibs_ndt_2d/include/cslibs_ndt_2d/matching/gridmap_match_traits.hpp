@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cslibs_ndt/matching/match_traits.hpp>
+#include <cslibs_ndt/matching/planar_derivatives.hpp>
+#include <cslibs_ndt/matching/parameter.hpp>
+#include <cslibs_ndt_2d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_2d/static_maps/gridmap.hpp>
+#include <cslibs_ndt_2d/matching/jacobian.hpp>
+#include <cslibs_ndt_2d/matching/hessian.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+
+template<typename MapT> struct IsGridmap2D : std::false_type {};
+template<> struct IsGridmap2D<cslibs_ndt_2d::dynamic_maps::Gridmap> : std::true_type {};
+template<> struct IsGridmap2D<cslibs_ndt_2d::static_maps::Gridmap> : std::true_type {};
+
+/**
+ * @brief Planar matching (x, y, yaw) against 2D gridmaps with closed form derivatives.
+ */
+template<typename MapT>
+struct MatchTraits<MapT, typename std::enable_if<IsGridmap2D<MapT>::value>::type>
+{
+    static constexpr int LINEAR_DIMS  = 2;
+    static constexpr int ANGULAR_DIMS = 1;
+    using Jacobian              = cslibs_ndt_2d::matching::Jacobian;
+    using Hessian               = cslibs_ndt_2d::matching::Hessian;
+
+    using gradient_t            = Eigen::Matrix<double, 3, 1>;
+    using hessian_t             = Eigen::Matrix<double, 3, 3>;
+
+    using point_t               = cslibs_math_2d::Point2d;
+    using transform_t           = cslibs_math_2d::Transform2d;
+    using parameter_t           = cslibs_ndt::matching::Parameter;
+    using index_t               = typename MapT::index_t;
+
+    static transform_t makeTransform(const Eigen::Vector2d& linear,
+                                     const Eigen::Matrix<double, 1, 1>& angular)
+    {
+        return transform_t{linear.x(), linear.y(), angular(0)};
+    }
+
+    /**
+     * @brief Distributions update their moments lazily on first access. Touch all of
+     *        them once, so that concurrent evaluations afterwards only read from the map.
+     */
+    static void prepare(const MapT& map)
+    {
+        for (const auto& storage : map.getStorages())
+        {
+            storage->traverse([](const index_t&, const typename MapT::distribution_t& d)
+            {
+                d.data().getCovariance();
+                d.data().getInformationMatrix();
+            });
+        }
+    }
+
+    /**
+     * @brief Accumulate score, gradient and hessian of one point.
+     * @param point       - the transformed point
+     * @param point_prime - the point before the transform, the derivatives are evaluated at
+     */
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const Hessian& H,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g,
+                                hessian_t& h)
+    {
+        accumulate(map, point, point_prime, J, &H, param, score, g, &h);
+    }
+
+    /**
+     * @brief Accumulate score and gradient of one point only, e.g. for line search trials.
+     */
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(map, point, point_prime, J, nullptr, param, score, g, nullptr);
+    }
+
+private:
+    static void accumulate(const MapT& map,
+                           const point_t& point,
+                           const point_t& point_prime,
+                           const Jacobian& J,
+                           const Hessian* H,
+                           const parameter_t& param,
+                           double& score,
+                           gradient_t& g,
+                           hessian_t* h)
+    {
+        /// lookup does not allocate, evaluations can run concurrently after prepare
+        typename MapT::distribution_const_bundle_t::data_t bundle;
+        if (!map.lookupDistributionBundle(point, bundle))
+            return;
+
+        /// the translational columns are unit vectors, only the yaw column depends on the point
+        const Eigen::Vector2d J_yaw = J.get(Jacobian::yaw, point_prime.data());
+        const Eigen::Vector2d H_yaw = h ? H->get(Hessian::yaw, Hessian::yaw, point_prime.data()) : Eigen::Vector2d::Zero();
+
+        for (const auto* distribution_wrapper : bundle)
+        {
+            if (!distribution_wrapper)
+                continue;
+
+            const auto& d = distribution_wrapper->data();
+            if (d.getN() < 3)
+                continue;
+
+            const Eigen::Matrix2d info   = d.getInformationMatrix();
+            const Eigen::Vector2d q      = point.data() - d.getMean();
+            const Eigen::Vector2d q_info = info * q;
+            const double          s      = cslibs_ndt::common::gaussianCutoff(-0.5 * q.dot(q_info), param.kernel());
+            if (!std::isnormal(s) || s <= 1e-5)
+                continue;
+
+            /// g = -ds/dp, h = d^2s/dp^2
+            impl::accumulatePlanar<2>(q_info, info, J_yaw, H_yaw, s, 1.0, g, h);
+
+            score += s;
+        }
+    }
+};
+
+}
+}
@@ -0,0 +1,51 @@
+#ifndef CSLIBS_NDT_2D_HESSIAN_HPP
+#define CSLIBS_NDT_2D_HESSIAN_HPP
+
+#include <Eigen/Eigen>
+
+namespace cslibs_ndt_2d {
+namespace matching {
+/**
+ * @brief Closed form second derivatives of a planar transform (x, y, yaw) applied to
+ *        a point, the only non zero entry is the one of yaw and yaw.
+ */
+class EIGEN_ALIGN16 Hessian {
+public:
+    using point_t   = Eigen::Vector2d;
+    using angular_t = Eigen::Matrix<double, 1, 1>;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    inline Hessian() :
+        sin_(0.0),
+        cos_(1.0)
+    {
+    }
+
+    enum Partial{tx = 0, ty = 1, yaw = 2};
+
+    inline const point_t get(const std::size_t pi,
+                             const std::size_t pj,
+                             const point_t &p) const
+    {
+        assert(pi < 3);
+        assert(pj < 3);
+        return (pi != yaw || pj != yaw) ? point_t::Zero() :
+                                          point_t(-cos_ * p(0) + sin_ * p(1),
+                                                  -sin_ * p(0) - cos_ * p(1));
+    }
+
+    inline static void get(const angular_t &angular,
+                           Hessian &h)
+    {
+        h.sin_ = std::sin(angular(0));
+        h.cos_ = std::cos(angular(0));
+    }
+
+private:
+    double sin_;
+    double cos_;
+};
+}
+}
+#endif // CSLIBS_NDT_2D_HESSIAN_HPP
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cslibs_ndt/matching/match_traits.hpp>
+#include <cslibs_ndt/matching/planar_derivatives.hpp>
+#include <cslibs_ndt/matching/occupancy_parameter.hpp>
+#include <cslibs_ndt/matching/occupancy_cache.hpp>
+#include <cslibs_ndt_2d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/static_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_2d/matching/jacobian.hpp>
+#include <cslibs_ndt_2d/matching/hessian.hpp>
+
+namespace cslibs_ndt {
+namespace matching {
+
+template<typename MapT> struct IsOccupancyGridmap2D : std::false_type {};
+template<> struct IsOccupancyGridmap2D<cslibs_ndt_2d::dynamic_maps::OccupancyGridmap> : std::true_type {};
+template<> struct IsOccupancyGridmap2D<cslibs_ndt_2d::static_maps::OccupancyGridmap> : std::true_type {};
+
+/**
+ * @brief Planar matching (x, y, yaw) against 2D occupancy gridmaps with closed form derivatives.
+ *        Distributions are weighted by their occupancy like in the 3D case, the weights
+ *        are resolved once per bundle and match, see OccupancyCache.
+ */
+template<typename MapT>
+struct MatchTraits<MapT, typename std::enable_if<IsOccupancyGridmap2D<MapT>::value>::type>
+{
+    static constexpr int LINEAR_DIMS  = 2;
+    static constexpr int ANGULAR_DIMS = 1;
+    using Jacobian  = cslibs_ndt_2d::matching::Jacobian;
+    using Hessian   = cslibs_ndt_2d::matching::Hessian;
+
+    using gradient_t = Eigen::Matrix<double, 3, 1>;
+    using hessian_t  = Eigen::Matrix<double, 3, 3>;
+
+    using point_t = cslibs_math_2d::Point2d;
+    using transform_t = cslibs_math_2d::Transform2d;
+    using parameter_t = cslibs_ndt::matching::OccupancyParameter;
+    using cache_t     = cslibs_ndt::matching::OccupancyCache<MapT>;
+
+    static transform_t makeTransform(const Eigen::Vector2d& linear,
+                                     const Eigen::Matrix<double, 1, 1>& angular)
+    {
+        return transform_t{linear.x(), linear.y(), angular(0)};
+    }
+
+    /**
+     * @brief Resolve the occupancy weights of all bundles the initially transformed scan touches.
+     */
+    template<typename points_t>
+    static void prepareCache(const MapT& map,
+                             const parameter_t& param,
+                             const points_t& points,
+                             cache_t& cache)
+    {
+        cache.reset(map, param.inverseModel(), param.occupancyThreshold());
+        for (const point_t& point : points)
+            cache.get(point);
+    }
+
+    static void computeGradient(const MapT&,
+                                cache_t& cache,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const Hessian& H,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g,
+                                hessian_t& h)
+    {
+        accumulate(cache.get(point), point, point_prime, J, &H, param.kernel(), score, g, &h);
+    }
+
+    static void computeGradient(const MapT&,
+                                cache_t& cache,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(cache.get(point), point, point_prime, J, nullptr, param.kernel(), score, g, nullptr);
+    }
+
+    /**
+     * @brief Uncached evaluation, the bundle is resolved for every call.
+     */
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const Hessian& H,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g,
+                                hessian_t& h)
+    {
+        accumulate(resolve(map, point, param), point, point_prime, J, &H, param.kernel(), score, g, &h);
+    }
+
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(resolve(map, point, param), point, point_prime, J, nullptr, param.kernel(), score, g, nullptr);
+    }
+
+private:
+    static typename cache_t::Entry resolve(const MapT& map,
+                                           const point_t& point,
+                                           const parameter_t& param)
+    {
+        typename cache_t::Entry entry;
+        cache_t::resolve(map, point, param.inverseModel(), param.occupancyThreshold(), entry);
+        return entry;
+    }
+
+    static void accumulate(const typename cache_t::Entry& entry,
+                           const point_t& point,
+                           const point_t& point_prime,
+                           const Jacobian& J,
+                           const Hessian* H,
+                           const cslibs_ndt::common::Kernel kernel,
+                           double& score,
+                           gradient_t& g,
+                           hessian_t* h)
+    {
+        static constexpr double d1 = 0.95;
+        static constexpr double d2 = 1 - d1;
+
+        if (entry.size == 0)
+            return;
+
+        /// the translational columns are unit vectors, only the yaw column depends on the point
+        const Eigen::Vector2d J_yaw = J.get(Jacobian::yaw, point_prime.data());
+        const Eigen::Vector2d H_yaw = h ? H->get(Hessian::yaw, Hessian::yaw, point_prime.data()) : Eigen::Vector2d::Zero();
+
+        for (std::size_t k = 0; k < entry.size; ++k)
+        {
+            const auto& d = *entry.distributions[k];
+
+            const Eigen::Matrix2d info   = d.getInformationMatrix();
+            const Eigen::Vector2d q      = point.data() - d.getMean();
+            const Eigen::Vector2d q_info = info * q;
+            const double          p_occ  = entry.occupancy[k];
+            const double          c      = d2 * (1 - p_occ);
+            const double          s      = d1 * p_occ * cslibs_ndt::common::gaussianCutoff(-0.5 * q.dot(q_info) * c, kernel);
+            if (!std::isnormal(s) || s <= 1e-5)
+                continue;
+
+            /// g = -ds/dp, h = d^2s/dp^2
+            impl::accumulatePlanar<2>(q_info, info, J_yaw, H_yaw, s, c, g, h);
+
+            score += s;
+        }
+    }
+};
+
+}
+}
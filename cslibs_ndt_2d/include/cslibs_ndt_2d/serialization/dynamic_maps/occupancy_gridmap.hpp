@@ -5,6 +5,7 @@
 
 #include <cslibs_ndt/serialization/filesystem.hpp>
 #include <cslibs_ndt/serialization/storage.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
 
 #include <cslibs_math_2d/serialization/transform.hpp>
 #include <cslibs_math/serialization/array.hpp>
@@ -12,13 +13,13 @@
 #include <yaml-cpp/yaml.h>
 
 #include <fstream>
-#include <thread>
 #include <atomic>
 
 namespace cslibs_ndt_2d {
 namespace dynamic_maps {
 inline bool saveBinary(const cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr &map,
-                       const std::string &path)
+                       const std::string &path,
+                       const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     using path_t     = boost::filesystem::path;
     using paths_t    = std::array<path_t, 4>;
@@ -60,20 +61,21 @@ inline bool saveBinary(const cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr
                                   map->getStorages()[2],
                                   map->getStorages()[3]}};
 
-    std::array<std::thread, 4> threads;
+    const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
     std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::save(storages[i], paths[i]);
-        });
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i].join();
+    p->parallelFor(0, 4, 1, [&storages, &paths, &success](const std::size_t, const std::size_t b, const std::size_t e) {
+        for (std::size_t i = b ; i < e ; ++i) {
+            if (!binary_t::save(storages[i], paths[i]))
+                success = false;
+        }
+    });
 
     return success;
 }
 
 inline bool loadBinary(const std::string &path,
-                       cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr &map)
+                       cslibs_ndt_2d::dynamic_maps::OccupancyGridmap::Ptr &map,
+                       const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     using path_t           = boost::filesystem::path;
     using paths_t          = std::array<path_t, 4>;
@@ -111,14 +113,14 @@ inline bool loadBinary(const std::string &path,
     const index_t                     max_index  = n["max_index"].as<index_t>();
     const std::vector<index_t>        indices    = n["bundles"].as<std::vector<index_t>>();
 
-    std::array<std::thread, 4> threads;
+    const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
     std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::load(paths[i], storages[i]);
-        });
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i].join();
+    p->parallelFor(0, 4, 1, [&storages, &paths, &success](const std::size_t, const std::size_t b, const std::size_t e) {
+        for (std::size_t i = b ; i < e ; ++i) {
+            if (!binary_t::load(paths[i], storages[i]))
+                success = false;
+        }
+    });
 
     if (!success)
         return false;
@@ -5,6 +5,7 @@
 
 #include <cslibs_ndt/serialization/filesystem.hpp>
 #include <cslibs_ndt/serialization/storage.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
 
 #include <cslibs_math_2d/serialization/transform.hpp>
 #include <cslibs_math/serialization/array.hpp>
@@ -12,13 +13,13 @@
 #include <yaml-cpp/yaml.h>
 
 #include <fstream>
-#include <thread>
 #include <atomic>
 
 namespace cslibs_ndt_2d {
 namespace static_maps {
 inline bool saveBinary(const cslibs_ndt_2d::static_maps::Gridmap::Ptr &map,
-                       const std::string &path)
+                       const std::string &path,
+                       const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     using path_t     = boost::filesystem::path;
     using paths_t    = std::array<path_t, 4>;
@@ -60,20 +61,21 @@ inline bool saveBinary(const cslibs_ndt_2d::static_maps::Gridmap::Ptr &map,
                                   map->getStorages()[2],
                                   map->getStorages()[3]}};
 
-    std::array<std::thread, 4> threads;
+    const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
     std::atomic_bool success(true);
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i] = std::thread([&storages, &paths, i, &success](){
-            success = success && binary_t::save(storages[i], paths[i]);
-        });
-    for (std::size_t i = 0 ; i < 4 ; ++i)
-        threads[i].join();
+    p->parallelFor(0, 4, 1, [&storages, &paths, &success](const std::size_t, const std::size_t b, const std::size_t e) {
+        for (std::size_t i = b ; i < e ; ++i) {
+            if (!binary_t::save(storages[i], paths[i]))
+                success = false;
+        }
+    });
 
     return success;
 }
 
 inline bool loadBinary(const std::string &path,
-                       cslibs_ndt_2d::static_maps::Gridmap::Ptr &map)
+                       cslibs_ndt_2d::static_maps::Gridmap::Ptr &map,
+                       const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     using path_t           = boost::filesystem::path;
     using paths_t          = std::array<path_t, 4>;
@@ -115,18 +117,17 @@ inline bool loadBinary(const std::string &path,
     bundles->template set<cslibs_indexed_storage::option::tags::array_size>(size[0] * 2, size[1] * 2);
     bundles->template set<cslibs_indexed_storage::option::tags::array_offset>(min_index[0], min_index[1]);
 
-    std::array<std::thread, 4> threads;
+    const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
     std::atomic_bool success(true);
     const index_t os = {{min_index[0] / 2, min_index[1] / 2}};
-    for (std::size_t i = 0 ; i < 4 ; ++ i) {
-        const int off    = (i > 1) ? 1 : 0;
-        const size_t  sz = {{size[0] + off, size[1] + off}};
-        threads[i] = std::thread([&storages, &paths, i, &sz, &os, &success](){
-            success = success && binary_t::load(paths[i], storages[i], sz, os);
-        });
-    }
-    for (std::size_t i = 0 ; i < 4 ; ++ i)
-        threads[i].join();
+    p->parallelFor(0, 4, 1, [&storages, &paths, &size, &os, &success](const std::size_t, const std::size_t b, const std::size_t e) {
+        for (std::size_t i = b ; i < e ; ++i) {
+            const int off   = (i > 1) ? 1 : 0;
+            const size_t sz = {{size[0] + off, size[1] + off}};
+            if (!binary_t::load(paths[i], storages[i], sz, os))
+                success = false;
+        }
+    });
 
     if (!success)
         return false;
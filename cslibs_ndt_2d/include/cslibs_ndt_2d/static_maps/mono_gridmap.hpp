@@ -11,6 +11,7 @@
 
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -187,17 +188,19 @@ public:
         return distribution ? distribution->data().sample(p) : 0.0;
     }
 
-    inline double sampleNonNormalized(const point_t &p) const
+    inline double sampleNonNormalized(const point_t &p,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         index_t i;
-        return toIndex(p, i) ? sampleNonNormalized(p, i) : 0.0;
+        return toIndex(p, i) ? sampleNonNormalized(p, i, kernel) : 0.0;
     }
 
     inline double sampleNonNormalized(const point_t &p,
-                                      const index_t &i) const
+                                      const index_t &i,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         distribution_t *distribution  = storage_->get(i);
-        return distribution ? distribution->data().sampleNonNormalized(p) : 0.0;
+        return distribution ? cslibs_ndt::common::sampleNonNormalized(distribution->data(), p, kernel) : 0.0;
     }
 
     inline distribution_t* get(const point_t &p) const
@@ -11,6 +11,7 @@
 
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -239,13 +240,21 @@ public:
     template <typename line_iterator_t = simple_iterator_t>
     inline void insert(const typename cslibs_math::linear::Pointcloud<point_t>::ConstPtr &points,
                        const pose_t &points_origin = pose_t())
+    {
+        insert<line_iterator_t>(points->begin(), points->end(), points_origin);
+    }
+
+    template <typename line_iterator_t = simple_iterator_t, typename iterator_t>
+    inline void insert(const iterator_t &points_begin,
+                       const iterator_t &points_end,
+                       const pose_t &points_origin = pose_t())
     {
         distribution_storage_t storage;
         storage.template set<cis::option::tags::array_size>(size_[0] * 2, size_[1] * 2);
         storage.template set<cis::option::tags::array_offset>(min_bundle_index_[0],
                 min_bundle_index_[1]);
-        for (const auto &p : *points) {
-            const point_t pm = points_origin * p;
+        for (auto itr = points_begin ; itr != points_end ; ++itr) {
+            const point_t pm = points_origin * *itr;
             if (pm.isNormal()) {
                 index_t bi;
                 if(toBundleIndex(pm, bi)) {
@@ -275,10 +284,20 @@ public:
                               const typename cslibs_math::linear::Pointcloud<point_t>::ConstPtr &points,
                               const inverse_sensor_model_t::Ptr &ivm,
                               const inverse_sensor_model_t::Ptr &ivm_visibility)
+    {
+        insertVisible<line_iterator_t>(origin, points->begin(), points->end(), ivm, ivm_visibility);
+    }
+
+    template <typename line_iterator_t = simple_iterator_t, typename iterator_t>
+    inline void insertVisible(const pose_t &origin,
+                              const iterator_t &points_begin,
+                              const iterator_t &points_end,
+                              const inverse_sensor_model_t::Ptr &ivm,
+                              const inverse_sensor_model_t::Ptr &ivm_visibility)
     {
         if (!ivm || !ivm_visibility) {
             std::cout << "[OccupancyGridmap2D]: Cannot evaluate visibility, using model-free update rule instead!" << std::endl;
-            return insert(points, origin);
+            return insert<line_iterator_t>(points_begin, points_end, origin);
         }
 
         const index_t start_bi = toBundleIndex(origin.translation());
@@ -302,8 +321,8 @@ public:
         storage.template set<cis::option::tags::array_size>(size_[0] * 2, size_[1] * 2);
         storage.template set<cis::option::tags::array_offset>(min_bundle_index_[0],
                 min_bundle_index_[1]);
-        for (const auto &p : *points) {
-            const point_t pm = origin * p;
+        for (auto itr = points_begin ; itr != points_end ; ++itr) {
+            const point_t pm = origin * *itr;
             if (pm.isNormal()) {
                 index_t bi;
                 if(toBundleIndex(pm, bi)) {
@@ -373,14 +392,16 @@ public:
     }
 
     inline double sampleNonNormalized(const point_t &p,
-                                      const inverse_sensor_model_t::Ptr &ivm) const
+                                      const inverse_sensor_model_t::Ptr &ivm,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
-        return sampleNonNormalized(p, toBundleIndex(p), ivm);
+        return sampleNonNormalized(p, toBundleIndex(p), ivm, kernel);
     }
 
     inline double sampleNonNormalized(const point_t &p,
                                       const index_t &bi,
-                                      const inverse_sensor_model_t::Ptr &ivm) const
+                                      const inverse_sensor_model_t::Ptr &ivm,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         if(!valid(bi))
             return 0.0;
@@ -390,11 +411,11 @@ public:
 
         distribution_bundle_t *bundle = bundle_storage_->get(bi);
 
-        auto sample = [&p, &ivm] (const distribution_t *d) {
-            auto do_sample = [&p, &ivm, &d]() {
+        auto sample = [&p, &ivm, kernel] (const distribution_t *d) {
+            auto do_sample = [&p, &ivm, &d, kernel]() {
                 const auto &handle = d;
                 return handle->getDistribution() ?
-                            handle->getDistribution()->sampleNonNormalized(p) * handle->getOccupancy(ivm) : 0.0;
+                            cslibs_ndt::common::sampleNonNormalized(*handle->getDistribution(), p, kernel) * handle->getOccupancy(ivm) : 0.0;
             };
             return d ? do_sample() : 0.0;
         };
@@ -417,6 +438,58 @@ public:
         return valid(bi) ? getAllocate(bi) : nullptr;
     }
 
+    /**
+     * @brief Get the distributions of a bundle without allocating anything, thus
+     *        safe to call concurrently. Distributions shared with neighbouring bundles
+     *        are found even if the bundle itself was never allocated.
+     * @param bi     - the bundle index
+     * @param bundle - the distributions, nullptr where none exists
+     * @return if at least one distribution exists
+     */
+    inline bool lookupDistributionBundle(const index_t &bi,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        if(!valid(bi))
+            return false;
+
+        const distribution_bundle_t *b = bundle_storage_->get(bi);
+        if(b) {
+            std::copy(b->begin(), b->end(), bundle.begin());
+            return true;
+        }
+
+        bool found = false;
+        for(std::size_t i = 0 ; i < 4 ; ++i) {
+            bundle[i] = storage_[i]->get(toStorageIndex(bi, i));
+            found |= bundle[i] != nullptr;
+        }
+        return found;
+    }
+
+    inline bool lookupDistributionBundle(const point_t &p,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        index_t bi;
+        if(!toBundleIndex(p, bi))
+            return false;
+        return lookupDistributionBundle(bi, bundle);
+    }
+
+    /**
+     * @brief Get the distribution of one layer at a point without allocating anything.
+     * @param p     - the point
+     * @param layer - the layer / storage index in [0, 4)
+     * @return the distribution or nullptr
+     */
+    inline const distribution_t* lookupDistribution(const point_t &p,
+                                                    const std::size_t layer) const
+    {
+        index_t bi;
+        if(!toBundleIndex(p, bi))
+            return nullptr;
+        return storage_[layer]->get(toStorageIndex(bi, layer));
+    }
+
     inline double getBundleResolution() const
     {
         return bundle_resolution_;
@@ -628,6 +701,17 @@ protected:
         bundle->at(3)->updateOccupied(d);
     }
 
+    inline index_t toStorageIndex(const index_t &bi,
+                                  const std::size_t layer) const
+    {
+        const int divx = cslibs_math::common::div<int>(bi[0], 2);
+        const int divy = cslibs_math::common::div<int>(bi[1], 2);
+        const int modx = cslibs_math::common::mod<int>(bi[0], 2);
+        const int mody = cslibs_math::common::mod<int>(bi[1], 2);
+        return {{divx + ((layer & 1ul) ? modx : 0),
+                 divy + ((layer & 2ul) ? mody : 0)}};
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_2d/matching/correlative_scan_matcher.hpp>
+
+using point_t     = cslibs_math_2d::Point2d;
+using transform_t = cslibs_math_2d::Transform2d;
+using grid_t      = cslibs_gridmaps::static_maps::ProbabilityGridmap;
+using matcher_t   = cslibs_ndt_2d::matching::CorrelativeScanMatcher;
+
+const double RESOLUTION = 0.05;
+const int    WALL       = 2;
+const int    LENGTH     = 60;
+
+namespace {
+/// two walls forming a corner close to the border of the grid, blurred by one cell
+grid_t::Ptr generateGrid(const transform_t &origin)
+{
+    grid_t::Ptr grid(new grid_t(origin, RESOLUTION, 80, 80, 0.0));
+    for (int i = WALL ; i < LENGTH ; ++i) {
+        for (const int d : {-1, 1}) {
+            grid->at(WALL + d, i) = 0.5;
+            grid->at(i, WALL + d) = 0.5;
+        }
+    }
+    for (int i = WALL ; i < LENGTH ; ++i) {
+        grid->at(WALL, i) = 1.0;
+        grid->at(i, WALL) = 1.0;
+    }
+    return grid;
+}
+
+/// the wall cells as seen from the sensor
+std::vector<point_t> generateScan(const transform_t &origin,
+                                  const transform_t &sensor)
+{
+    const transform_t s_T_g = sensor.inverse() * origin;
+    std::vector<point_t> scan;
+    for (int i = WALL ; i < LENGTH ; ++i) {
+        scan.emplace_back(s_T_g * point_t((WALL + 0.1) * RESOLUTION, (i + 0.1) * RESOLUTION));
+        scan.emplace_back(s_T_g * point_t((i + 0.1) * RESOLUTION, (WALL + 0.1) * RESOLUTION));
+    }
+    return scan;
+}
+}
+
+TEST(Test_cslibs_ndt_2d, testCorrelativeScanMatcher)
+{
+    const transform_t origin(-1.0, -2.0, 0.0);
+    const transform_t sensor(0.5, 0.4, 0.0);
+    const std::vector<point_t> scan = generateScan(origin, sensor);
+
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    matcher_t matcher(pool);
+    matcher.setMap(generateGrid(origin));
+
+    /// at the initial pose the walls are outside of the grid, the known offset moves them
+    /// onto it
+    const transform_t initial(sensor.tx() - 4 * RESOLUTION, sensor.ty() + 3 * RESOLUTION, 0.0);
+    const cslibs_ndt_2d::matching::CorrelativeParameter param(0.3, 0.1, 0.02);
+    const matcher_t::result_t result = matcher.match(scan.begin(), scan.end(), param, initial);
+    EXPECT_EQ(result.termination(), cslibs_ndt::matching::Termination::MAX_ITERATIONS);
+    EXPECT_EQ(result.iterations(), 11u * 13u * 13u);
+    EXPECT_NEAR(result.score(), 1.0, 1e-6);
+    EXPECT_NEAR(result.transform().tx(),  sensor.tx(), 1e-9);
+    EXPECT_NEAR(result.transform().ty(),  sensor.ty(), 1e-9);
+    EXPECT_NEAR(result.transform().yaw(), 0.0,         1e-9);
+
+    /// a larger window before does not change the result
+    matcher_t fresh(pool);
+    fresh.setMap(generateGrid(origin));
+    fresh.match(scan.begin(), scan.end(), cslibs_ndt_2d::matching::CorrelativeParameter(1.0, 0.1, 0.02), initial);
+    const matcher_t::result_t again = fresh.match(scan.begin(), scan.end(), param, initial);
+    EXPECT_EQ(again.score(), result.score());
+    EXPECT_EQ(again.transform().tx(), result.transform().tx());
+    EXPECT_EQ(again.transform().ty(), result.transform().ty());
+}
+
+TEST(Test_cslibs_ndt_2d, testCorrelativeScanMatcherNoOverlap)
+{
+    const transform_t origin(-1.0, -2.0, 0.0);
+    const std::vector<point_t> scan = generateScan(origin, transform_t(0.5, 0.4, 0.0));
+
+    matcher_t matcher;
+    const cslibs_ndt_2d::matching::CorrelativeParameter param(0.3, 0.1, 0.02);
+    const transform_t initial(100.0, 100.0, 0.05);
+
+    /// without a map nothing is matched
+    EXPECT_EQ(matcher.match(scan.begin(), scan.end(), param, initial).termination(),
+              cslibs_ndt::matching::Termination::NONE);
+
+    /// far away from the map the initial pose is kept
+    matcher.setMap(generateGrid(origin));
+    const matcher_t::result_t result = matcher.match(scan.begin(), scan.end(), param, initial);
+    EXPECT_EQ(result.termination(), cslibs_ndt::matching::Termination::NONE);
+    EXPECT_EQ(result.score(), 0.0);
+    EXPECT_EQ(result.transform().tx(),  initial.tx());
+    EXPECT_EQ(result.transform().ty(),  initial.ty());
+    EXPECT_EQ(result.transform().yaw(), initial.yaw());
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_2d/conversion/distance_transform.hpp>
+
+#include <cmath>
+#include <random>
+
+namespace {
+double bruteForce(const std::vector<std::uint8_t> &occupied,
+                  const std::size_t width,
+                  const std::size_t x,
+                  const std::size_t y,
+                  const double resolution,
+                  const double maximum_distance)
+{
+    double d = maximum_distance;
+    for (std::size_t i = 0 ; i < occupied.size() ; ++i) {
+        if (occupied[i]) {
+            const double dx = static_cast<double>(i % width) - static_cast<double>(x);
+            const double dy = static_cast<double>(i / width) - static_cast<double>(y);
+            d = std::min(d, std::hypot(dx, dy) * resolution);
+        }
+    }
+    return d;
+}
+}
+
+TEST(Test_cslibs_ndt_2d, testDistanceTransformExact)
+{
+    const double resolution       = 0.05;
+    const double maximum_distance = 1.3;
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    const cslibs_ndt_2d::conversion::DistanceTransform distance_transform(resolution, maximum_distance);
+
+    std::mt19937 rng(42);
+    for (const std::size_t width : {1ul, 7ul, 61ul}) {
+        for (const std::size_t height : {1ul, 9ul, 43ul}) {
+            for (const double density : {0.0, 0.005, 0.05, 0.5}) {
+                std::bernoulli_distribution occupied_distribution(density);
+                std::vector<std::uint8_t> occupied(width * height);
+                for (std::uint8_t &o : occupied)
+                    o = occupied_distribution(rng);
+
+                std::vector<double> distances;
+                distance_transform.apply(occupied, width, distances, pool);
+                ASSERT_EQ(distances.size(), occupied.size());
+
+                for (std::size_t y = 0 ; y < height ; ++y) {
+                    for (std::size_t x = 0 ; x < width ; ++x) {
+                        EXPECT_NEAR(distances[y * width + x],
+                                    bruteForce(occupied, width, x, y, resolution, maximum_distance), 1e-12);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testDistanceTransformMapping)
+{
+    std::vector<std::uint8_t> occupied(5 * 3, 0);
+    occupied[1 * 5 + 2] = 1;
+
+    std::vector<double> distances;
+    cslibs_ndt_2d::conversion::DistanceTransform(1.0, 10.0).apply(occupied, 5, distances, [](const double d) {
+        return -d;
+    });
+
+    EXPECT_EQ(distances[1 * 5 + 2], 0.0);
+    EXPECT_NEAR(distances[0 * 5 + 0], -std::sqrt(5.0), 1e-12);
+    EXPECT_NEAR(distances[2 * 5 + 4], -std::sqrt(5.0), 1e-12);
+    EXPECT_NEAR(distances[1 * 5 + 4], -2.0, 1e-12);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_2d/conversion/incremental_probability_gridmap.hpp>
+
+#include <cslibs_math_2d/linear/pointcloud.hpp>
+
+#include <cmath>
+#include <random>
+
+using point_t      = cslibs_math_2d::Point2d;
+using pointcloud_t = cslibs_math_2d::Pointcloud2d;
+using pose_t       = cslibs_math_2d::Pose2d;
+using gridmap_t    = cslibs_gridmaps::static_maps::ProbabilityGridmap;
+
+const double SAMPLING_RESOLUTION = 0.1;
+
+namespace {
+/// random points in [x0, x1) x [y0, y1)
+pointcloud_t::Ptr generatePoints(const double x0, const double x1,
+                                 const double y0, const double y1,
+                                 std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> x(x0, x1);
+    std::uniform_real_distribution<double> y(y0, y1);
+
+    pointcloud_t::Ptr points(new pointcloud_t);
+    for (std::size_t i = 0 ; i < 500 ; ++i)
+        points->insert(point_t(x(rng), y(rng)));
+    return points;
+}
+
+/**
+ * @brief The incremental output has to hold the cells of the one-shot conversion at the
+ *        same position, everything around them is 0.
+ */
+void compare(const gridmap_t::Ptr &incremental,
+             const gridmap_t::Ptr &reference)
+{
+    ASSERT_TRUE(incremental);
+    ASSERT_TRUE(reference);
+    ASSERT_GT(reference->getWidth(),  0u);
+    ASSERT_GT(reference->getHeight(), 0u);
+
+    const long offset_x = std::lround((reference->getOrigin().tx() - incremental->getOrigin().tx()) / SAMPLING_RESOLUTION);
+    const long offset_y = std::lround((reference->getOrigin().ty() - incremental->getOrigin().ty()) / SAMPLING_RESOLUTION);
+    ASSERT_GE(offset_x, 0);
+    ASSERT_GE(offset_y, 0);
+    ASSERT_LE(offset_x + static_cast<long>(reference->getWidth()),  static_cast<long>(incremental->getWidth()));
+    ASSERT_LE(offset_y + static_cast<long>(reference->getHeight()), static_cast<long>(incremental->getHeight()));
+
+    std::size_t mismatches = 0;
+    for (std::size_t y = 0 ; y < incremental->getHeight() ; ++y) {
+        for (std::size_t x = 0 ; x < incremental->getWidth() ; ++x) {
+            const long rx = static_cast<long>(x) - offset_x;
+            const long ry = static_cast<long>(y) - offset_y;
+            const bool inside = rx >= 0 && ry >= 0 &&
+                    rx < static_cast<long>(reference->getWidth()) &&
+                    ry < static_cast<long>(reference->getHeight());
+            const double expected = inside ? reference->at(rx, ry) : 0.0;
+            if (std::fabs(incremental->at(x, y) - expected) > 1e-9)
+                ++mismatches;
+        }
+    }
+    EXPECT_EQ(mismatches, 0u);
+}
+}
+
+TEST(Test_cslibs_ndt_2d, testIncrementalProbabilityGridmap)
+{
+    using map_t         = cslibs_ndt_2d::dynamic_maps::Gridmap;
+    using incremental_t = cslibs_ndt_2d::conversion::IncrementalProbabilityGridmap<map_t>;
+
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    std::mt19937 rng(42);
+
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    incremental_t incremental(SAMPLING_RESOLUTION, 2);
+    EXPECT_FALSE(incremental.getGridmap());
+
+    /// the first update allocates, growing in either direction reallocates, rounds inside
+    /// the output only touch the changed region
+    struct Round { double x0, x1, y0, y1; bool reallocated; };
+    const std::vector<Round> rounds = {{ 0.0,  4.0,  0.0,  4.0, true},
+                                       { 1.0,  3.0,  1.0,  3.0, false},
+                                       { 3.0,  7.0, -2.0,  1.0, true},
+                                       {-9.0, -6.0, -8.0, -5.0, true},
+                                       {-5.0,  0.0,  0.0,  2.0, false},
+                                       {12.0, 14.0, 10.0, 11.0, true}};
+    for (const Round &r : rounds) {
+        map->insert(pointcloud_t::ConstPtr(generatePoints(r.x0, r.x1, r.y0, r.y1, rng)));
+
+        const gridmap_t::Ptr before = incremental.getGridmap() ? gridmap_t::Ptr(new gridmap_t(*incremental.getGridmap())) : gridmap_t::Ptr();
+        const incremental_t::Region region = incremental.update(*map, cslibs_ndt::common::Kernel::EXACT, pool);
+        EXPECT_FALSE(region.empty());
+        EXPECT_EQ(region.reallocated, r.reallocated);
+
+        /// cells outside of the reported region are left as they were
+        const gridmap_t::Ptr &after = incremental.getGridmap();
+        if (!region.reallocated) {
+            ASSERT_TRUE(before);
+            ASSERT_EQ(before->getWidth(),  after->getWidth());
+            ASSERT_EQ(before->getHeight(), after->getHeight());
+            for (std::size_t y = 0 ; y < after->getHeight() ; ++y) {
+                for (std::size_t x = 0 ; x < after->getWidth() ; ++x) {
+                    if (x < region.x || x >= region.x + region.width ||
+                            y < region.y || y >= region.y + region.height) {
+                        EXPECT_EQ(after->at(x, y), before->at(x, y));
+                    }
+                }
+            }
+        }
+
+        gridmap_t::Ptr reference;
+        cslibs_ndt_2d::conversion::from(map, reference, SAMPLING_RESOLUTION, true,
+                                        cslibs_ndt::common::Kernel::EXACT, pool);
+        compare(after, reference);
+    }
+
+    /// nothing changed, nothing to do
+    EXPECT_TRUE(incremental.update(*map, cslibs_ndt::common::Kernel::EXACT, pool).empty());
+
+    /// after a reset the whole map is sampled again
+    incremental.reset();
+    EXPECT_TRUE(incremental.update(*map, cslibs_ndt::common::Kernel::EXACT, pool).reallocated);
+    gridmap_t::Ptr reference;
+    cslibs_ndt_2d::conversion::from(map, reference, SAMPLING_RESOLUTION, true,
+                                    cslibs_ndt::common::Kernel::EXACT, pool);
+    compare(incremental.getGridmap(), reference);
+}
+
+TEST(Test_cslibs_ndt_2d, testIncrementalProbabilityGridmapOccupancy)
+{
+    using map_t         = cslibs_ndt_2d::dynamic_maps::OccupancyGridmap;
+    using incremental_t = cslibs_ndt_2d::conversion::IncrementalProbabilityGridmap<map_t>;
+
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    const cslibs_gridmaps::utility::InverseModel::Ptr inverse_model(
+                new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    std::mt19937 rng(7);
+
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    incremental_t incremental(SAMPLING_RESOLUTION, inverse_model, 2);
+
+    /// the rays change free space between the sensor and the points as well
+    const std::vector<pose_t> origins = {pose_t(0.0, 0.0, 0.0), pose_t(2.0, 1.0, 0.0),
+                                         pose_t(-4.0, 3.0, 0.0), pose_t(1.0, -6.0, 0.0)};
+    for (const pose_t &origin : origins) {
+        const pointcloud_t::Ptr points = generatePoints(-3.0, 3.0, -3.0, 3.0, rng);
+        map->insert(points->begin(), points->end(), origin);
+
+        EXPECT_FALSE(incremental.update(*map, cslibs_ndt::common::Kernel::EXACT, pool).empty());
+
+        gridmap_t::Ptr reference;
+        cslibs_ndt_2d::conversion::from(map, reference, SAMPLING_RESOLUTION, inverse_model, true,
+                                        cslibs_ndt::common::Kernel::EXACT, pool);
+        compare(incremental.getGridmap(), reference);
+    }
+}
+
+TEST(Test_cslibs_ndt_2d, testIncrementalProbabilityGridmapConsumers)
+{
+    using map_t         = cslibs_ndt_2d::dynamic_maps::Gridmap;
+    using incremental_t = cslibs_ndt_2d::conversion::IncrementalProbabilityGridmap<map_t>;
+
+    std::mt19937 rng(3);
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    incremental_t first(SAMPLING_RESOLUTION);
+    incremental_t second(SAMPLING_RESOLUTION);
+
+    /// each consumer taking over the record makes the other one start over instead of
+    /// missing the changes it took
+    for (std::size_t i = 0 ; i < 4 ; ++i) {
+        for (incremental_t *incremental : {&first, &second}) {
+            map->insert(pointcloud_t::ConstPtr(generatePoints(-2.0, 2.0, -2.0 + i, 2.0 + i, rng)));
+            EXPECT_TRUE(incremental->update(*map).reallocated);
+
+            gridmap_t::Ptr reference;
+            cslibs_ndt_2d::conversion::from(map, reference, SAMPLING_RESOLUTION, true);
+            compare(incremental->getGridmap(), reference);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
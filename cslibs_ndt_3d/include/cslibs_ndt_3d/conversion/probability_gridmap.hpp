@@ -0,0 +1,52 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_PROBABILITY_GRIDMAP_HPP
+#define CSLIBS_NDT_3D_CONVERSION_PROBABILITY_GRIDMAP_HPP
+
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt_3d/conversion/projection.hpp>
+
+#include <cslibs_gridmaps/static_maps/probability_gridmap.h>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Project the occupancy between z_min and z_max in map coordinates onto a 2D gridmap
+ *        with the bundle resolution of the map, see Projection. Use Projection directly to
+ *        keep the gridmap up to date incrementally.
+ */
+inline void from(
+        const cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr &src,
+        cslibs_gridmaps::static_maps::ProbabilityGridmap::Ptr    &dst,
+        const cslibs_gridmaps::utility::InverseModel::Ptr         &inverse_model,
+        const double z_min,
+        const double z_max,
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+{
+    if (!src || !inverse_model)
+        return;
+
+    Projection<cslibs_ndt_3d::dynamic_maps::OccupancyGridmap> projection(inverse_model, z_min, z_max);
+    projection.compute(*src, pool);
+    dst = projection.getGridmap();
+}
+
+inline void from(
+        const cslibs_ndt_3d::static_maps::OccupancyGridmap::Ptr &src,
+        cslibs_gridmaps::static_maps::ProbabilityGridmap::Ptr   &dst,
+        const cslibs_gridmaps::utility::InverseModel::Ptr        &inverse_model,
+        const double z_min,
+        const double z_max,
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+{
+    if (!src || !inverse_model)
+        return;
+
+    Projection<cslibs_ndt_3d::static_maps::OccupancyGridmap> projection(inverse_model, z_min, z_max);
+    projection.compute(*src, pool);
+    dst = projection.getGridmap();
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_PROBABILITY_GRIDMAP_HPP
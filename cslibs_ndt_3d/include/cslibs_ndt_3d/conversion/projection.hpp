@@ -0,0 +1,196 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_PROJECTION_HPP
+#define CSLIBS_NDT_3D_CONVERSION_PROJECTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <cslibs_ndt/common/incremental_grid.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+
+#include <cslibs_gridmaps/static_maps/probability_gridmap.h>
+#include <cslibs_gridmaps/utility/inverse_model.hpp>
+
+#include <cslibs_math_2d/linear/pose.hpp>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Projects the occupancy of a 3D occupancy gridmap within a height band onto a 2D
+ *        ProbabilityGridmap, e.g. for navigation. Each cell is one column of bundles, so
+ *        the cell size is the bundle resolution. A bundle is the mean occupancy of its
+ *        observed distributions, a cell the maximum over the bundles of its column that
+ *        overlap the band. Cells without observed distributions are 0.
+ *
+ *        The band is given in map coordinates, the map origin should thus not be tilted.
+ *        Columns are evaluated concurrently without allocating anything in the map.
+ *        update() only evaluates the columns changed since the previous update, the changes
+ *        are taken from the dirty bundle record of the map, which the first update claims.
+ *        A record has a single consumer, another one taking it over makes the next update
+ *        project everything again. The output grows as an IncrementalGrid of columns, it may
+ *        thus extend beyond the map, those cells are 0. The map must not be changed during
+ *        an update.
+ */
+template<typename map_t>
+class Projection
+{
+public:
+    using Ptr       = std::shared_ptr<Projection>;
+    using index_t   = typename map_t::index_t;
+    using point_t   = typename map_t::point_t;
+    using dst_map_t = cslibs_gridmaps::static_maps::ProbabilityGridmap;
+    using grid_t    = cslibs_ndt::common::IncrementalGrid<dst_map_t>;
+    using column_t  = typename grid_t::block_t;
+    using Region    = typename grid_t::Region;
+
+    /**
+     * @param inverse_model - the inverse model to evaluate the occupancy
+     * @param z_min         - lower bound of the height band in map coordinates
+     * @param z_max         - upper bound of the height band in map coordinates
+     * @param margin        - minimum growth of the output in cells
+     */
+    inline explicit Projection(const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
+                               const double z_min,
+                               const double z_max,
+                               const std::size_t margin = 16) :
+        inverse_model_(inverse_model),
+        z_min_(z_min),
+        z_max_(z_max),
+        grid_(margin)
+    {
+        if (!inverse_model_)
+            throw std::runtime_error("inverse model not set!");
+    }
+
+    /**
+     * @brief Project the whole map into a new output, the map is left untouched.
+     * @param map  - the map
+     * @param pool - the columns are evaluated by this pool
+     */
+    inline void compute(const map_t &map,
+                        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+    {
+        std::vector<index_t> bundles;
+        map.getBundleIndices(bundles);
+
+        grid_.reset();
+        project(map, bundles, pool);
+    }
+
+    /**
+     * @brief Project the columns changed since the last update, everything on the first one.
+     * @param map  - the map, always the same one
+     * @param pool - the changed columns are evaluated by this pool
+     * @return the changed cells
+     */
+    inline Region update(map_t &map,
+                         const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+    {
+        /// without a complete record of the changes everything is projected again
+        std::vector<index_t> dirty;
+        grid_.takeChanges(map, dirty);
+        return project(map, dirty, pool);
+    }
+
+    /**
+     * @brief The output, nullptr before the first projection, empty if the map was.
+     */
+    inline const dst_map_t::Ptr& getGridmap() const
+    {
+        return grid_.getGrid();
+    }
+
+    /**
+     * @brief Drop the output, the next update projects the whole map.
+     */
+    inline void reset()
+    {
+        grid_.reset();
+    }
+
+private:
+    const cslibs_gridmaps::utility::InverseModel::Ptr inverse_model_;
+    const double                                      z_min_;
+    const double                                      z_max_;
+    grid_t                                            grid_;
+
+    inline Region project(const map_t &map,
+                          const std::vector<index_t> &changed,
+                          const cslibs_ndt::common::ThreadPool::Ptr &pool)
+    {
+        const double bundle_resolution = map.getBundleResolution();
+        const int    bz_lo = static_cast<int>(std::floor(z_min_ / bundle_resolution));
+        const int    bz_hi = std::max(bz_lo, static_cast<int>(std::ceil(z_max_ / bundle_resolution)) - 1);
+
+        /// a changed distribution is shared by the 3x3x3 bundles around the changed one
+        std::vector<column_t> columns;
+        columns.reserve(changed.size());
+        for (const index_t &bi : changed) {
+            if (bi[2] + 1 >= bz_lo && bi[2] - 1 <= bz_hi)
+                columns.emplace_back(column_t{{bi[0], bi[1]}});
+        }
+        grid_t::dilate(columns);
+
+        /// the corner of a column in map coordinates, the output is aligned with the map
+        const auto origin = [&map, bundle_resolution](const column_t &c) {
+            const point_t corner = map.getInitialOrigin() * point_t(c[0] * bundle_resolution,
+                                                                    c[1] * bundle_resolution,
+                                                                    0.0);
+            return cslibs_math_2d::Pose2d(corner(0), corner(1), map.getInitialOrigin().yaw());
+        };
+
+        column_t lo, hi;
+        if (!grid_t::bounds(columns, lo, hi)) {
+            /// nothing to project, the first output is empty and placed at the map origin
+            if (!grid_.getGrid())
+                grid_.reserve(column_t{{0, 0}}, column_t{{-1, -1}}, 1, bundle_resolution, origin);
+            return Region();
+        }
+        const bool reallocated = grid_.reserve(lo, hi, 1, bundle_resolution, origin);
+
+        const dst_map_t::Ptr &dst = grid_.getGrid();
+        const column_t min_c = grid_.getMin();
+        const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
+        p->parallelFor(0, columns.size(), 64,
+                       [this, &map, &columns, &dst, &min_c, bz_lo, bz_hi](const std::size_t, const std::size_t b, const std::size_t e) {
+            for (std::size_t i = b ; i < e ; ++i) {
+                const column_t &c = columns[i];
+                dst->at(static_cast<std::size_t>(c[0] - min_c[0]),
+                        static_cast<std::size_t>(c[1] - min_c[1])) = column(map, c, bz_lo, bz_hi);
+            }
+        });
+
+        return grid_.region(lo, hi, 1, reallocated);
+    }
+
+    inline double column(const map_t &map,
+                         const column_t &c,
+                         const int bz_lo,
+                         const int bz_hi) const
+    {
+        typename map_t::distribution_const_bundle_t::data_t bundle;
+        double occupancy = 0.0;
+        for (int bz = bz_lo ; bz <= bz_hi ; ++bz) {
+            if (!map.lookupDistributionBundle(index_t{{c[0], c[1], bz}}, bundle))
+                continue;
+
+            double      sum = 0.0;
+            std::size_t n   = 0;
+            for (const auto *d : bundle) {
+                if (d && (d->numFree() > 0 || d->numOccupied() > 0)) {
+                    sum += d->computeOccupancy(*inverse_model_);
+                    ++n;
+                }
+            }
+            if (n > 0)
+                occupancy = std::max(occupancy, sum / static_cast<double>(n));
+        }
+        return occupancy;
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_PROJECTION_HPP
@@ -6,10 +6,27 @@
 #include <cslibs_ndt_3d/static_maps/gridmap.hpp>
 #include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
 
+#include <cslibs_ndt/common/thread_pool.hpp>
+
 #include <sensor_msgs/PointCloud2.h>
 
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
 namespace cslibs_ndt_3d {
 namespace conversion {
+/**
+ * @brief Optional fields of every point besides x, y, z and intensity.
+ */
+struct PointCloud2Fields
+{
+    bool covariance = false;    /// cov_xx, cov_xy, cov_xz, cov_yy, cov_yz and cov_zz as FLOAT32
+    bool occupancy  = false;    /// the mean occupancy of the bundle as FLOAT32, occupancy maps only
+    bool n          = false;    /// the number of samples of the bundle as UINT32
+};
+
 inline void from(
         const std::vector<float> &tmp,
         sensor_msgs::PointCloud2 &dst)
@@ -40,133 +57,274 @@ inline void from(
     memcpy(&dst.data[0], &tmp[0], data_size);
 }
 
-template<typename ndt_t,
-         typename = typename std::enable_if<std::is_same<ndt_t, cslibs_ndt_3d::dynamic_maps::Gridmap>::value
-                                            || std::is_same<ndt_t, cslibs_ndt_3d::static_maps::Gridmap>::value>::type>
-inline void from(
-        ndt_t &src,
-        sensor_msgs::PointCloud2 &dst)
+namespace impl {
+/// the gaussian of a distribution wrapper, nullptr if there is none
+inline const cslibs_ndt::Distribution<3>::distribution_t* statistics(const cslibs_ndt::Distribution<3> &d)
+{
+    return &d.data();
+}
+
+inline const cslibs_ndt::OccupancyDistribution<3>::distribution_t* statistics(const cslibs_ndt::OccupancyDistribution<3> &d)
+{
+    return d.getDistribution().get();
+}
+
+inline void addField(sensor_msgs::PointCloud2 &dst,
+                     const std::string &name,
+                     const uint8_t datatype,
+                     const uint32_t size)
+{
+    sensor_msgs::PointField field;
+    field.name     = name;
+    field.offset   = dst.point_step;
+    field.datatype = datatype;
+    field.count    = 1;
+    dst.fields.emplace_back(field);
+    dst.point_step += size;
+}
+
+template<typename T>
+inline void write(uint8_t *&data,
+                  const T value)
 {
-    src.allocatePartiallyAllocatedBundles();
+    std::memcpy(data, &value, sizeof(T));
+    data += sizeof(T);
+}
 
-    using index_t = std::array<int, 3>;
-    using point_t = cslibs_math_3d::Point3d;
+/**
+ * @brief Writes one point per bundle with samples, the mean of its merged distributions, in
+ *        two passes: the points are counted, then written straight into the message. Both
+ *        passes are split across the pool.
+ *
+ *        The map is not changed. The bundles which allocatePartiallyAllocatedBundles would add
+ *        are visited through the non-allocating lookup, missing distributions count as newly
+ *        allocated ones, so the points equal those of allocating the bundles beforehand.
+ *
+ * @param occupancy - occupancy(d) of a distribution, d may be nullptr, called concurrently
+ * @param threshold - bundles with a lower mean occupancy are skipped
+ */
+template<typename ndt_t, typename occupancy_fn_t>
+inline void from(const ndt_t &src,
+                 sensor_msgs::PointCloud2 &dst,
+                 const occupancy_fn_t &occupancy,
+                 const double threshold,
+                 const bool has_occupancy,
+                 const PointCloud2Fields &fields,
+                 const cslibs_ndt::common::ThreadPool::Ptr &pool)
+{
+    using index_t        = typename ndt_t::index_t;
     using distribution_t = typename ndt_t::distribution_t;
-    using distribution_bundle_t = typename ndt_t::distribution_bundle_t;
-    auto sample = [](const distribution_t *d,
-                     const point_t &p) -> double {
-        return d ? d->data().sampleNonNormalized(p) : 0.0;
-    };
-    auto sample_bundle = [&sample](const distribution_bundle_t &b,
-                                   const point_t &p) -> double {
-        return 0.125 * (sample(b.at(0), p) +
-                        sample(b.at(1), p) +
-                        sample(b.at(2), p) +
-                        sample(b.at(3), p) +
-                        sample(b.at(4), p) +
-                        sample(b.at(5), p) +
-                        sample(b.at(6), p) +
-                        sample(b.at(7), p));
+    using bundle_t       = typename ndt_t::distribution_const_bundle_t::data_t;
+    using statistics_t   = cslibs_math::statistics::Distribution<3, 3>;
+
+    /// lazily updated caches are filled serially, sampling is safe to run concurrently afterwards
+    for (const auto &storage : src.getStorages()) {
+        storage->traverse([](const index_t &, const distribution_t &d) {
+            const auto *s = statistics(d);
+            if (s && s->valid())
+                s->getInformationMatrix();
+        });
+    }
+
+    /// the neighbours allocatePartiallyAllocatedBundles would add
+    std::vector<index_t> bundles;
+    src.getBundleIndices(bundles);
+    const std::size_t allocated = bundles.size();
+    for (std::size_t i = 0 ; i < allocated ; ++i) {
+        const index_t bi = bundles[i];
+        bundle_t bundle;
+        if (!src.lookupDistributionBundle(bi, bundle))
+            continue;
+
+        const bool expand = std::any_of(bundle.begin(), bundle.end(), [](const distribution_t *d) {
+            const auto *s = d ? statistics(*d) : nullptr;
+            return s && s->getN() >= 3;
+        });
+        if (!expand)
+            continue;
+
+        for (int dx = -1 ; dx <= 1 ; ++dx) {
+            for (int dy = -1 ; dy <= 1 ; ++dy) {
+                for (int dz = -1 ; dz <= 1 ; ++dz) {
+                    if (dx != 0 || dy != 0 || dz != 0)
+                        bundles.emplace_back(index_t{{bi[0] + dx, bi[1] + dy, bi[2] + dz}});
+                }
+            }
+        }
+    }
+    std::sort(bundles.begin(), bundles.end());
+    bundles.erase(std::unique(bundles.begin(), bundles.end()), bundles.end());
+
+    auto merge = [&occupancy, threshold](const bundle_t &bundle,
+                                         statistics_t &merged,
+                                         double &mean_occupancy) {
+        mean_occupancy = 0.0;
+        for (const distribution_t *d : bundle) {
+            mean_occupancy += 0.125 * occupancy(d);
+            if (const auto *s = d ? statistics(*d) : nullptr)
+                merged += *s;
+        }
+        return merged.getN() > 0 && mean_occupancy >= threshold;
     };
 
-    std::vector<float> tmp;
-    auto process_bundle = [&src, &tmp, &sample_bundle](const index_t &bi, const distribution_bundle_t &b) {
-        cslibs_math::statistics::Distribution<3, 3> d;
-        for (std::size_t i = 0 ; i < 8 ; ++i)
-            d += b.at(i)->data();
-        if (d.getN() == 0)
-            return;
-
-        cslibs_math_3d::Point3d mean(d.getMean());
-        tmp.emplace_back(static_cast<float>(mean(0)));
-        tmp.emplace_back(static_cast<float>(mean(1)));
-        tmp.emplace_back(static_cast<float>(mean(2)));
-        tmp.emplace_back(static_cast<float>(sample_bundle(b, mean)));
+    /// first pass, the index of every point
+    const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
+    std::vector<uint8_t> accepted(bundles.size(), 0);
+    p->parallelFor(0, bundles.size(), 256, [&src, &bundles, &accepted, &merge](const std::size_t, const std::size_t b, const std::size_t e) {
+        for (std::size_t i = b ; i < e ; ++i) {
+            bundle_t     bundle;
+            statistics_t merged;
+            double       mean_occupancy;
+            accepted[i] = src.lookupDistributionBundle(bundles[i], bundle) && merge(bundle, merged, mean_occupancy);
+        }
+    });
+
+    std::vector<std::size_t> indices(bundles.size());
+    std::size_t size = 0;
+    for (std::size_t i = 0 ; i < bundles.size() ; ++i) {
+        indices[i] = size;
+        size += accepted[i];
+    }
+
+    // metadata
+    dst.height       = 1;
+    dst.width        = static_cast<uint32_t>(size);
+    dst.is_dense     = false;
+    dst.is_bigendian = false;
+    dst.point_step   = 0;
+
+    // fields
+    dst.fields.clear();
+    addField(dst, "x",         sensor_msgs::PointField::FLOAT32, sizeof(float));
+    addField(dst, "y",         sensor_msgs::PointField::FLOAT32, sizeof(float));
+    addField(dst, "z",         sensor_msgs::PointField::FLOAT32, sizeof(float));
+    addField(dst, "intensity", sensor_msgs::PointField::FLOAT32, sizeof(float));
+    if (fields.covariance) {
+        addField(dst, "cov_xx", sensor_msgs::PointField::FLOAT32, sizeof(float));
+        addField(dst, "cov_xy", sensor_msgs::PointField::FLOAT32, sizeof(float));
+        addField(dst, "cov_xz", sensor_msgs::PointField::FLOAT32, sizeof(float));
+        addField(dst, "cov_yy", sensor_msgs::PointField::FLOAT32, sizeof(float));
+        addField(dst, "cov_yz", sensor_msgs::PointField::FLOAT32, sizeof(float));
+        addField(dst, "cov_zz", sensor_msgs::PointField::FLOAT32, sizeof(float));
+    }
+    const bool write_occupancy = fields.occupancy && has_occupancy;
+    if (write_occupancy)
+        addField(dst, "occupancy", sensor_msgs::PointField::FLOAT32, sizeof(float));
+    if (fields.n)
+        addField(dst, "n", sensor_msgs::PointField::UINT32, sizeof(uint32_t));
+    dst.row_step = dst.point_step * dst.width;
+
+    // data
+    dst.data.resize(static_cast<std::size_t>(dst.row_step));
+
+    /// second pass, every point is written to its own slot
+    const std::size_t point_step = dst.point_step;
+    uint8_t *data = dst.data.data();
+    p->parallelFor(0, bundles.size(), 256,
+                   [&src, &bundles, &accepted, &indices, &merge, &occupancy, &fields, write_occupancy, point_step, data]
+                   (const std::size_t, const std::size_t b, const std::size_t e) {
+        for (std::size_t i = b ; i < e ; ++i) {
+            if (!accepted[i])
+                continue;
+
+            bundle_t     bundle;
+            statistics_t merged;
+            double       mean_occupancy;
+            src.lookupDistributionBundle(bundles[i], bundle);
+            merge(bundle, merged, mean_occupancy);
+
+            const statistics_t::sample_t mean = merged.getMean();
+            double intensity = 0.0;
+            for (const distribution_t *d : bundle) {
+                if (const auto *s = d ? statistics(*d) : nullptr)
+                    intensity += 0.125 * s->sampleNonNormalized(mean) * occupancy(d);
+            }
+
+            uint8_t *point = data + indices[i] * point_step;
+            write(point, static_cast<float>(mean(0)));
+            write(point, static_cast<float>(mean(1)));
+            write(point, static_cast<float>(mean(2)));
+            write(point, static_cast<float>(intensity));
+            if (fields.covariance) {
+                const statistics_t::covariance_t covariance = merged.getCovariance();
+                write(point, static_cast<float>(covariance(0, 0)));
+                write(point, static_cast<float>(covariance(0, 1)));
+                write(point, static_cast<float>(covariance(0, 2)));
+                write(point, static_cast<float>(covariance(1, 1)));
+                write(point, static_cast<float>(covariance(1, 2)));
+                write(point, static_cast<float>(covariance(2, 2)));
+            }
+            if (write_occupancy)
+                write(point, static_cast<float>(mean_occupancy));
+            if (fields.n)
+                write(point, static_cast<uint32_t>(merged.getN()));
+        }
+    });
+}
+}
+
+template<typename ndt_t,
+         typename = typename std::enable_if<std::is_same<ndt_t, cslibs_ndt_3d::dynamic_maps::Gridmap>::value
+                                            || std::is_same<ndt_t, cslibs_ndt_3d::static_maps::Gridmap>::value>::type>
+inline void from(
+        const ndt_t &src,
+        sensor_msgs::PointCloud2 &dst,
+        const PointCloud2Fields &fields = PointCloud2Fields(),
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+{
+    auto occupancy = [](const typename ndt_t::distribution_t *) {
+        return 1.0;
     };
-    src.traverse(process_bundle);
-    from(tmp, dst);
+    impl::from(src, dst, occupancy, 0.0, false, fields, pool);
 }
 
 inline void from(
         const cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr &src,
-        sensor_msgs::PointCloud2 &dst)
+        sensor_msgs::PointCloud2 &dst,
+        const PointCloud2Fields &fields = PointCloud2Fields(),
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     if (!src)
         return;
 
-    from(*src, dst);
+    from(*src, dst, fields, pool);
 }
 
 template<typename ndt_t,
         typename = typename std::enable_if<std::is_same<ndt_t, cslibs_ndt_3d::dynamic_maps::OccupancyGridmap>::value
                                            || std::is_same<ndt_t, cslibs_ndt_3d::static_maps::OccupancyGridmap>::value>::type>
 inline void from(
-        ndt_t &src,
+        const ndt_t &src,
         sensor_msgs::PointCloud2 &dst,
         const cslibs_gridmaps::utility::InverseModel::Ptr &ivm,
-        const double &threshold = 0.169)
+        const double &threshold = 0.169,
+        const PointCloud2Fields &fields = PointCloud2Fields(),
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
-    src.allocatePartiallyAllocatedBundles();
+    if (!ivm)
+        throw std::runtime_error("inverse model not set!");
 
-    using index_t = std::array<int, 3>;
-    using point_t = cslibs_math_3d::Point3d;
     using distribution_t = typename ndt_t::distribution_t;
-    using distribution_bundle_t = typename ndt_t::distribution_bundle_t;
-    auto sample = [&ivm](const distribution_t *d,
-                         const point_t &p) -> double {
-        auto evaluate = [&ivm, d, p] {
-            const auto &handle = d;
-            return d && handle->getDistribution() ?
-                        handle->getDistribution()->sampleNonNormalized(p) * handle->getOccupancy(ivm) : 0.0;
-        };
-        return d ? evaluate() : 0.0;
-    };
-    auto sample_bundle = [&sample](const distribution_bundle_t &b,
-                                   const point_t &p) -> double {
-        return 0.125 * (sample(b.at(0), p) +
-                        sample(b.at(1), p) +
-                        sample(b.at(2), p) +
-                        sample(b.at(3), p) +
-                        sample(b.at(4), p) +
-                        sample(b.at(5), p) +
-                        sample(b.at(6), p) +
-                        sample(b.at(7), p));
-    };
-
-    std::vector<float> tmp;
-    auto process_bundle = [&src, &tmp, &ivm, &threshold, &sample_bundle](const index_t &bi, const distribution_bundle_t &b) {
-        cslibs_math::statistics::Distribution<3, 3> d;
-        double occupancy = 0.0;
-
-        for (std::size_t i = 0 ; i < 8 ; ++i) {
-            const auto &handle = b.at(i);
-            occupancy += 0.125 * handle->getOccupancy(ivm);
-            if (const auto &d_tmp = handle->getDistribution())
-                d += *d_tmp;
-        }
-        if (d.getN() == 0 || occupancy < threshold)
-            return;
-
-        cslibs_math_3d::Point3d mean(d.getMean());
-        tmp.emplace_back(static_cast<float>(mean(0)));
-        tmp.emplace_back(static_cast<float>(mean(1)));
-        tmp.emplace_back(static_cast<float>(mean(2)));
-        tmp.emplace_back(static_cast<float>(sample_bundle(b, mean)));
+    /// missing distributions count as unobserved ones
+    const double unobserved = distribution_t().computeOccupancy(*ivm);
+    auto occupancy = [&ivm, unobserved](const distribution_t *d) {
+        return d ? d->computeOccupancy(*ivm) : unobserved;
     };
-    src.traverse(process_bundle);
-    from(tmp, dst);
+    impl::from(src, dst, occupancy, threshold, true, fields, pool);
 }
 
 inline void from(
         const cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr &src,
         sensor_msgs::PointCloud2 &dst,
         const cslibs_gridmaps::utility::InverseModel::Ptr &ivm,
-        const double &threshold = 0.169)
+        const double &threshold = 0.169,
+        const PointCloud2Fields &fields = PointCloud2Fields(),
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
 {
     if (!src)
         return;
 
-    from(*src, dst, ivm, threshold);
+    from(*src, dst, ivm, threshold, fields, pool);
 }
 
 }
@@ -0,0 +1,463 @@
+#ifndef CSLIBS_NDT_3D_CONVERSION_VOXEL_GRID_HPP
+#define CSLIBS_NDT_3D_CONVERSION_VOXEL_GRID_HPP
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
+
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+#include <cslibs_ndt/common/index_hash.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+
+#include <cslibs_math_3d/linear/pose.hpp>
+#include <cslibs_math_3d/linear/point.hpp>
+
+namespace cslibs_ndt_3d {
+namespace conversion {
+/**
+ * @brief Sparse voxel occupancy in map coordinates. Voxels are grouped into cubic chunks of
+ *        CHUNK_SIZE^3, only chunks holding occupied voxels are stored. A chunk holds a bitset
+ *        of its occupied voxels and their occupancy quantized to a byte, voxels which are not
+ *        occupied are 0.
+ */
+class VoxelGrid
+{
+public:
+    using Ptr     = std::shared_ptr<VoxelGrid>;
+    using index_t = std::array<int, 3>;
+    using pose_t  = cslibs_math_3d::Pose3d;
+    using point_t = cslibs_math_3d::Point3d;
+
+    /// voxels per chunk side
+    static constexpr int         CHUNK_SIZE   = 16;
+    static constexpr std::size_t CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+
+    struct Chunk
+    {
+        std::bitset<CHUNK_VOLUME>                 occupied;
+        std::array<std::uint8_t, CHUNK_VOLUME>    occupancy;
+
+        inline Chunk()
+        {
+            occupancy.fill(0);
+        }
+
+        /// x runs fastest
+        static inline std::size_t offset(const int x, const int y, const int z)
+        {
+            return static_cast<std::size_t>((z * CHUNK_SIZE + y) * CHUNK_SIZE + x);
+        }
+    };
+
+    using chunk_storage_t = std::unordered_map<index_t, Chunk, cslibs_ndt::common::IndexHash<3>>;
+
+    /**
+     * @param origin     - the origin of the map, voxel (0, 0, 0) starts there
+     * @param resolution - the voxel size
+     */
+    inline explicit VoxelGrid(const pose_t &origin,
+                              const double resolution) :
+        w_T_m_(origin),
+        m_T_w_(origin.inverse()),
+        resolution_(resolution),
+        resolution_inv_(1.0 / resolution)
+    {
+    }
+
+    inline const pose_t& getOrigin() const
+    {
+        return w_T_m_;
+    }
+
+    inline double getResolution() const
+    {
+        return resolution_;
+    }
+
+    inline index_t toVoxelIndex(const point_t &p_w) const
+    {
+        const point_t p_m = m_T_w_ * p_w;
+        return {{static_cast<int>(std::floor(p_m(0) * resolution_inv_)),
+                 static_cast<int>(std::floor(p_m(1) * resolution_inv_)),
+                 static_cast<int>(std::floor(p_m(2) * resolution_inv_))}};
+    }
+
+    /**
+     * @brief The center of a voxel in world coordinates.
+     */
+    inline point_t getCenter(const index_t &vi) const
+    {
+        return w_T_m_ * point_t((vi[0] + 0.5) * resolution_,
+                                (vi[1] + 0.5) * resolution_,
+                                (vi[2] + 0.5) * resolution_);
+    }
+
+    inline bool isOccupied(const index_t &vi) const
+    {
+        index_t ci, li;
+        split(vi, ci, li);
+        const Chunk *c = getChunk(ci);
+        return c && c->occupied[Chunk::offset(li[0], li[1], li[2])];
+    }
+
+    /**
+     * @brief The quantized occupancy of a voxel in [0, 1], 0 if it is not occupied.
+     */
+    inline double getOccupancy(const index_t &vi) const
+    {
+        index_t ci, li;
+        split(vi, ci, li);
+        const Chunk *c = getChunk(ci);
+        return c ? c->occupancy[Chunk::offset(li[0], li[1], li[2])] / 255.0 : 0.0;
+    }
+
+    inline const Chunk* getChunk(const index_t &ci) const
+    {
+        const auto it = chunks_.find(ci);
+        return it != chunks_.end() ? &it->second : nullptr;
+    }
+
+    /**
+     * @brief Get a chunk, allocating it if necessary. Not thread safe, the returned chunk
+     *        stays valid while other chunks are allocated.
+     */
+    inline Chunk& getAllocate(const index_t &ci)
+    {
+        return chunks_[ci];
+    }
+
+    inline void erase(const index_t &ci)
+    {
+        chunks_.erase(ci);
+    }
+
+    inline const chunk_storage_t& getChunks() const
+    {
+        return chunks_;
+    }
+
+    /**
+     * @brief Call function(voxel_index, occupancy) for every occupied voxel.
+     */
+    template<typename Fn>
+    inline void traverse(const Fn &function) const
+    {
+        for (const auto &c : chunks_) {
+            const Chunk &chunk = c.second;
+            for (int z = 0 ; z < CHUNK_SIZE ; ++z) {
+                for (int y = 0 ; y < CHUNK_SIZE ; ++y) {
+                    for (int x = 0 ; x < CHUNK_SIZE ; ++x) {
+                        const std::size_t o = Chunk::offset(x, y, z);
+                        if (chunk.occupied[o])
+                            function(index_t{{c.first[0] * CHUNK_SIZE + x,
+                                              c.first[1] * CHUNK_SIZE + y,
+                                              c.first[2] * CHUNK_SIZE + z}},
+                                     chunk.occupancy[o] / 255.0);
+                    }
+                }
+            }
+        }
+    }
+
+    inline std::size_t getByteSize() const
+    {
+        return sizeof(*this) + chunks_.size() * (sizeof(index_t) + sizeof(Chunk));
+    }
+
+    /**
+     * @brief Split a voxel index into the chunk index and the index within the chunk.
+     */
+    static inline void split(const index_t &vi,
+                             index_t &ci,
+                             index_t &li)
+    {
+        for (std::size_t i = 0 ; i < 3 ; ++i) {
+            ci[i] = vi[i] >= 0 ? vi[i] / CHUNK_SIZE : -((CHUNK_SIZE - 1 - vi[i]) / CHUNK_SIZE);
+            li[i] = vi[i] - ci[i] * CHUNK_SIZE;
+        }
+    }
+
+private:
+    pose_t          w_T_m_;
+    pose_t          m_T_w_;
+    double          resolution_;
+    double          resolution_inv_;
+    chunk_storage_t chunks_;
+};
+
+/**
+ * @brief Samples a 3D occupancy gridmap onto a VoxelGrid at an arbitrary resolution. A voxel
+ *        is sampled at its center by the bundle containing it, i.e. the sum over the valid
+ *        distributions of the bundle of their gaussian scaled by their occupancy, divided by 8.
+ *        Voxels reaching the threshold are occupied.
+ *
+ *        Within allocated bundles this equals sampleNonNormalized of the map, up to the
+ *        quantization of the occupancy. The bundles around allocated ones, which share their
+ *        distributions but were never allocated themselves, are evaluated as well through the
+ *        non-allocating bundle lookup, while sampleNonNormalized returns 0 there. The map is
+ *        only read. Bundles whose distributions cannot reach the threshold, even at their
+ *        means, are not sampled at all. Chunks are filled in parallel, every chunk is written
+ *        by exactly one task.
+ */
+template<typename map_t>
+class VoxelRasterization
+{
+public:
+    using index_t        = typename map_t::index_t;
+    using point_t        = typename map_t::point_t;
+    using distribution_t = typename map_t::distribution_t;
+    using bundle_t       = typename map_t::distribution_const_bundle_t::data_t;
+
+    /**
+     * @param map                 - the map to sample
+     * @param inverse_model       - the inverse model to evaluate the occupancy
+     * @param sampling_resolution - the voxel size
+     * @param threshold           - voxels at or above are occupied
+     */
+    inline explicit VoxelRasterization(const map_t &map,
+                                       const cslibs_gridmaps::utility::InverseModel::Ptr &inverse_model,
+                                       const double sampling_resolution,
+                                       const double threshold) :
+        map_(map),
+        inverse_model_(inverse_model),
+        sampling_resolution_(sampling_resolution),
+        threshold_(threshold)
+    {
+        if (!inverse_model_)
+            throw std::runtime_error("inverse model not set!");
+    }
+
+    /**
+     * @param dst    - the output, replaced
+     * @param kernel - how the gaussians are evaluated
+     * @param pool   - the chunks are filled by this pool
+     */
+    inline void apply(VoxelGrid &dst,
+                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT,
+                      const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault()) const
+    {
+        dst = VoxelGrid(map_.getInitialOrigin(), sampling_resolution_);
+
+        /// distributions are shared by the 3x3x3 bundles around an allocated one
+        std::vector<index_t> allocated;
+        map_.getBundleIndices(allocated);
+        std::vector<index_t> candidates;
+        candidates.reserve(27 * allocated.size());
+        for (const index_t &bi : allocated) {
+            for (int dx = -1 ; dx <= 1 ; ++dx) {
+                for (int dy = -1 ; dy <= 1 ; ++dy) {
+                    for (int dz = -1 ; dz <= 1 ; ++dz)
+                        candidates.emplace_back(index_t{{bi[0] + dx, bi[1] + dy, bi[2] + dz}});
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        /// lazily updated caches are filled serially, the chunks each bundle overlaps are gathered
+        std::unordered_map<index_t, std::size_t, cslibs_ndt::common::IndexHash<3>> chunk_indices;
+        std::vector<index_t>              chunks;
+        std::vector<std::vector<index_t>> chunk_bundles;
+        for (const index_t &bi : candidates) {
+            if (!prepare(bi))
+                continue;
+
+            index_t lo, hi, lo_c, hi_c, li;
+            voxels(bi, lo, hi);
+            VoxelGrid::split(lo, lo_c, li);
+            VoxelGrid::split(hi, hi_c, li);
+            for (int cx = lo_c[0] ; cx <= hi_c[0] ; ++cx) {
+                for (int cy = lo_c[1] ; cy <= hi_c[1] ; ++cy) {
+                    for (int cz = lo_c[2] ; cz <= hi_c[2] ; ++cz) {
+                        const index_t ci{{cx, cy, cz}};
+                        const auto it = chunk_indices.emplace(ci, chunks.size());
+                        if (it.second) {
+                            chunks.emplace_back(ci);
+                            chunk_bundles.emplace_back();
+                        }
+                        chunk_bundles[it.first->second].emplace_back(bi);
+                    }
+                }
+            }
+        }
+
+        std::vector<VoxelGrid::Chunk*> storage(chunks.size());
+        for (std::size_t i = 0 ; i < chunks.size() ; ++i)
+            storage[i] = &dst.getAllocate(chunks[i]);
+
+        std::vector<std::uint8_t> used(chunks.size(), 0);
+        const cslibs_ndt::common::ThreadPool::Ptr p = pool ? pool : cslibs_ndt::common::ThreadPool::getDefault();
+        p->parallelFor(0, chunks.size(), 1,
+                       [this, &chunks, &chunk_bundles, &storage, &used, kernel](const std::size_t, const std::size_t b, const std::size_t e) {
+            for (std::size_t i = b ; i < e ; ++i) {
+                for (const index_t &bi : chunk_bundles[i])
+                    rasterize(bi, chunks[i], *storage[i], kernel);
+                used[i] = storage[i]->occupied.any();
+            }
+        });
+
+        for (std::size_t i = 0 ; i < chunks.size() ; ++i) {
+            if (!used[i])
+                dst.erase(chunks[i]);
+        }
+    }
+
+private:
+    /**
+     * @brief Quadratic form of one distribution in map coordinates, the exponent at p is
+     *        (p - mean)^T Q (p - mean) with Q = -0.5 * information.
+     */
+    struct Form
+    {
+        Eigen::Vector3d mean;
+        Eigen::Matrix3d q;
+        double          weight;
+    };
+
+    const map_t                                       &map_;
+    const cslibs_gridmaps::utility::InverseModel::Ptr  inverse_model_;
+    const double                                       sampling_resolution_;
+    const double                                       threshold_;
+
+    /**
+     * @brief The voxels [lo, hi] with their centers in a bundle, each voxel belongs to exactly one.
+     */
+    inline void voxels(const index_t &bi,
+                       index_t &lo,
+                       index_t &hi) const
+    {
+        const double bundle_resolution = map_.getBundleResolution();
+        for (std::size_t i = 0 ; i < 3 ; ++i) {
+            lo[i] = static_cast<int>(std::ceil(bi[i]       * bundle_resolution / sampling_resolution_ - 0.5));
+            hi[i] = static_cast<int>(std::ceil((bi[i] + 1) * bundle_resolution / sampling_resolution_ - 0.5)) - 1;
+        }
+    }
+
+    /**
+     * @brief Fill the lazily updated caches of the distributions of a bundle, not thread safe.
+     * @return if the bundle may hold occupied voxels
+     */
+    inline bool prepare(const index_t &bi) const
+    {
+        bundle_t bundle;
+        if (!map_.lookupDistributionBundle(bi, bundle))
+            return false;
+
+        double bound = 0.0;
+        for (const distribution_t *d : bundle) {
+            if (!d || !d->getDistribution() || !d->getDistribution()->valid())
+                continue;
+            d->getDistribution()->getInformationMatrix();
+            bound += 0.125 * d->computeOccupancy(*inverse_model_);
+        }
+        return bound > 0.0 && bound >= threshold_;
+    }
+
+    inline void rasterize(const index_t &bi,
+                          const index_t &ci,
+                          VoxelGrid::Chunk &chunk,
+                          const cslibs_ndt::common::Kernel kernel) const
+    {
+        bundle_t bundle;
+        if (!map_.lookupDistributionBundle(bi, bundle))
+            return;
+
+        std::array<Form, 8> forms;
+        std::size_t n = 0;
+        for (const distribution_t *d : bundle) {
+            if (!d || !d->getDistribution() || !d->getDistribution()->valid())
+                continue;
+            Form &f  = forms[n++];
+            f.mean   = d->getDistribution()->getMean();
+            f.q      = -0.5 * d->getDistribution()->getInformationMatrix();
+            f.weight = 0.125 * d->computeOccupancy(*inverse_model_);
+        }
+        if (n == 0)
+            return;
+
+        /// the voxels of the bundle within the chunk
+        index_t lo, hi;
+        voxels(bi, lo, hi);
+        for (std::size_t i = 0 ; i < 3 ; ++i) {
+            lo[i] = std::max(lo[i], ci[i] * VoxelGrid::CHUNK_SIZE);
+            hi[i] = std::min(hi[i], ci[i] * VoxelGrid::CHUNK_SIZE + VoxelGrid::CHUNK_SIZE - 1);
+        }
+
+        /// gaussians live in world coordinates, voxel centers are stepped along the map axes
+        const auto &w_T_m = map_.getInitialOrigin();
+        const point_t o  = w_T_m * point_t(0.0, 0.0, 0.0);
+        const Eigen::Vector3d ex = (w_T_m * point_t(sampling_resolution_, 0.0, 0.0)).data() - o.data();
+        const Eigen::Vector3d ey = (w_T_m * point_t(0.0, sampling_resolution_, 0.0)).data() - o.data();
+        const Eigen::Vector3d ez = (w_T_m * point_t(0.0, 0.0, sampling_resolution_)).data() - o.data();
+
+        for (int z = lo[2] ; z <= hi[2] ; ++z) {
+            for (int y = lo[1] ; y <= hi[1] ; ++y) {
+                const Eigen::Vector3d row = o.data() + (y + 0.5) * ey + (z + 0.5) * ez;
+                for (int x = lo[0] ; x <= hi[0] ; ++x) {
+                    const Eigen::Vector3d p = row + (x + 0.5) * ex;
+                    double value = 0.0;
+                    for (std::size_t i = 0 ; i < n ; ++i) {
+                        const Eigen::Vector3d q = p - forms[i].mean;
+                        value += forms[i].weight * cslibs_ndt::common::gaussian(q.dot(forms[i].q * q), kernel);
+                    }
+                    if (value < threshold_)
+                        continue;
+
+                    const std::size_t offset = VoxelGrid::Chunk::offset(x - ci[0] * VoxelGrid::CHUNK_SIZE,
+                                                                         y - ci[1] * VoxelGrid::CHUNK_SIZE,
+                                                                         z - ci[2] * VoxelGrid::CHUNK_SIZE);
+                    chunk.occupied.set(offset);
+                    chunk.occupancy[offset] = static_cast<std::uint8_t>(std::lround(std::min(value, 1.0) * 255.0));
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief Sample the occupancy of a 3D occupancy gridmap onto sparse voxels, see VoxelRasterization.
+ */
+inline void from(
+        const cslibs_ndt_3d::dynamic_maps::OccupancyGridmap::Ptr &src,
+        VoxelGrid::Ptr &dst,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &ivm,
+        const double sampling_resolution,
+        const double threshold = 0.169,
+        const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT,
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+{
+    if (!src || !ivm)
+        return;
+
+    dst.reset(new VoxelGrid(src->getInitialOrigin(), sampling_resolution));
+    VoxelRasterization<cslibs_ndt_3d::dynamic_maps::OccupancyGridmap>(*src, ivm, sampling_resolution, threshold).apply(*dst, kernel, pool);
+}
+
+inline void from(
+        const cslibs_ndt_3d::static_maps::OccupancyGridmap::Ptr &src,
+        VoxelGrid::Ptr &dst,
+        const cslibs_gridmaps::utility::InverseModel::Ptr &ivm,
+        const double sampling_resolution,
+        const double threshold = 0.169,
+        const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT,
+        const cslibs_ndt::common::ThreadPool::Ptr &pool = cslibs_ndt::common::ThreadPool::getDefault())
+{
+    if (!src || !ivm)
+        return;
+
+    dst.reset(new VoxelGrid(src->getInitialOrigin(), sampling_resolution));
+    VoxelRasterization<cslibs_ndt_3d::static_maps::OccupancyGridmap>(*src, ivm, sampling_resolution, threshold).apply(*dst, kernel, pool);
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_CONVERSION_VOXEL_GRID_HPP
@@ -13,6 +13,7 @@
 
 #include <cslibs_ndt/common/distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -249,20 +250,21 @@ public:
     }
 
 
-    inline double sampleNonNormalized(const point_t &p) const
+    inline double sampleNonNormalized(const point_t &p,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         const index_t bi = toBundleIndex(p);
         distribution_bundle_t *bundle = bundle_storage_->get(bi);
 
-        auto evaluate = [&p, &bundle]() {
-            return 0.125 * (bundle->at(0)->data().sampleNonNormalized(p) +
-                            bundle->at(1)->data().sampleNonNormalized(p) +
-                            bundle->at(2)->data().sampleNonNormalized(p) +
-                            bundle->at(3)->data().sampleNonNormalized(p) +
-                            bundle->at(4)->data().sampleNonNormalized(p) +
-                            bundle->at(5)->data().sampleNonNormalized(p) +
-                            bundle->at(6)->data().sampleNonNormalized(p) +
-                            bundle->at(7)->data().sampleNonNormalized(p));
+        auto evaluate = [&p, &bundle, kernel]() {
+            return 0.125 * (cslibs_ndt::common::sampleNonNormalized(bundle->at(0)->data(), p, kernel) +
+                            cslibs_ndt::common::sampleNonNormalized(bundle->at(1)->data(), p, kernel) +
+                            cslibs_ndt::common::sampleNonNormalized(bundle->at(2)->data(), p, kernel) +
+                            cslibs_ndt::common::sampleNonNormalized(bundle->at(3)->data(), p, kernel) +
+                            cslibs_ndt::common::sampleNonNormalized(bundle->at(4)->data(), p, kernel) +
+                            cslibs_ndt::common::sampleNonNormalized(bundle->at(5)->data(), p, kernel) +
+                            cslibs_ndt::common::sampleNonNormalized(bundle->at(6)->data(), p, kernel) +
+                            cslibs_ndt::common::sampleNonNormalized(bundle->at(7)->data(), p, kernel));
         };
         return bundle ? evaluate() : 0.0;
     }
@@ -294,6 +296,49 @@ public:
         return getAllocate(bi);
     }
 
+    /**
+     * @brief Get the distributions of a bundle without allocating anything, thus
+     *        safe to call concurrently. Distributions shared with neighbouring bundles
+     *        are found even if the bundle itself was never allocated.
+     * @param bi     - the bundle index
+     * @param bundle - the distributions, nullptr where none exists
+     * @return if at least one distribution exists
+     */
+    inline bool lookupDistributionBundle(const index_t &bi,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        const distribution_bundle_t *b = bundle_storage_->get(bi);
+        if(b) {
+            std::copy(b->begin(), b->end(), bundle.begin());
+            return true;
+        }
+
+        bool found = false;
+        for(std::size_t i = 0 ; i < 8 ; ++i) {
+            bundle[i] = storage_[i]->get(toStorageIndex(bi, i));
+            found |= bundle[i] != nullptr;
+        }
+        return found;
+    }
+
+    inline bool lookupDistributionBundle(const point_t &p,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        return lookupDistributionBundle(toBundleIndex(p), bundle);
+    }
+
+    /**
+     * @brief Get the distribution of one layer at a point without allocating anything.
+     * @param p     - the point
+     * @param layer - the layer / storage index in [0, 8)
+     * @return the distribution or nullptr
+     */
+    inline const distribution_t* lookupDistribution(const point_t &p,
+                                                    const std::size_t layer) const
+    {
+        return storage_[layer]->get(toStorageIndex(toBundleIndex(p), layer));
+    }
+
     inline double getBundleResolution() const
     {
         return bundle_resolution_;
@@ -465,6 +510,20 @@ protected:
         max_index_ = std::max(max_index_, chunk_index);
     }
 
+    inline index_t toStorageIndex(const index_t &bi,
+                                  const std::size_t layer) const
+    {
+        const int divx = cslibs_math::common::div<int>(bi[0], 2);
+        const int divy = cslibs_math::common::div<int>(bi[1], 2);
+        const int divz = cslibs_math::common::div<int>(bi[2], 2);
+        const int modx = cslibs_math::common::mod<int>(bi[0], 2);
+        const int mody = cslibs_math::common::mod<int>(bi[1], 2);
+        const int modz = cslibs_math::common::mod<int>(bi[2], 2);
+        return {{divx + ((layer & 1ul) ? modx : 0),
+                 divy + ((layer & 2ul) ? mody : 0),
+                 divz + ((layer & 4ul) ? modz : 0)}};
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
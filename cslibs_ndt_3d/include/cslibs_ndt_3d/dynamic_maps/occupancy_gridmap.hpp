@@ -1,10 +1,12 @@
 #ifndef CSLIBS_NDT_3D_DYNAMIC_MAPS_OCCUPANCY_GRIDMAP_HPP
 #define CSLIBS_NDT_3D_DYNAMIC_MAPS_OCCUPANCY_GRIDMAP_HPP
 
+#include <cassert>
 #include <array>
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <unordered_set>
 
 #include <cslibs_math_2d/linear/pose.hpp>
 
@@ -13,6 +15,8 @@
 
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+#include <cslibs_ndt/common/index_hash.hpp>
 
 #include <cslibs_math/linear/pointcloud.hpp>
 #include <cslibs_math/common/array.hpp>
@@ -54,6 +58,7 @@ public:
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 8>;
     using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::kdtree::KDTree>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
+    using dirty_bundle_set_t                = std::unordered_set<index_t, cslibs_ndt::common::IndexHash<3>>;
     using simple_iterator_t                 = cslibs_math_3d::algorithms::SimpleIterator;
     using inverse_sensor_model_t            = cslibs_gridmaps::utility::InverseModel;
 
@@ -248,10 +253,20 @@ public:
                               const inverse_sensor_model_t::Ptr &ivm,
                               const inverse_sensor_model_t::Ptr &ivm_visibility,
                               const pose_t &points_origin = pose_t())
+    {
+        insertVisible<line_iterator_t>(points->begin(), points->end(), ivm, ivm_visibility, points_origin);
+    }
+
+    template <typename line_iterator_t = simple_iterator_t, typename iterator_t>
+    inline void insertVisible(const iterator_t &points_begin,
+                              const iterator_t &points_end,
+                              const inverse_sensor_model_t::Ptr &ivm,
+                              const inverse_sensor_model_t::Ptr &ivm_visibility,
+                              const pose_t &points_origin = pose_t())
     {
         if (!ivm || !ivm_visibility) {
             std::cout << "[OccupancyGridmap3D]: Cannot evaluate visibility, using model-free update rule instead!" << std::endl;
-            return insert(points, points_origin);
+            return insert<line_iterator_t>(points_begin, points_end, points_origin);
         }
 
         const index_t start_bi = toBundleIndex(points_origin.translation());
@@ -276,8 +291,8 @@ public:
         };
 
         distribution_storage_t storage;
-        for (const auto &p : *points) {
-            const point_t pm = points_origin * p;
+        for (auto itr = points_begin ; itr != points_end ; ++itr) {
+            const point_t pm = points_origin * *itr;
             if (pm.isNormal()) {
                 const index_t &bi = toBundleIndex(pm);
                 distribution_t *d = storage.get(bi);
@@ -341,7 +356,8 @@ public:
     }
 
     inline double sampleNonNormalized(const point_t &p,
-                                      const inverse_sensor_model_t::Ptr &ivm) const
+                                      const inverse_sensor_model_t::Ptr &ivm,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         if (!ivm)
             throw std::runtime_error("[OccupancyGridMap]: inverse model not set");
@@ -349,11 +365,11 @@ public:
         const index_t bi = toBundleIndex(p);
         distribution_bundle_t *bundle  = bundle_storage_->get(bi);
 
-        auto sample = [&p, &ivm] (const distribution_t *d) {
-            auto do_sample = [&p, &ivm, &d]() {
+        auto sample = [&p, &ivm, kernel] (const distribution_t *d) {
+            auto do_sample = [&p, &ivm, &d, kernel]() {
                 const auto &handle = d;
                 return handle->getDistribution() ?
-                            handle->getDistribution()->sampleNonNormalized(p) * handle->getOccupancy(ivm) : 0.0;
+                            cslibs_ndt::common::sampleNonNormalized(*handle->getDistribution(), p, kernel) * handle->getOccupancy(ivm) : 0.0;
             };
             return d ? do_sample() : 0.0;
         };
@@ -397,6 +413,49 @@ public:
         return getAllocate(bi);
     }
 
+    /**
+     * @brief Get the distributions of a bundle without allocating anything, thus
+     *        safe to call concurrently. Distributions shared with neighbouring bundles
+     *        are found even if the bundle itself was never allocated.
+     * @param bi     - the bundle index
+     * @param bundle - the distributions, nullptr where none exists
+     * @return if at least one distribution exists
+     */
+    inline bool lookupDistributionBundle(const index_t &bi,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        const distribution_bundle_t *b = bundle_storage_->get(bi);
+        if(b) {
+            std::copy(b->begin(), b->end(), bundle.begin());
+            return true;
+        }
+
+        bool found = false;
+        for(std::size_t i = 0 ; i < 8 ; ++i) {
+            bundle[i] = storage_[i]->get(toStorageIndex(bi, i));
+            found |= bundle[i] != nullptr;
+        }
+        return found;
+    }
+
+    inline bool lookupDistributionBundle(const point_t &p,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        return lookupDistributionBundle(toBundleIndex(p), bundle);
+    }
+
+    /**
+     * @brief Get the distribution of one layer at a point without allocating anything.
+     * @param p     - the point
+     * @param layer - the layer / storage index in [0, 8)
+     * @return the distribution or nullptr
+     */
+    inline const distribution_t* lookupDistribution(const point_t &p,
+                                                    const std::size_t layer) const
+    {
+        return storage_[layer]->get(toStorageIndex(toBundleIndex(p), layer));
+    }
+
     inline double getBundleResolution() const
     {
         return bundle_resolution_;
@@ -505,6 +564,43 @@ public:
         }
     }
 
+    /**
+     * @brief Record the bundles whose distributions change from now on, e.g. to update
+     *        a conversion of the map incrementally. Tracking is off by default and copies
+     *        of the map start without it. Changes made through getDistributionBundle are
+     *        not recorded.
+     *
+     *        The record has a single consumer, since taking it clears it. Registering
+     *        another consumer drops the record, the previous one then no longer tracks
+     *        the map and has to start over instead of missing changes.
+     * @param consumer - the consumer of the record, nullptr disables tracking
+     */
+    inline void trackDirtyBundles(const void *consumer)
+    {
+        dirty_bundles_consumer_ = consumer;
+        dirty_bundles_.clear();
+    }
+
+    inline bool tracksDirtyBundles(const void *consumer) const
+    {
+        return consumer && dirty_bundles_consumer_ == consumer;
+    }
+
+    /**
+     * @brief Take the bundles changed since the last call and clear the record. The
+     *        changed distributions are shared with the neighbouring bundles, which
+     *        thus change as well.
+     * @param consumer - the consumer which registered the record
+     * @param bundles  - the changed bundle indices, in no particular order
+     */
+    inline void takeDirtyBundles(const void *consumer,
+                                 std::vector<index_t> &bundles)
+    {
+        assert(tracksDirtyBundles(consumer));
+        bundles.assign(dirty_bundles_.begin(), dirty_bundles_.end());
+        dirty_bundles_.clear();
+    }
+
 private:
     const double                                    resolution_;
     const double                                    bundle_resolution_;
@@ -517,6 +613,8 @@ private:
 
     mutable distribution_storage_array_t            storage_;
     mutable distribution_bundle_storage_ptr_t       bundle_storage_;
+    const void                                     *dirty_bundles_consumer_ = nullptr;
+    mutable dirty_bundle_set_t                      dirty_bundles_;
 
     inline distribution_t* getAllocate(const distribution_storage_ptr_t &s,
                                        const index_t &i) const
@@ -565,9 +663,16 @@ private:
         return get_allocate(bi);
     }
 
+    inline void markDirty(const index_t &bi) const
+    {
+        if (dirty_bundles_consumer_)
+            dirty_bundles_.insert(bi);
+    }
+
     inline void updateFree(const index_t &bi) const
     {
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateFree();
         bundle->at(1)->updateFree();
         bundle->at(2)->updateFree();
@@ -582,6 +687,7 @@ private:
                            const std::size_t &n) const
     {
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateFree(n);
         bundle->at(1)->updateFree(n);
         bundle->at(2)->updateFree(n);
@@ -596,6 +702,7 @@ private:
                                const point_t &p) const
     {
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateOccupied(p);
         bundle->at(1)->updateOccupied(p);
         bundle->at(2)->updateOccupied(p);
@@ -610,6 +717,7 @@ private:
                                const distribution_t::distribution_ptr_t &d) const
     {
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateOccupied(d);
         bundle->at(1)->updateOccupied(d);
         bundle->at(2)->updateOccupied(d);
@@ -626,6 +734,20 @@ private:
         max_index_ = std::max(max_index_, bi);
     }
 
+    inline index_t toStorageIndex(const index_t &bi,
+                                  const std::size_t layer) const
+    {
+        const int divx = cslibs_math::common::div<int>(bi[0], 2);
+        const int divy = cslibs_math::common::div<int>(bi[1], 2);
+        const int divz = cslibs_math::common::div<int>(bi[2], 2);
+        const int modx = cslibs_math::common::mod<int>(bi[0], 2);
+        const int mody = cslibs_math::common::mod<int>(bi[1], 2);
+        const int modz = cslibs_math::common::mod<int>(bi[2], 2);
+        return {{divx + ((layer & 1ul) ? modx : 0),
+                 divy + ((layer & 2ul) ? mody : 0),
+                 divz + ((layer & 4ul) ? modz : 0)}};
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
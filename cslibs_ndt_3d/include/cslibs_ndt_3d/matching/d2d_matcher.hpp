@@ -0,0 +1,263 @@
+#ifndef CSLIBS_NDT_3D_D2D_MATCHER_HPP
+#define CSLIBS_NDT_3D_D2D_MATCHER_HPP
+
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/match.hpp>
+
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Distribution-to-distribution matching against a fixed target map.
+ *        The valid source distributions are extracted once into flat arrays (each
+ *        distribution exactly once, not once per bundle referencing it) and every
+ *        source distribution is paired with the target distribution of the same
+ *        layer at its transformed mean. Pairs are evaluated in parallel.
+ *
+ *        Covariances are rotated as R C R^T, i.e. the same way the means are
+ *        transformed; the rotated covariance and its derivatives are computed
+ *        once per distribution and iteration.
+ */
+template<typename map_t>
+class EIGEN_ALIGN16 D2DMatcher
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Ptr           = std::shared_ptr<D2DMatcher>;
+    using traits_t      = cslibs_ndt::matching::MatchTraits<map_t>;
+    using transform_t   = typename traits_t::transform_t;
+    using point_t       = typename traits_t::point_t;
+    using parameter_t   = cslibs_ndt::matching::Parameter;
+    using result_t      = cslibs_ndt::matching::Result<transform_t>;
+    using map_ptr_t     = std::shared_ptr<const map_t>;
+    using pool_t        = cslibs_ndt::common::ThreadPool;
+
+    using vector_t      = Eigen::Vector3d;
+    using matrix_t      = Eigen::Matrix3d;
+    using gradient_t    = typename traits_t::gradient_t;
+    using hessian_t     = typename traits_t::hessian_t;
+    using linear_t      = Eigen::Matrix<double, traits_t::LINEAR_DIMS, 1>;
+    using angular_t     = Eigen::Matrix<double, traits_t::ANGULAR_DIMS, 1>;
+
+    inline explicit D2DMatcher(const pool_t::Ptr &pool = pool_t::getDefault()) :
+        pool_(pool ? pool : pool_t::getDefault())
+    {
+    }
+
+    /**
+     * @brief Set the map to match against. The map must not be modified while it is in use.
+     */
+    inline void setTarget(const map_ptr_t &dst)
+    {
+        dst_ = dst;
+        if (dst_)
+            traits_t::prepare(*dst_);
+    }
+
+    /**
+     * @brief Extract the valid distributions of the source map.
+     */
+    template<typename src_map_t>
+    inline void setSource(const src_map_t &src)
+    {
+        using src_index_t        = typename src_map_t::index_t;
+        using src_distribution_t = typename src_map_t::distribution_t;
+
+        means_.clear();
+        covariances_.clear();
+        layers_.clear();
+
+        const auto &storages = src.getStorages();
+        for (std::size_t i = 0 ; i < storages.size() ; ++i) {
+            storages[i]->traverse([this, i](const src_index_t &, const src_distribution_t &d) {
+                if (!d.data().valid())
+                    return;
+                means_.emplace_back(d.data().getMean());
+                covariances_.emplace_back(d.data().getCovariance());
+                layers_.emplace_back(i);
+            });
+        }
+    }
+
+    inline std::size_t size() const
+    {
+        return means_.size();
+    }
+
+    /**
+     * @param cancellation - stops the match early with the best transform so far, optional
+     */
+    inline result_t match(const parameter_t &param,
+                          const transform_t &initial_transform,
+                          const cslibs_ndt::matching::CancellationToken::Ptr &cancellation =
+                                cslibs_ndt::matching::CancellationToken::Ptr())
+    {
+        if (!dst_ || means_.empty())
+            return result_t(0.0, 0, initial_transform, cslibs_ndt::matching::Termination::NONE);
+
+        /// step one: apply the initial transform to the flat arrays
+        const vector_t t0 = (initial_transform * point_t(0.0, 0.0, 0.0)).data();
+        matrix_t R0;
+        R0.col(0) = (initial_transform * point_t(1.0, 0.0, 0.0)).data() - t0;
+        R0.col(1) = (initial_transform * point_t(0.0, 1.0, 0.0)).data() - t0;
+        R0.col(2) = (initial_transform * point_t(0.0, 0.0, 1.0)).data() - t0;
+
+        const std::size_t n = means_.size();
+        means_prime_.resize(n);
+        covariances_prime_.resize(n);
+        for (std::size_t k = 0 ; k < n ; ++k) {
+            means_prime_[k]       = R0 * means_[k] + t0;
+            covariances_prime_[k] = R0 * covariances_[k] * R0.transpose();
+        }
+
+        /// step two: optimize with per thread accumulators
+        const std::size_t slots = pool_->concurrency();
+        scores_.resize(slots);
+        gradients_.resize(slots);
+        hessians_.resize(slots);
+
+        const cslibs_ndt::common::Kernel kernel = param.kernel();
+        const auto evaluate = [this, slots, n, kernel](const linear_t &linear, const angular_t &angular,
+                                               double &score, gradient_t &g, hessian_t *h)
+        {
+            typename traits_t::Jacobian J;
+            traits_t::Jacobian::get(angular, J);
+            typename traits_t::Hessian H;
+            traits_t::Hessian::get(angular, H);
+
+            std::fill(scores_.begin(), scores_.end(), 0.0);
+            std::fill(gradients_.begin(), gradients_.end(), gradient_t::Zero());
+            std::fill(hessians_.begin(), hessians_.end(), hessian_t::Zero());
+
+            const bool hessian = h != nullptr;
+            pool_->parallelFor(0, n, 256, [this, &J, &H, &linear, hessian, kernel](const std::size_t slot,
+                                                                                    const std::size_t begin,
+                                                                                    const std::size_t end) {
+                for (std::size_t k = begin ; k < end ; ++k)
+                    evaluatePair(k, J, H, linear, hessian, kernel, scores_[slot], gradients_[slot], hessians_[slot]);
+            });
+
+            for (std::size_t s = 0 ; s < slots ; ++s) {
+                score += scores_[s];
+                g     += gradients_[s];
+                if (h)
+                    *h += hessians_[s];
+            }
+        };
+
+        return cslibs_ndt::matching::impl::optimize<traits_t>(evaluate, param, initial_transform, cancellation);
+    }
+
+private:
+    static constexpr std::size_t DIMS = traits_t::LINEAR_DIMS + traits_t::ANGULAR_DIMS;
+
+    using vector_array_t   = std::vector<vector_t>;
+    using matrix_array_t   = std::vector<matrix_t>;
+    using gradient_array_t = std::vector<gradient_t, Eigen::aligned_allocator<gradient_t>>;
+    using hessian_array_t  = std::vector<hessian_t, Eigen::aligned_allocator<hessian_t>>;
+
+    pool_t::Ptr                 pool_;
+    map_ptr_t                   dst_;
+
+    vector_array_t              means_;
+    matrix_array_t              covariances_;
+    std::vector<std::size_t>    layers_;
+
+    vector_array_t              means_prime_;
+    matrix_array_t              covariances_prime_;
+
+    std::vector<double>         scores_;
+    gradient_array_t            gradients_;
+    hessian_array_t             hessians_;
+
+    inline void evaluatePair(const std::size_t k,
+                             const typename traits_t::Jacobian &J,
+                             const typename traits_t::Hessian &H,
+                             const linear_t &linear,
+                             const bool hessian,
+                             const cslibs_ndt::common::Kernel kernel,
+                             double &score,
+                             gradient_t &g,
+                             hessian_t &h) const
+    {
+        const matrix_t &R      = J.rotation();
+        const vector_t &mean_p = means_prime_[k];
+        const vector_t  mean   = R * mean_p + linear;
+
+        const auto *d_map = dst_->lookupDistribution(point_t(mean), layers_[k]);
+        if (!d_map || !d_map->data().valid())
+            return;
+
+        const matrix_t &C      = covariances_prime_[k];
+        const matrix_t  CRt    = C * R.transpose();
+        const matrix_t  B_inv  = R * CRt + d_map->data().getCovariance();
+
+        matrix_t B;
+        double   det;
+        bool     invertible;
+        B_inv.computeInverseAndDetWithCheck(B, det, invertible);
+        if (!invertible)
+            return;
+
+        const vector_t q  = mean - d_map->data().getMean();
+        const vector_t Bq = B * q;
+        const double   e  = q.dot(Bq);
+        const double   s  = cslibs_ndt::common::gaussianCutoff(-0.5 * e, kernel);
+        if (!std::isnormal(s) || s <= 1e-5)
+            return;
+
+        /// first order terms, Z_i = d(R C R^T) / dp_i vanishes for the linear part
+        std::array<vector_t, DIMS> J_i;
+        std::array<vector_t, DIMS> BJ_i;
+        std::array<vector_t, DIMS> ZBq_i;
+        std::array<vector_t, DIMS> BZBq_i;
+        std::array<double,   DIMS> f_i;
+        for (std::size_t i = 0 ; i < DIMS ; ++i) {
+            J_i[i]  = J.get(i, mean_p);
+            BJ_i[i] = B * J_i[i];
+            if (i < traits_t::LINEAR_DIMS) {
+                ZBq_i[i].setZero();
+                BZBq_i[i].setZero();
+            } else {
+                const matrix_t A   = J.angular()[i - traits_t::LINEAR_DIMS] * CRt;
+                ZBq_i[i]  = (A + A.transpose()) * Bq;
+                BZBq_i[i] = B * ZBq_i[i];
+            }
+            f_i[i] = 2.0 * Bq.dot(J_i[i]) - Bq.dot(ZBq_i[i]);
+        }
+
+        /// second order terms of f = q^T B q, the score is exp(-f/2)
+        for (std::size_t i = 0 ; i < DIMS ; ++i) {
+            g(i) += 0.5 * s * f_i[i];
+            if (!hessian)
+                continue;
+            for (std::size_t j = i ; j < DIMS ; ++j) {
+                double f_ij = 2.0 * J_i[j].dot(BJ_i[i])
+                            - 2.0 * ZBq_i[j].dot(BJ_i[i])
+                            - 2.0 * ZBq_i[i].dot(BJ_i[j])
+                            + 2.0 * ZBq_i[i].dot(BZBq_i[j]);
+
+                if (i >= traits_t::LINEAR_DIMS && j >= traits_t::LINEAR_DIMS) {
+                    const std::size_t a = i - traits_t::LINEAR_DIMS;
+                    const std::size_t b = j - traits_t::LINEAR_DIMS;
+                    const matrix_t D  = H.angular()[a][b] * CRt;
+                    const matrix_t M  = J.angular()[a] * C * J.angular()[b].transpose();
+                    const matrix_t Z_ij = D + D.transpose() + M + M.transpose();
+                    f_ij += 2.0 * Bq.dot(H.get(i, j, mean_p)) - Bq.dot(Z_ij * Bq);
+                }
+
+                const double h_ij = s * (0.25 * f_i[i] * f_i[j] - 0.5 * f_ij);
+                h(i, j) += h_ij;
+                if (i != j)
+                    h(j, i) += h_ij;
+            }
+        }
+        score += s;
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_D2D_MATCHER_HPP
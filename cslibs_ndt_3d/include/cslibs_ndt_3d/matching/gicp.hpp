@@ -0,0 +1,253 @@
+#ifndef CSLIBS_NDT_3D_GICP_HPP
+#define CSLIBS_NDT_3D_GICP_HPP
+
+#include <unordered_map>
+
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/voxel_filter.hpp>
+
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+#include <cslibs_ndt_3d/matching/icp_params.hpp>
+#include <cslibs_ndt_3d/matching/icp_result.hpp>
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Generalized ICP pre-alignment against an NDT map. Source voxels carrying a
+ *        sample covariance are associated with the closest distribution of the bundle
+ *        at their transformed mean and the plane to plane distance
+ *        d^T (C_map + R C R^T)^-1 d is minimized with Gauss-Newton steps.
+ *
+ *        Both covariances are regularized to planes (eigenvalues 1, 1, epsilon) as in
+ *        Segal et al., the regularized map covariances are computed once per target.
+ */
+template<typename map_t>
+class EIGEN_ALIGN16 GICP
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Ptr             = std::shared_ptr<GICP>;
+    using traits_t        = cslibs_ndt::matching::MatchTraits<map_t>;
+    using map_ptr_t       = std::shared_ptr<const map_t>;
+    using pool_t          = cslibs_ndt::common::ThreadPool;
+    using filter_t        = cslibs_ndt::matching::VoxelFilter<3>;
+    using distribution_t  = typename map_t::distribution_t;
+
+    using vector_t        = Eigen::Vector3d;
+    using matrix_t        = Eigen::Matrix3d;
+    using gradient_t      = Eigen::Matrix<double, 6, 1>;
+    using hessian_t       = Eigen::Matrix<double, 6, 6>;
+
+    /**
+     * @brief Create a pre-alignment.
+     * @param epsilon - the smallest eigenvalue of the regularized covariances
+     * @param pool    - the pool to run on, the shared default if empty
+     */
+    inline explicit GICP(const double epsilon = 1e-3,
+                         const pool_t::Ptr &pool = pool_t::getDefault()) :
+        epsilon_(epsilon),
+        pool_(pool ? pool : pool_t::getDefault())
+    {
+    }
+
+    /**
+     * @brief Set the map to align to. The map must not be modified while it is in use.
+     */
+    inline void setTarget(const map_ptr_t &dst)
+    {
+        dst_ = dst;
+        covariances_.clear();
+        if (!dst_)
+            return;
+
+        traits_t::prepare(*dst_);
+        for (const auto &storage : dst_->getStorages()) {
+            storage->traverse([this](const typename map_t::index_t &, const distribution_t &d) {
+                if (d.data().valid())
+                    covariances_.emplace(&d, regularize(d.data().getCovariance()));
+            });
+        }
+    }
+
+    /**
+     * @brief Align the source to the target, the ICP fields of the result are set.
+     * @param src               - the source cloud, voxelized with the map resolution
+     * @param params            - iterations, epsilons and the association distance
+     * @param initial_transform - the initial guess
+     */
+    inline void apply(const cslibs_math_3d::Pointcloud3d::ConstPtr &src,
+                      const ParametersWithICP                      &params,
+                      const cslibs_math_3d::Transform3d            &initial_transform,
+                      ResultWithICP                                &r)
+    {
+        cslibs_math_3d::Transform3d &transform = r.ICPTransform();
+        transform            = initial_transform;
+        r.icpIterations()    = 0;
+        r.icpTermination()   = ICPTermination::NONE;
+        r.icpCovariance()    = matrix_t::Zero();
+        if (!dst_)
+            return;
+
+        /// step one: source voxels with regularized covariances
+        filter_t filter(dst_->getResolution(), cslibs_ndt::matching::VoxelFilterMode::CENTROID, true, pool_);
+        filter.apply(src);
+        means_.clear();
+        source_covariances_.clear();
+        for (std::size_t i = 0 ; i < filter.size() ; ++i) {
+            if (filter.counts()[i] < 4)
+                continue;
+            means_.emplace_back(filter.points()[i].data());
+            source_covariances_.emplace_back(regularize(filter.covariances()[i]));
+        }
+        if (means_.empty())
+            return;
+
+        /// step two: gauss newton on a left multiplied increment
+        const std::size_t n      = means_.size();
+        const std::size_t slots  = pool_->concurrency();
+        const double max_distance2 = params.maxDistanceICP() * params.maxDistanceICP();
+        gradients_.resize(slots);
+        hessians_.resize(slots);
+        assigned_.resize(slots);
+
+        for (std::size_t i = 0 ; i < params.maxIterationsICP() ; ++i) {
+            const vector_t t = (transform * cslibs_math_3d::Point3d(0.0, 0.0, 0.0)).data();
+            matrix_t R;
+            R.col(0) = (transform * cslibs_math_3d::Point3d(1.0, 0.0, 0.0)).data() - t;
+            R.col(1) = (transform * cslibs_math_3d::Point3d(0.0, 1.0, 0.0)).data() - t;
+            R.col(2) = (transform * cslibs_math_3d::Point3d(0.0, 0.0, 1.0)).data() - t;
+
+            std::fill(gradients_.begin(), gradients_.end(), gradient_t::Zero());
+            std::fill(hessians_.begin(), hessians_.end(), hessian_t::Zero());
+            std::fill(assigned_.begin(), assigned_.end(), 0u);
+
+            pool_->parallelFor(0, n, 256, [this, &R, &t, max_distance2](const std::size_t slot,
+                                                                        const std::size_t begin,
+                                                                        const std::size_t end) {
+                for (std::size_t k = begin ; k < end ; ++k)
+                    accumulate(k, R, t, max_distance2, gradients_[slot], hessians_[slot], assigned_[slot]);
+            });
+
+            gradient_t  g = gradient_t::Zero();
+            hessian_t   h = hessian_t::Zero();
+            std::size_t assigned = 0;
+            for (std::size_t s = 0 ; s < slots ; ++s) {
+                g        += gradients_[s];
+                h        += hessians_[s];
+                assigned += assigned_[s];
+            }
+            r.icpIterations() = i + 1;
+
+            if (static_cast<double>(assigned) / static_cast<double>(n) < params.minAssignedPoints()) {
+                r.icpTermination() = ICPTermination::ASSIGNMENT_SUCCESS;
+                return;
+            }
+
+            const Eigen::LDLT<hessian_t> ldlt(h);
+            if (ldlt.info() != Eigen::Success)
+                return;
+            const gradient_t delta = ldlt.solve(-g);
+
+            const vector_t dt = delta.head<3>();
+            const vector_t dr = delta.tail<3>();
+            const double   angle = dr.norm();
+            const Eigen::Quaterniond qe(angle > 0.0 ? Eigen::Quaterniond(Eigen::AngleAxisd(angle, dr / angle))
+                                                    : Eigen::Quaterniond::Identity());
+            transform = cslibs_math_3d::Transform3d(cslibs_math_3d::Vector3d(dt),
+                                                    cslibs_math_3d::Quaternion(qe.x(), qe.y(), qe.z(), qe.w())) * transform;
+
+            if (ldlt.isPositive())
+                r.icpCovariance() = h.inverse().template topLeftCorner<3, 3>();
+
+            if (dt.squaredNorm() < params.translationEpsilon() * params.translationEpsilon() &&
+                    angle < params.rotationEpsilon()) {
+                r.icpTermination() = ICPTermination::DELTA_EPS;
+                return;
+            }
+        }
+        r.icpTermination() = ICPTermination::MAX_ITERATIONS;
+    }
+
+private:
+    using vector_array_t   = std::vector<vector_t>;
+    using matrix_array_t   = std::vector<matrix_t>;
+    using gradient_array_t = std::vector<gradient_t, Eigen::aligned_allocator<gradient_t>>;
+    using hessian_array_t  = std::vector<hessian_t, Eigen::aligned_allocator<hessian_t>>;
+    using covariance_map_t = std::unordered_map<const distribution_t*, matrix_t, std::hash<const distribution_t*>,
+                                                std::equal_to<const distribution_t*>,
+                                                Eigen::aligned_allocator<std::pair<const distribution_t* const, matrix_t>>>;
+
+    double              epsilon_;
+    pool_t::Ptr         pool_;
+    map_ptr_t           dst_;
+    covariance_map_t    covariances_;
+
+    vector_array_t      means_;
+    matrix_array_t      source_covariances_;
+
+    gradient_array_t    gradients_;
+    hessian_array_t     hessians_;
+    std::vector<std::size_t> assigned_;
+
+    inline matrix_t regularize(const matrix_t &C) const
+    {
+        const Eigen::SelfAdjointEigenSolver<matrix_t> solver(C);
+        const matrix_t &U = solver.eigenvectors();
+        return U * vector_t(epsilon_, 1.0, 1.0).asDiagonal() * U.transpose();
+    }
+
+    inline void accumulate(const std::size_t k,
+                           const matrix_t &R,
+                           const vector_t &t,
+                           const double max_distance2,
+                           gradient_t &g,
+                           hessian_t &h,
+                           std::size_t &assigned) const
+    {
+        const vector_t p = R * means_[k] + t;
+
+        typename map_t::distribution_const_bundle_t::data_t bundle;
+        if (!dst_->lookupDistributionBundle(cslibs_math_3d::Point3d(p), bundle))
+            return;
+
+        /// the closest distribution of the bundle is the correspondence
+        const distribution_t *closest = nullptr;
+        double min_distance2 = max_distance2;
+        for (const distribution_t *d : bundle) {
+            if (!d || !d->data().valid())
+                continue;
+            const double d2 = (p - d->data().getMean()).squaredNorm();
+            if (d2 < min_distance2) {
+                min_distance2 = d2;
+                closest = d;
+            }
+        }
+        if (!closest)
+            return;
+
+        const auto c = covariances_.find(closest);
+        if (c == covariances_.end())
+            return;
+
+        const matrix_t M = (c->second + R * source_covariances_[k] * R.transpose()).inverse();
+        const vector_t e = p - closest->data().getMean();
+
+        /// d e / d (translation, rotation) = [I, -[p]x] for a left multiplied increment
+        Eigen::Matrix<double, 3, 6> J;
+        J.leftCols<3>().setIdentity();
+        J.rightCols<3>() <<  0.0,   p(2), -p(1),
+                            -p(2),  0.0,   p(0),
+                             p(1), -p(0),  0.0;
+
+        const Eigen::Matrix<double, 6, 3> JtM = J.transpose() * M;
+        g += JtM * e;
+        h += JtM * J;
+        ++assigned;
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_GICP_HPP
@@ -40,8 +40,30 @@ struct MatchTraits<MapT, typename std::enable_if<IsGridmap<MapT>::value>::type>
                     angular.x(), angular.y(), angular.z()};
     }
 
+    /**
+     * @brief Distributions update their moments lazily on first access. Touch all of
+     *        them once, so that concurrent evaluations afterwards only read from the map.
+     */
+    static void prepare(const MapT& map)
+    {
+        for (const auto& storage : map.getStorages())
+        {
+            storage->traverse([](const index_t&, const typename MapT::distribution_t& d)
+            {
+                d.data().getCovariance();
+                d.data().getInformationMatrix();
+            });
+        }
+    }
+
+    /**
+     * @brief Accumulate score, gradient and hessian of one point.
+     * @param point       - the transformed point
+     * @param point_prime - the point before the transform, the derivatives are evaluated at
+     */
     static void computeGradient(const MapT& map,
                                 const point_t& point,
+                                const point_t& point_prime,
                                 const Jacobian& J,
                                 const Hessian& H,
                                 const parameter_t& param,
@@ -49,44 +71,21 @@ struct MatchTraits<MapT, typename std::enable_if<IsGridmap<MapT>::value>::type>
                                 gradient_t& g,
                                 hessian_t& h)
     {
-        auto* bundle = map.getDistributionBundle(point);
-        if (!bundle)
-            return;
-
-        for (auto* distribution_wrapper : *bundle)
-        {
-            auto& d = distribution_wrapper->data();
-            if (d.getN() < 4)
-                continue;
-
-            const auto info   = d.getInformationMatrix();
-            const auto q      = (point.data() - d.getMean()).eval();
-            const auto q_info = (q.transpose() * info).eval();
-            const auto e      = -0.5 * double(q_info * q);
-            const auto s      = std::exp(e);
-            if (!std::isnormal(s) || s <= 1e-5)
-                continue;
-
-            // this part should be vectorized, may also remove common factors...
-            for (std::size_t i = 0; i < LINEAR_DIMS + ANGULAR_DIMS; ++i)
-            {
-                const auto J_iq     = J.get(i, q);
-                const auto J_info   = (info * J_iq).eval();
-
-                g(i) += s * q_info * J_iq;
-
-                for (std::size_t j = 0; j < LINEAR_DIMS + ANGULAR_DIMS; ++j)
-                {
-                    h(i, j) -= s * q_info * H.get(i, j, q) +
-                            s * static_cast<double>((J.get(j, q).transpose()).eval() * J_info) -
-                            s * (q_info * J_iq).eval() * (-q_info * J.get(j, q)).eval();
-                }
-            }
-            std::cout << "hessian  : " << h << "\n";
-            std::cout << "sub score: " << s << "\n";
+        accumulate(map, point, point_prime, J, &H, param, score, g, &h);
+    }
 
-            score += s;
-        }
+    /**
+     * @brief Accumulate score and gradient of one point only, e.g. for line search trials.
+     */
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(map, point, point_prime, J, nullptr, param, score, g, nullptr);
     }
 
     static void computeGradientComplete(const MapT& map,
@@ -235,6 +234,70 @@ struct MatchTraits<MapT, typename std::enable_if<IsGridmap<MapT>::value>::type>
             std::cout << "hessian  : " << h << "\n";
             std::cout << "sub score: " << s << "\n";
 
+            score += s;
+        }
+    }
+
+private:
+    static void accumulate(const MapT& map,
+                           const point_t& point,
+                           const point_t& point_prime,
+                           const Jacobian& J,
+                           const Hessian* H,
+                           const parameter_t& param,
+                           double& score,
+                           gradient_t& g,
+                           hessian_t* h)
+    {
+        /// lookup does not allocate, evaluations can run concurrently after prepare
+        typename MapT::distribution_const_bundle_t::data_t bundle;
+        if (!map.lookupDistributionBundle(point, bundle))
+            return;
+
+        for (const auto* distribution_wrapper : bundle)
+        {
+            if (!distribution_wrapper)
+                continue;
+
+            const auto& d = distribution_wrapper->data();
+            if (d.getN() < 4)
+                continue;
+
+            const auto info   = d.getInformationMatrix();
+            const auto q      = (point.data() - d.getMean()).eval();
+            const auto q_info = (q.transpose() * info).eval();
+            const auto e      = -0.5 * double(q_info * q);
+            const auto s      = cslibs_ndt::common::gaussianCutoff(e, param.kernel());
+            if (!std::isnormal(s) || s <= 1e-5)
+                continue;
+
+            /// g = -ds/dp, h = d^2s/dp^2 with dq/dp_i = J_i(point_prime)
+            std::array<Eigen::Vector3d, LINEAR_DIMS + ANGULAR_DIMS> J_i;
+            std::array<double, LINEAR_DIMS + ANGULAR_DIMS>          q_info_J_i;
+            for (std::size_t i = 0; i < LINEAR_DIMS + ANGULAR_DIMS; ++i)
+            {
+                J_i[i]        = J.get(i, point_prime.data());
+                q_info_J_i[i] = q_info * J_i[i];
+                g(i) += s * q_info_J_i[i];
+            }
+
+            if (h)
+            {
+                for (std::size_t i = 0; i < LINEAR_DIMS + ANGULAR_DIMS; ++i)
+                {
+                    const auto J_info = (info * J_i[i]).eval();
+                    for (std::size_t j = i; j < LINEAR_DIMS + ANGULAR_DIMS; ++j)
+                    {
+                        const double h_ij = s * (q_info_J_i[i] * q_info_J_i[j] -
+                                                 J_i[j].dot(J_info) -
+                                                 double(q_info * H->get(i, j, point_prime.data())));
+                        (*h)(i, j) += h_ij;
+                        if (i != j)
+                            (*h)(j, i) += h_ij;
+                    }
+                }
+            }
+
             score += s;
         }
     }
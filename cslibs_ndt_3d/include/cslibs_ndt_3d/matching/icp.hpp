@@ -2,6 +2,8 @@
 #define CSLIBS_NDT_3D_ICP_HPP
 
 #include <cslibs_math_3d/linear/pointcloud.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/nearest_neighbor_index.hpp>
 #include <cslibs_ndt_3d/matching/icp_params.hpp>
 #include <cslibs_ndt_3d/matching/icp_result.hpp>
 
@@ -9,14 +11,32 @@ namespace cslibs_ndt_3d {
 namespace matching {
 namespace impl {
 struct icp {
+using index_t = cslibs_ndt::matching::NearestNeighborIndex<3>;
+using pool_t  = cslibs_ndt::common::ThreadPool;
+
 inline static void apply(const cslibs_math_3d::Pointcloud3d::ConstPtr &src,
                          const cslibs_math_3d::Pointcloud3d::ConstPtr &dst,
                          const ParametersWithICP                      &params,
                          const cslibs_math_3d::Transform3d            &initial_transform,
                          ResultWithICP                                &r)
+{
+    const index_t index(dst, params.maxDistanceICP());
+    apply(src, index, params, initial_transform, r);
+}
+
+/**
+ * @brief ICP against a prebuilt index of the target, which can be shared by several calls
+ *        as long as the maximum association distance matches the index radius.
+ */
+inline static void apply(const cslibs_math_3d::Pointcloud3d::ConstPtr &src,
+                         const index_t                                &dst_index,
+                         const ParametersWithICP                      &params,
+                         const cslibs_math_3d::Transform3d            &initial_transform,
+                         ResultWithICP                                &r,
+                         const pool_t::Ptr                            &pool = pool_t::getDefault())
 {
     const cslibs_math_3d::Pointcloud3d::points_t &src_points = src->getPoints();
-    const cslibs_math_3d::Pointcloud3d::points_t &dst_points = dst->getPoints();
+    const cslibs_math_3d::Pointcloud3d::points_t &dst_points = dst_index.points()->getPoints();
     const std::size_t src_size = src_points.size();
     const std::size_t dst_size = dst_points.size();
 
@@ -24,10 +44,9 @@ inline static void apply(const cslibs_math_3d::Pointcloud3d::ConstPtr &src,
 
     const double trans_eps = sq(params.translationEpsilon());
     const double rot_eps = sq(params.rotationEpsilon());
-    const double max_distance = sq(params.maxDistanceICP());
     const std::size_t max_iterations = params.maxIterationsICP();
 
-    cslibs_math_3d::Transform3d &transform = r.transform();
+    cslibs_math_3d::Transform3d &transform = r.ICPTransform();
     transform = initial_transform;
     cslibs_math_3d::Pointcloud3d::points_t src_points_transformed(src_size);
 
@@ -47,30 +66,35 @@ inline static void apply(const cslibs_math_3d::Pointcloud3d::ConstPtr &src,
 
     Eigen::Matrix3d &S = r.icpCovariance();
 
+    const std::size_t slots = pool->concurrency();
+    std::vector<cslibs_math_3d::Point3d> src_means(slots);
+    std::vector<std::size_t>             assigned_counts(slots);
+
     for(std::size_t i = 0 ; i < max_iterations ; ++i) {
         std::fill(indices.begin(), indices.end(), std::numeric_limits<std::size_t>::max());
         assigned = 0u;
 
-        cslibs_math_3d::Point3d src_mean;
-
-        /// associate
-        for(std::size_t s = 0 ; s < src_size ; ++s) {
-            cslibs_math_3d::Point3d &sp = src_points_transformed[s];
-            sp = transform * src_points[s];
-            std::size_t &index = indices[s];
-            src_mean += sp;
-
-            double      min_distance = std::numeric_limits<double>::max();
-            for(std::size_t d = 0 ; d < dst_size ; ++d) {
-                const cslibs_math_3d::Point3d &dp = dst_points[d];
-                const double dist = cslibs_math::linear::distance2(dp, sp);
-                if(dist < min_distance &&
-                        dist < max_distance) {
-                    index = d;
-                    min_distance = dist;
-                }
+        /// associate in parallel, the index is read only
+        std::fill(src_means.begin(), src_means.end(), cslibs_math_3d::Point3d());
+        std::fill(assigned_counts.begin(), assigned_counts.end(), 0u);
+        pool->parallelFor(0, src_size, 1024, [&](const std::size_t slot,
+                                                 const std::size_t begin,
+                                                 const std::size_t end) {
+            for(std::size_t s = begin ; s < end ; ++s) {
+                cslibs_math_3d::Point3d &sp = src_points_transformed[s];
+                sp = transform * src_points[s];
+                src_means[slot] += sp;
+
+                double distance2;
+                indices[s] = dst_index.nearest(sp, distance2);
+                assigned_counts[slot] += is_assigned(indices[s]) ? 1u : 0u;
             }
-            assigned += min_distance < max_distance ? 1u : 0u;
+        });
+
+        cslibs_math_3d::Point3d src_mean;
+        for(std::size_t s = 0 ; s < slots ; ++s) {
+            src_mean += src_means[s];
+            assigned += assigned_counts[s];
         }
         src_mean /= static_cast<double>(src_size);
 
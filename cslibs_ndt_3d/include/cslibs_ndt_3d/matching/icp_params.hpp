@@ -7,6 +7,12 @@
 
 namespace cslibs_ndt_3d {
 namespace matching {
+/**
+ * ICP  : point to point alignment of the voxel centroids
+ * GICP : plane to plane alignment against the distributions of the target map
+ */
+enum class PreAlignment {ICP, GICP};
+
 class EIGEN_ALIGN16 ParametersWithICP : public cslibs_ndt::matching::Parameter
 {
 public:
@@ -20,11 +26,13 @@ public:
                              const double                        rot_eps = 1e-4,
                              const double                        trans_eps = 1e-4,
                              const std::size_t                   step_adjustment_retries = 5,
-                             const double                        alpha = 1.0) :
-        cslibs_ndt::matching::Parameter(max_iterations, rot_eps, trans_eps, step_adjustment_retries, alpha),
+                             const double                        alpha = 1.0,
+                             const PreAlignment                  pre_alignment = PreAlignment::ICP) :
+        cslibs_ndt::matching::Parameter(max_iterations, trans_eps, rot_eps, step_adjustment_retries, alpha),
         icp_max_iterations_(icp_max_iterations),
         icp_min_assigned_points_(icp_min_assigned_points),
-        icp_max_distance_(icp_max_distance)
+        icp_max_distance_(icp_max_distance),
+        pre_alignment_(pre_alignment)
     {
     }
 
@@ -58,10 +66,21 @@ public:
         return icp_max_distance_;
     }
 
+    inline PreAlignment preAlignment() const
+    {
+        return pre_alignment_;
+    }
+
+    inline PreAlignment & preAlignment()
+    {
+        return pre_alignment_;
+    }
+
 protected:
-    std::size_t icp_max_iterations_;
-    double      icp_min_assigned_points_;
-    double      icp_max_distance_;
+    std::size_t  icp_max_iterations_;
+    double       icp_min_assigned_points_;
+    double       icp_max_distance_;
+    PreAlignment pre_alignment_;
 };
 }
 }
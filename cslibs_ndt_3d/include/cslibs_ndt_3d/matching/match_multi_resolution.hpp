@@ -0,0 +1,106 @@
+#ifndef CSLIBS_NDT_3D_MATCH_MULTI_RESOLUTION_HPP
+#define CSLIBS_NDT_3D_MATCH_MULTI_RESOLUTION_HPP
+
+#include <cslibs_ndt/matching/match.hpp>
+#include <cslibs_ndt/matching/multi_resolution_parameter.hpp>
+
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+namespace dynamic_maps {
+/**
+ * @brief Build one gridmap per resolution from a single pass over the points.
+ *        Points are accumulated per bundle and level first, so every map only
+ *        touches its bundle storage once per occupied bundle.
+ * @param points      - the points to insert
+ * @param resolutions - the map resolutions
+ * @return the maps in the order of the given resolutions
+ */
+template<typename iterator_t>
+inline std::vector<cslibs_ndt_3d::dynamic_maps::Gridmap::Ptr> createPyramid(const iterator_t    &points_begin,
+                                                                             const iterator_t    &points_end,
+                                                                             const std::vector<double> &resolutions)
+{
+    using ndt_t     = cslibs_ndt_3d::dynamic_maps::Gridmap;
+    using index_t   = ndt_t::index_t;
+    using storage_t = ndt_t::distribution_storage_t;
+
+    const std::size_t levels = resolutions.size();
+    std::vector<ndt_t::Ptr> maps(levels);
+    std::vector<storage_t>  storages(levels);
+    std::vector<double>     bundle_resolutions_inv(levels);
+    for (std::size_t l = 0 ; l < levels ; ++l) {
+        maps[l].reset(new ndt_t(ndt_t::pose_t(), resolutions[l]));
+        bundle_resolutions_inv[l] = 1.0 / maps[l]->getBundleResolution();
+    }
+
+    /// step one: accumulate all levels with one pass over the points
+    for (auto itr = points_begin ; itr != points_end ; ++itr) {
+        const ndt_t::point_t &p = *itr;
+        if (!p.isNormal())
+            continue;
+
+        for (std::size_t l = 0 ; l < levels ; ++l) {
+            const double inv = bundle_resolutions_inv[l];
+            const index_t bi = {{static_cast<int>(std::floor(p(0) * inv)),
+                                 static_cast<int>(std::floor(p(1) * inv)),
+                                 static_cast<int>(std::floor(p(2) * inv))}};
+            ndt_t::distribution_t *d = storages[l].get(bi);
+            (d ? d : &storages[l].insert(bi, ndt_t::distribution_t()))->data().add(p);
+        }
+    }
+
+    /// step two: merge the accumulated distributions into the bundles
+    for (std::size_t l = 0 ; l < levels ; ++l) {
+        ndt_t &map = *maps[l];
+        storages[l].traverse([&map](const index_t &bi, const ndt_t::distribution_t &d) {
+            ndt_t::distribution_bundle_t *bundle = map.getDistributionBundle(bi);
+            for (auto *b : *bundle)
+                b->data() += d.data();
+        });
+    }
+
+    return maps;
+}
+
+/**
+ * @brief Coarse-to-fine matching: every level is matched against its own map,
+ *        warm started with the transform found on the previous, coarser level.
+ *        The reported score and termination belong to the finest level, the
+ *        iteration count is accumulated over all levels.
+ */
+inline void match(const cslibs_math_3d::Pointcloud3d::ConstPtr           &src,
+                  const cslibs_math_3d::Pointcloud3d::ConstPtr           &dst,
+                  const cslibs_ndt::matching::MultiResolutionParameter   &params,
+                  const cslibs_math_3d::Transform3d                      &initial_transform,
+                  cslibs_ndt::matching::Result<cslibs_math_3d::Transform3d> &r)
+{
+    using result_t = cslibs_ndt::matching::Result<cslibs_math_3d::Transform3d>;
+
+    r = result_t(0.0, 0, initial_transform, cslibs_ndt::matching::Termination::NONE);
+    if (params.empty())
+        return;
+
+    std::vector<double> resolutions;
+    for (const auto &level : params.levels())
+        resolutions.emplace_back(level.resolution());
+
+    const auto maps = createPyramid(dst->begin(), dst->end(), resolutions);
+
+    std::size_t iterations = 0;
+    for (std::size_t l = 0 ; l < maps.size() ; ++l) {
+        r = cslibs_ndt::matching::match(src->begin(), src->end(),
+                                        *maps[l],
+                                        params.levels()[l].parameter(),
+                                        r.transform());
+        iterations += r.iterations();
+    }
+    r.iterations() = iterations;
+}
+}
+}
+}
+
+#endif // CSLIBS_NDT_3D_MATCH_MULTI_RESOLUTION_HPP
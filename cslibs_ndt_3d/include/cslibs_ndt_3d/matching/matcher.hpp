@@ -0,0 +1,149 @@
+#ifndef CSLIBS_NDT_3D_MATCHER_HPP
+#define CSLIBS_NDT_3D_MATCHER_HPP
+
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/match.hpp>
+
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Point to distribution matching with state kept between calls.
+ *        The target map is built once and the workspace of the match, i.e. the buffers
+ *        for the transformed source points and the per thread accumulators, is reused
+ *        by every match. For scan
+ *        to scan odometry swap() turns the current source into the next target,
+ *        keeping the map of the previous target around in case it is swapped back.
+ *
+ *        Points are evaluated in parallel on the matcher's pool, thus the target
+ *        map must not be modified while it is in use.
+ */
+template<typename map_t>
+class EIGEN_ALIGN16 Matcher
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Ptr           = std::shared_ptr<Matcher>;
+    using traits_t      = cslibs_ndt::matching::MatchTraits<map_t>;
+    using transform_t   = typename traits_t::transform_t;
+    using point_t       = typename traits_t::point_t;
+    using parameter_t   = typename traits_t::parameter_t;
+    using result_t      = cslibs_ndt::matching::Result<transform_t>;
+    using map_ptr_t     = std::shared_ptr<const map_t>;
+    using cloud_ptr_t   = cslibs_math_3d::Pointcloud3d::ConstPtr;
+    using pool_t        = cslibs_ndt::common::ThreadPool;
+
+    /**
+     * @brief Create a matcher.
+     * @param resolution - the resolution of maps built from target clouds
+     * @param pool       - the pool points are evaluated on, the shared default if empty
+     */
+    inline explicit Matcher(const double resolution,
+                            const pool_t::Ptr &pool = pool_t::getDefault()) :
+        resolution_(resolution),
+        workspace_(pool ? pool : pool_t::getDefault(), true)
+    {
+    }
+
+    /**
+     * @brief Match against an already built map. The map must not be modified while it is in use.
+     * @param dst       - the map
+     * @param dst_cloud - the cloud the map was built from, optional, required by swap()
+     */
+    inline void setTarget(const map_ptr_t &dst,
+                          const cloud_ptr_t &dst_cloud = cloud_ptr_t())
+    {
+        dst_cloud_ = dst_cloud;
+        dst_map_   = dst;
+        if (dst_map_)
+            traits_t::prepare(*dst_map_);
+    }
+
+    /**
+     * @brief Build the target map from a cloud, requires a map type which can be
+     *        constructed from an origin and a resolution only.
+     */
+    inline void setTarget(const cloud_ptr_t &dst)
+    {
+        dst_cloud_ = dst;
+        dst_map_   = buildMap(dst);
+    }
+
+    inline void setSource(const cloud_ptr_t &src)
+    {
+        src_cloud_ = src;
+        src_map_.reset();
+    }
+
+    /**
+     * @brief Exchange source and target. A target map is only built if the new target
+     *        has none yet, i.e. when it was set as a source cloud.
+     * @return false and nothing is exchanged if there is no source or no target cloud,
+     *         e.g. if the target was set as a map without the cloud it was built from
+     */
+    inline bool swap()
+    {
+        if (!src_cloud_ || !dst_cloud_)
+            return false;
+
+        std::swap(src_cloud_, dst_cloud_);
+        std::swap(src_map_,   dst_map_);
+        if (!dst_map_)
+            dst_map_ = buildMap(dst_cloud_);
+        return true;
+    }
+
+    inline const map_ptr_t& getTarget() const
+    {
+        return dst_map_;
+    }
+
+    inline const cloud_ptr_t& getSource() const
+    {
+        return src_cloud_;
+    }
+
+    /**
+     * @param cancellation - stops the match early with the best transform so far, optional
+     */
+    inline result_t match(const parameter_t &param,
+                          const transform_t &initial_transform,
+                          const cslibs_ndt::matching::CancellationToken::Ptr &cancellation =
+                                cslibs_ndt::matching::CancellationToken::Ptr())
+    {
+        if (!dst_map_ || !src_cloud_ || src_cloud_->getPoints().empty())
+            return result_t(0.0, 0, initial_transform, cslibs_ndt::matching::Termination::NONE);
+
+        return cslibs_ndt::matching::impl::match<cslibs_math_3d::Pointcloud3d::const_iterator, map_t, traits_t>(
+                    src_cloud_->begin(), src_cloud_->end(), *dst_map_, param, initial_transform, workspace_, cancellation);
+    }
+
+private:
+    using workspace_t = cslibs_ndt::matching::impl::Workspace<traits_t>;
+
+    double                  resolution_;
+    workspace_t             workspace_;
+
+    cloud_ptr_t             src_cloud_;
+    map_ptr_t               src_map_;
+    cloud_ptr_t             dst_cloud_;
+    map_ptr_t               dst_map_;
+
+    inline map_ptr_t buildMap(const cloud_ptr_t &cloud) const
+    {
+        if (!cloud)
+            return map_ptr_t();
+
+        std::shared_ptr<map_t> map(new map_t(typename map_t::pose_t(), resolution_));
+        map->insert(cloud);
+        traits_t::prepare(*map);
+        return map;
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_MATCHER_HPP
@@ -2,6 +2,7 @@
 
 #include <cslibs_ndt/matching/match_traits.hpp>
 #include <cslibs_ndt/matching/occupancy_parameter.hpp>
+#include <cslibs_ndt/matching/occupancy_cache.hpp>
 #include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
 #include <cslibs_ndt_3d/static_maps/occupancy_gridmap.hpp>
 #include <cslibs_ndt_3d/matching/jacobian.hpp>
@@ -28,6 +29,7 @@ struct MatchTraits<MapT, typename std::enable_if<IsOccupancyGridmap<MapT>::value
     using point_t = cslibs_math_3d::Point3d;
     using transform_t = cslibs_math_3d::Transform3d;
     using parameter_t = cslibs_ndt::matching::OccupancyParameter;
+    using cache_t     = cslibs_ndt::matching::OccupancyCache<MapT>;
 
     static transform_t makeTransform(const Eigen::Vector3d& linear,
                                      const Eigen::Vector3d& angular)
@@ -37,9 +39,24 @@ struct MatchTraits<MapT, typename std::enable_if<IsOccupancyGridmap<MapT>::value
                 angular.x(), angular.y(), angular.z()};
     }
 
-    // todo: deduplicate code, make model configureable...
+    /**
+     * @brief Resolve the occupancy weights of all bundles the initially transformed scan touches.
+     */
+    template<typename points_t>
+    static void prepareCache(const MapT& map,
+                             const parameter_t& param,
+                             const points_t& points,
+                             cache_t& cache)
+    {
+        cache.reset(map, param.inverseModel(), param.occupancyThreshold());
+        for (const point_t& point : points)
+            cache.get(point);
+    }
+
     static void computeGradient(const MapT& map,
+                                cache_t& cache,
                                 const point_t& point,
+                                const point_t& point_prime,
                                 const Jacobian& J,
                                 const Hessian& H,
                                 const parameter_t& param,
@@ -47,53 +64,110 @@ struct MatchTraits<MapT, typename std::enable_if<IsOccupancyGridmap<MapT>::value
                                 gradient_t& g,
                                 hessian_t& h)
     {
-        static constexpr double d1 = 0.95;
-        static constexpr double d2 = 1 - d1;
+        accumulate(cache.get(point), point, point_prime, J, &H, param.kernel(), score, g, &h);
+    }
 
-        auto* bundle = map.getDistributionBundle(point);
-        if (!bundle)
-            return;
+    static void computeGradient(const MapT& map,
+                                cache_t& cache,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(cache.get(point), point, point_prime, J, nullptr, param.kernel(), score, g, nullptr);
+    }
 
-        // check occupancy value
-        if (param.occupancyThreshold() > 0.0)
-        {
-            double occupancy = 0.0;
-            for (auto* distribution_wrapper : *bundle)
-                occupancy += distribution_wrapper->getOccupancy(param.inverseModel());
-            occupancy /= 8.0;
+    /**
+     * @brief Uncached evaluation, the bundle is resolved for every call.
+     */
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const Hessian& H,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g,
+                                hessian_t& h)
+    {
+        accumulate(resolve(map, point, param), point, point_prime, J, &H, param.kernel(), score, g, &h);
+    }
 
-            if (occupancy < param.occupancyThreshold())
-                return;
-        }
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(resolve(map, point, param), point, point_prime, J, nullptr, param.kernel(), score, g, nullptr);
+    }
+
+private:
+    static typename cache_t::Entry resolve(const MapT& map,
+                                           const point_t& point,
+                                           const parameter_t& param)
+    {
+        typename cache_t::Entry entry;
+        cache_t::resolve(map, point, param.inverseModel(), param.occupancyThreshold(), entry);
+        return entry;
+    }
 
-        for (auto* distribution_wrapper : *bundle)
+    // todo: deduplicate code, make model configureable...
+    static void accumulate(const typename cache_t::Entry& entry,
+                           const point_t& point,
+                           const point_t& point_prime,
+                           const Jacobian& J,
+                           const Hessian* H,
+                           const cslibs_ndt::common::Kernel kernel,
+                           double& score,
+                           gradient_t& g,
+                           hessian_t* h)
+    {
+        static constexpr double d1 = 0.95;
+        static constexpr double d2 = 1 - d1;
+
+        for (std::size_t k = 0; k < entry.size; ++k)
         {
-            auto& d = distribution_wrapper->getDistribution();
-            if (!d || d->getN() < 4)
-                continue;
+            const auto& d     = *entry.distributions[k];
+            const auto  p_occ = entry.occupancy[k];
 
-            const auto info   = d->getInformationMatrix();
-            const auto q      = (point.data() - d->getMean()).eval();
+            const auto info   = d.getInformationMatrix();
+            const auto q      = (point.data() - d.getMean()).eval();
             const auto q_info = (q.transpose() * info).eval();
-            const auto p_occ  = distribution_wrapper->getOccupancy(param.inverseModel()); // no recompute: this uses a cached value
-            const auto e      = -0.5 * double(q_info * q) * (d2 * (1 - p_occ));
-            const auto s      = d1 * p_occ * std::exp(e);
+            const auto c      = d2 * (1 - p_occ);
+            const auto e      = -0.5 * double(q_info * q) * c;
+            const auto s      = d1 * p_occ * cslibs_ndt::common::gaussianCutoff(e, kernel);
             if (!std::isnormal(s) || s <= 1e-5)
                 continue;
 
-            // this part should be vectorized, may also remove common factors...
+            /// g = -ds/dp, h = d^2s/dp^2 with dq/dp_i = J_i(point_prime)
+            std::array<Eigen::Vector3d, LINEAR_DIMS + ANGULAR_DIMS> J_i;
+            std::array<double, LINEAR_DIMS + ANGULAR_DIMS>          q_info_J_i;
             for (std::size_t i = 0; i < LINEAR_DIMS + ANGULAR_DIMS; ++i)
             {
-                const auto J_iq = J.get(i, q);
-                const auto J_info = (info * J_iq).eval();
-
-                g(i) += s * q_info * J_iq;
+                J_i[i]        = J.get(i, point_prime.data());
+                q_info_J_i[i] = q_info * J_i[i];
+                g(i) += c * s * q_info_J_i[i];
+            }
 
-                for (std::size_t j = 0; j < LINEAR_DIMS + ANGULAR_DIMS; ++j)
+            if (h)
+            {
+                for (std::size_t i = 0; i < LINEAR_DIMS + ANGULAR_DIMS; ++i)
                 {
-                    h(i, j) -= s * q_info * H.get(i, j, q) +
-                               s * static_cast<double>((J.get(j, q).transpose()).eval() * J_info) -
-                               s * (q_info * J_iq).value() * (-q_info * J.get(j, q)).value();
+                    const auto J_info = (info * J_i[i]).eval();
+                    for (std::size_t j = i; j < LINEAR_DIMS + ANGULAR_DIMS; ++j)
+                    {
+                        const double h_ij = c * s * (c * q_info_J_i[i] * q_info_J_i[j] -
+                                                     J_i[j].dot(J_info) -
+                                                     double(q_info * H->get(i, j, point_prime.data())));
+                        (*h)(i, j) += h_ij;
+                        if (i != j)
+                            (*h)(j, i) += h_ij;
+                    }
                 }
             }
 
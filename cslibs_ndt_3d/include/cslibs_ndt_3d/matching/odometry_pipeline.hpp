@@ -0,0 +1,416 @@
+#ifndef CSLIBS_NDT_3D_ODOMETRY_PIPELINE_HPP
+#define CSLIBS_NDT_3D_ODOMETRY_PIPELINE_HPP
+
+#include <array>
+#include <exception>
+#include <future>
+#include <limits>
+
+#include <cslibs_ndt/common/bounded_queue.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/match.hpp>
+#include <cslibs_ndt/matching/odometry_parameter.hpp>
+#include <cslibs_ndt/matching/voxel_filter.hpp>
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Scan-to-map odometry with overlapping stages. Every stage runs on a worker of
+ *        a pool owned by the pipeline and the stages are connected by bounded queues:
+ *        - downsampling of scan k+1,
+ *        - matching of scan k+1 against the last published map,
+ *        - insertion of scan k into the map.
+ *        The latency per scan is that of the slowest stage instead of the sum.
+ *
+ *        The map is double buffered. Scans are inserted into the back map, which is then
+ *        published for matching, and replayed into the other map before its next update.
+ *        Matching therefore never waits for an insertion, but a scan is matched against
+ *        a map which may lack the scans inserted in the meantime. A map is never read and
+ *        written at the same time and only the match stage reads it, so the distributions
+ *        are evaluated lazily and the cost of an insertion does not depend on the map size.
+ */
+template<typename map_t = cslibs_ndt_3d::dynamic_maps::Gridmap>
+class EIGEN_ALIGN16 OdometryPipeline
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Ptr           = std::shared_ptr<OdometryPipeline>;
+    using traits_t      = cslibs_ndt::matching::MatchTraits<map_t>;
+    using transform_t   = typename traits_t::transform_t;
+    using point_t       = typename traits_t::point_t;
+    using parameter_t   = typename traits_t::parameter_t;
+    using result_t      = cslibs_ndt::matching::Result<transform_t>;
+    using cloud_t       = cslibs_math_3d::Pointcloud3d;
+    using cloud_ptr_t   = cloud_t::ConstPtr;
+    using pool_t        = cslibs_ndt::common::ThreadPool;
+
+    struct EIGEN_ALIGN16 Output
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        std::size_t id       = 0;       /// position of the scan in the input
+        result_t    result;             /// the pose of the scan in the map frame
+        bool        inserted = false;   /// whether the scan is inserted into the map
+    };
+
+    /**
+     * @param origin       - origin of the map
+     * @param resolution   - resolution of the map
+     * @param param        - the parameters of every match
+     * @param odometry     - queue sizes, downsampling and map update policy
+     * @param initial_pose - pose of the first scan, it is inserted without matching
+     * @param pool         - the pool downsampling runs on, the shared default if empty
+     */
+    inline explicit OdometryPipeline(const typename map_t::pose_t &origin,
+                                     const double resolution,
+                                     const parameter_t &param,
+                                     const cslibs_ndt::matching::OdometryParameter &odometry =
+                                            cslibs_ndt::matching::OdometryParameter(),
+                                     const transform_t &initial_pose = transform_t(),
+                                     const pool_t::Ptr &pool = pool_t::getDefault()) :
+        param_(param),
+        odometry_(odometry),
+        initial_pose_(initial_pose),
+        maps_{{std::shared_ptr<map_t>(new map_t(origin, resolution)),
+               std::shared_ptr<map_t>(new map_t(origin, resolution))}},
+        front_(0),
+        published_(0),
+        in_use_(false),
+        in_use_index_(0),
+        stop_(false),
+        input_(odometry.queueCapacity()),
+        matching_(odometry.queueCapacity()),
+        inserting_(odometry.queueCapacity()),
+        output_(std::numeric_limits<std::size_t>::max()),
+        scans_(0),
+        pool_(pool ? pool : pool_t::getDefault()),
+        stages_(new pool_t(STAGES + 1, cslibs_ndt::common::Backend::THREADS))
+    {
+        start(&OdometryPipeline::filterStage, 0);
+        start(&OdometryPipeline::matchStage,  1);
+        start(&OdometryPipeline::insertStage, 2);
+    }
+
+    /**
+     * @brief Pending scans are dropped.
+     */
+    virtual ~OdometryPipeline()
+    {
+        stop();
+        join();
+    }
+
+    /**
+     * @brief Queue the next scan, blocks while the first stage is busy.
+     * @param scan   - the scan in the sensor frame
+     * @param motion - predicted motion since the previous scan, e.g. from wheel odometry
+     * @return false if the pipeline was closed
+     */
+    inline bool push(const cloud_ptr_t &scan,
+                     const transform_t &motion = transform_t())
+    {
+        if (!scan)
+            return false;
+
+        Scan s;
+        s.id     = scans_++;
+        s.raw    = scan;
+        s.motion = motion;
+        return input_.push(s);
+    }
+
+    /**
+     * @brief Wait for the result of the next scan, results come in input order. Outputs
+     *        are not bounded, the pipeline does not stall if they are taken late.
+     * @return false once the pipeline is closed and all results were taken
+     */
+    inline bool pop(Output &output)
+    {
+        if (output_.pop(output))
+            return true;
+        rethrow();
+        return false;
+    }
+
+    /**
+     * @brief Finish the queued scans and stop the stages. The results can still be
+     *        taken with pop afterwards.
+     */
+    inline void close()
+    {
+        input_.close();
+        join();
+        rethrow();
+    }
+
+    /**
+     * @brief The map containing all inserted scans, only valid after close.
+     */
+    inline const map_t& getMap() const
+    {
+        return *maps_[front_];
+    }
+
+private:
+    struct EIGEN_ALIGN16 Scan
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        std::size_t id = 0;
+        cloud_ptr_t raw;
+        cloud_ptr_t filtered;
+        transform_t motion;
+    };
+
+    struct EIGEN_ALIGN16 Insertion
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        cloud_ptr_t scan;
+        transform_t pose;
+    };
+
+    using filter_t = cslibs_ndt::matching::VoxelFilter<3>;
+
+    static constexpr std::size_t STAGES = 3;
+
+    const parameter_t                           param_;
+    const cslibs_ndt::matching::OdometryParameter odometry_;
+    const transform_t                           initial_pose_;
+
+    /// double buffered map, front_ is published for matching
+    std::array<std::shared_ptr<map_t>, 2>       maps_;
+    std::size_t                                 front_;
+    std::size_t                                 published_;
+    bool                                        in_use_;
+    std::size_t                                 in_use_index_;
+    bool                                        stop_;
+    std::mutex                                  mutex_;
+    std::condition_variable                     notify_;
+    std::exception_ptr                          exception_;
+
+    cslibs_ndt::common::BoundedQueue<Scan>      input_;
+    cslibs_ndt::common::BoundedQueue<Scan>      matching_;
+    cslibs_ndt::common::BoundedQueue<Insertion> inserting_;
+    cslibs_ndt::common::BoundedQueue<Output>    output_;
+    std::size_t                                 scans_;
+
+    /// the stages block on their queues, they get workers of their own instead of the shared pool
+    pool_t::Ptr                                 pool_;
+    pool_t::Ptr                                 stages_;
+    std::array<std::future<void>, STAGES>       done_;
+
+    inline void start(void (OdometryPipeline::*stage)(),
+                      const std::size_t index)
+    {
+        std::shared_ptr<std::promise<void>> done(new std::promise<void>);
+        done_[index] = done->get_future();
+        stages_->enqueue([this, stage, done]() {
+            run(stage);
+            done->set_value();
+        });
+    }
+
+    inline void run(void (OdometryPipeline::*stage)())
+    {
+        try {
+            (this->*stage)();
+        } catch (...) {
+            {
+                std::unique_lock<std::mutex> l(mutex_);
+                if (!exception_)
+                    exception_ = std::current_exception();
+            }
+            stop();
+        }
+    }
+
+    inline void stop()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            stop_ = true;
+        }
+        notify_.notify_all();
+        input_.close();
+        matching_.close();
+        inserting_.close();
+        output_.close();
+    }
+
+    inline void join()
+    {
+        for (std::future<void> &d : done_) {
+            if (d.valid())
+                d.wait();
+        }
+    }
+
+    inline void rethrow()
+    {
+        std::exception_ptr e;
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            e = exception_;
+        }
+        if (e)
+            std::rethrow_exception(e);
+    }
+
+    inline void filterStage()
+    {
+        filter_t::Ptr filter;
+        if (odometry_.downsamplingResolution() > 0.0)
+            filter.reset(new filter_t(odometry_.downsamplingResolution(),
+                                      cslibs_ndt::matching::VoxelFilterMode::CENTROID, false, pool_));
+
+        Scan s;
+        while (input_.pop(s)) {
+            if (filter) {
+                filter->apply(s.raw->begin(), s.raw->end());
+                cloud_t::Ptr filtered(new cloud_t);
+                for (const auto &p : filter->points())
+                    filtered->insert(point_t(p));
+                s.filtered = filtered;
+            } else {
+                s.filtered = s.raw;
+            }
+            if (!matching_.push(s))
+                break;
+        }
+        matching_.close();
+    }
+
+    inline void matchStage()
+    {
+        cslibs_ndt::matching::impl::Workspace<traits_t> workspace(pool_);
+
+        transform_t pose          = initial_pose_;
+        transform_t last_inserted = initial_pose_;
+        std::size_t since_insert  = 0;
+
+        Scan s;
+        while (matching_.pop(s)) {
+            Output output;
+            output.id = s.id;
+
+            const transform_t prediction = pose * s.motion;
+            if (s.id == 0) {
+                output.result = result_t(0.0, 0, initial_pose_, cslibs_ndt::matching::Termination::NONE);
+            } else {
+                const map_t *map = acquire();
+                if (!map)
+                    break;
+                output.result = cslibs_ndt::matching::impl::match<typename cloud_t::const_iterator, map_t, traits_t>(
+                            s.filtered->begin(), s.filtered->end(), *map, param_, prediction, workspace);
+                release();
+            }
+            pose = output.result.transform();
+
+            ++since_insert;
+            output.inserted = s.id == 0 || update(since_insert, pose, last_inserted);
+            if (output.inserted) {
+                since_insert  = 0;
+                last_inserted = pose;
+
+                Insertion insertion;
+                insertion.scan = s.raw;
+                insertion.pose = pose;
+                if (!inserting_.push(insertion))
+                    break;
+            }
+
+            if (!output_.push(output))
+                break;
+        }
+        inserting_.close();
+        output_.close();
+    }
+
+    inline void insertStage()
+    {
+        Insertion pending;
+        Insertion insertion;
+        while (inserting_.pop(insertion)) {
+            std::size_t back;
+            {
+                /// a match started before the last swap may still read the back map
+                std::unique_lock<std::mutex> l(mutex_);
+                back = 1 - front_;
+                notify_.wait(l, [this, back]() { return stop_ || !(in_use_ && in_use_index_ == back); });
+                if (stop_)
+                    return;
+            }
+
+            map_t &map = *maps_[back];
+            if (pending.scan)
+                map.insert(pending.scan, pending.pose);
+            map.insert(insertion.scan, insertion.pose);
+
+            {
+                std::unique_lock<std::mutex> l(mutex_);
+                front_ = back;
+                ++published_;
+            }
+            notify_.notify_all();
+            pending = insertion;
+        }
+
+        /// both maps hold all scans when the pipeline is closed
+        if (pending.scan) {
+            std::unique_lock<std::mutex> l(mutex_);
+            const std::size_t back = 1 - front_;
+            notify_.wait(l, [this, back]() { return stop_ || !(in_use_ && in_use_index_ == back); });
+            if (stop_)
+                return;
+            maps_[back]->insert(pending.scan, pending.pose);
+        }
+    }
+
+    /**
+     * @brief Wait for the first published map and mark the front map as in use.
+     */
+    inline const map_t* acquire()
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        notify_.wait(l, [this]() { return stop_ || published_ > 0; });
+        if (stop_)
+            return nullptr;
+        in_use_       = true;
+        in_use_index_ = front_;
+        return maps_[front_].get();
+    }
+
+    inline void release()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            in_use_ = false;
+        }
+        notify_.notify_all();
+    }
+
+    inline bool update(const std::size_t since_insert,
+                       const transform_t &pose,
+                       const transform_t &last_inserted) const
+    {
+        const bool every       = odometry_.insertEvery() > 0;
+        const bool translation = odometry_.minTranslation() > 0.0;
+        const bool rotation    = odometry_.minRotation() > 0.0;
+        if (!every && !translation && !rotation)
+            return true;
+
+        return (every       && since_insert >= odometry_.insertEvery()) ||
+               (translation && (pose.translation() - last_inserted.translation()).length() >= odometry_.minTranslation()) ||
+               (rotation    && pose.rotation().angle(last_inserted.rotation()) >= odometry_.minRotation());
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_ODOMETRY_PIPELINE_HPP
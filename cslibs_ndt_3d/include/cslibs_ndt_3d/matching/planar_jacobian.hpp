@@ -0,0 +1,51 @@
+#ifndef CSLIBS_NDT_3D_PLANAR_JACOBIAN_HPP
+#define CSLIBS_NDT_3D_PLANAR_JACOBIAN_HPP
+
+#include <Eigen/Eigen>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Closed form derivatives of a planar transform (x, y, yaw) applied to a 3D
+ *        point, z, roll and pitch are kept fixed. Only the yaw column depends on the point.
+ */
+class EIGEN_ALIGN16 PlanarJacobian {
+public:
+    using point_t   = Eigen::Vector3d;
+    using angular_t = Eigen::Matrix<double, 1, 1>;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    inline PlanarJacobian() :
+        sin_(0.0),
+        cos_(1.0)
+    {
+    }
+
+    enum Partial{tx = 0, ty = 1, yaw = 2};
+
+    inline const point_t get(const std::size_t pi,
+                             const point_t &p) const
+    {
+        assert(pi < 3);
+        return pi == tx ? point_t(1.0, 0.0, 0.0) :
+               pi == ty ? point_t(0.0, 1.0, 0.0) :
+                          point_t(-sin_ * p(0) - cos_ * p(1),
+                                   cos_ * p(0) - sin_ * p(1),
+                                   0.0);
+    }
+
+    inline static void get(const angular_t &angular, /// linear components not required because the derivation is always the same
+                           PlanarJacobian &j)
+    {
+        j.sin_ = std::sin(angular(0));
+        j.cos_ = std::cos(angular(0));
+    }
+
+private:
+    double sin_;
+    double cos_;
+};
+}
+}
+#endif // CSLIBS_NDT_3D_PLANAR_JACOBIAN_HPP
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cslibs_ndt/matching/match.hpp>
+#include <cslibs_ndt/matching/planar_derivatives.hpp>
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+#include <cslibs_ndt_3d/matching/occupancy_gridmap_match_traits.hpp>
+#include <cslibs_ndt_3d/matching/planar_jacobian.hpp>
+#include <cslibs_ndt_3d/matching/planar_hessian.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Planar mode for ground vehicles: only x, y and yaw are optimized, z, roll and
+ *        pitch of the initial transform are kept. Pass it explicitly to the generic match,
+ *        e.g. cslibs_ndt::matching::match<iterator_t, map_t, PlanarMatchTraits<map_t>>(...).
+ */
+template<typename MapT, typename Enable = void>
+struct PlanarMatchTraits;
+
+template<typename MapT>
+struct PlanarMatchTraits<MapT, typename std::enable_if<cslibs_ndt::matching::IsGridmap<MapT>::value>::type>
+{
+    static constexpr int LINEAR_DIMS  = 2;
+    static constexpr int ANGULAR_DIMS = 1;
+    using Jacobian              = cslibs_ndt_3d::matching::PlanarJacobian;
+    using Hessian               = cslibs_ndt_3d::matching::PlanarHessian;
+
+    using gradient_t            = Eigen::Matrix<double, 3, 1>;
+    using hessian_t             = Eigen::Matrix<double, 3, 3>;
+
+    using point_t               = cslibs_math_3d::Point3d;
+    using transform_t           = cslibs_math_3d::Transform3d;
+    using parameter_t           = cslibs_ndt::matching::Parameter;
+
+    static transform_t makeTransform(const Eigen::Vector2d& linear,
+                                     const Eigen::Matrix<double, 1, 1>& angular)
+    {
+        return transform_t{linear.x(), linear.y(), 0.0, 0.0, 0.0, angular(0)};
+    }
+
+    static void prepare(const MapT& map)
+    {
+        cslibs_ndt::matching::MatchTraits<MapT>::prepare(map);
+    }
+
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const Hessian& H,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g,
+                                hessian_t& h)
+    {
+        accumulate(map, point, point_prime, J, &H, param, score, g, &h);
+    }
+
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(map, point, point_prime, J, nullptr, param, score, g, nullptr);
+    }
+
+private:
+    static void accumulate(const MapT& map,
+                           const point_t& point,
+                           const point_t& point_prime,
+                           const Jacobian& J,
+                           const Hessian* H,
+                           const parameter_t& param,
+                           double& score,
+                           gradient_t& g,
+                           hessian_t* h)
+    {
+        /// lookup does not allocate, evaluations can run concurrently after prepare
+        typename MapT::distribution_const_bundle_t::data_t bundle;
+        if (!map.lookupDistributionBundle(point, bundle))
+            return;
+
+        const Eigen::Vector3d J_yaw = J.get(Jacobian::yaw, point_prime.data());
+        const Eigen::Vector3d H_yaw = h ? H->get(Hessian::yaw, Hessian::yaw, point_prime.data()) : Eigen::Vector3d::Zero();
+
+        for (const auto* distribution_wrapper : bundle)
+        {
+            if (!distribution_wrapper)
+                continue;
+
+            const auto& d = distribution_wrapper->data();
+            if (d.getN() < 4)
+                continue;
+
+            const Eigen::Matrix3d info   = d.getInformationMatrix();
+            const Eigen::Vector3d q      = point.data() - d.getMean();
+            const Eigen::Vector3d q_info = info * q;
+            const double          s      = cslibs_ndt::common::gaussianCutoff(-0.5 * q.dot(q_info), param.kernel());
+            if (!std::isnormal(s) || s <= 1e-5)
+                continue;
+
+            cslibs_ndt::matching::impl::accumulatePlanar<3>(q_info, info, J_yaw, H_yaw, s, 1.0, g, h);
+            score += s;
+        }
+    }
+};
+
+template<typename MapT>
+struct PlanarMatchTraits<MapT, typename std::enable_if<cslibs_ndt::matching::IsOccupancyGridmap<MapT>::value>::type>
+{
+    static constexpr int LINEAR_DIMS  = 2;
+    static constexpr int ANGULAR_DIMS = 1;
+    using Jacobian  = cslibs_ndt_3d::matching::PlanarJacobian;
+    using Hessian   = cslibs_ndt_3d::matching::PlanarHessian;
+
+    using gradient_t = Eigen::Matrix<double, 3, 1>;
+    using hessian_t  = Eigen::Matrix<double, 3, 3>;
+
+    using point_t = cslibs_math_3d::Point3d;
+    using transform_t = cslibs_math_3d::Transform3d;
+    using parameter_t = cslibs_ndt::matching::OccupancyParameter;
+    using cache_t     = cslibs_ndt::matching::OccupancyCache<MapT>;
+
+    static transform_t makeTransform(const Eigen::Vector2d& linear,
+                                     const Eigen::Matrix<double, 1, 1>& angular)
+    {
+        return transform_t{linear.x(), linear.y(), 0.0, 0.0, 0.0, angular(0)};
+    }
+
+    /**
+     * @brief Resolve the occupancy weights of all bundles the initially transformed scan touches.
+     */
+    template<typename points_t>
+    static void prepareCache(const MapT& map,
+                             const parameter_t& param,
+                             const points_t& points,
+                             cache_t& cache)
+    {
+        cache.reset(map, param.inverseModel(), param.occupancyThreshold());
+        for (const point_t& point : points)
+            cache.get(point);
+    }
+
+    static void computeGradient(const MapT&,
+                                cache_t& cache,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const Hessian& H,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g,
+                                hessian_t& h)
+    {
+        accumulate(cache.get(point), point, point_prime, J, &H, param.kernel(), score, g, &h);
+    }
+
+    static void computeGradient(const MapT&,
+                                cache_t& cache,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(cache.get(point), point, point_prime, J, nullptr, param.kernel(), score, g, nullptr);
+    }
+
+    /**
+     * @brief Uncached evaluation, the bundle is resolved for every call.
+     */
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const Hessian& H,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g,
+                                hessian_t& h)
+    {
+        accumulate(resolve(map, point, param), point, point_prime, J, &H, param.kernel(), score, g, &h);
+    }
+
+    static void computeGradient(const MapT& map,
+                                const point_t& point,
+                                const point_t& point_prime,
+                                const Jacobian& J,
+                                const parameter_t& param,
+                                double& score,
+                                gradient_t& g)
+    {
+        accumulate(resolve(map, point, param), point, point_prime, J, nullptr, param.kernel(), score, g, nullptr);
+    }
+
+private:
+    static typename cache_t::Entry resolve(const MapT& map,
+                                           const point_t& point,
+                                           const parameter_t& param)
+    {
+        typename cache_t::Entry entry;
+        cache_t::resolve(map, point, param.inverseModel(), param.occupancyThreshold(), entry);
+        return entry;
+    }
+
+    static void accumulate(const typename cache_t::Entry& entry,
+                           const point_t& point,
+                           const point_t& point_prime,
+                           const Jacobian& J,
+                           const Hessian* H,
+                           const cslibs_ndt::common::Kernel kernel,
+                           double& score,
+                           gradient_t& g,
+                           hessian_t* h)
+    {
+        static constexpr double d1 = 0.95;
+        static constexpr double d2 = 1 - d1;
+
+        if (entry.size == 0)
+            return;
+
+        /// the translational columns are unit vectors, only the yaw column depends on the point
+        const Eigen::Vector3d J_yaw = J.get(Jacobian::yaw, point_prime.data());
+        const Eigen::Vector3d H_yaw = h ? H->get(Hessian::yaw, Hessian::yaw, point_prime.data()) : Eigen::Vector3d::Zero();
+
+        for (std::size_t k = 0; k < entry.size; ++k)
+        {
+            const auto& d = *entry.distributions[k];
+
+            const Eigen::Matrix3d info   = d.getInformationMatrix();
+            const Eigen::Vector3d q      = point.data() - d.getMean();
+            const Eigen::Vector3d q_info = info * q;
+            const double          p_occ  = entry.occupancy[k];
+            const double          c      = d2 * (1 - p_occ);
+            const double          s      = d1 * p_occ * cslibs_ndt::common::gaussianCutoff(-0.5 * q.dot(q_info) * c, kernel);
+            if (!std::isnormal(s) || s <= 1e-5)
+                continue;
+
+            /// g = -ds/dp, h = d^2s/dp^2
+            cslibs_ndt::matching::impl::accumulatePlanar<3>(q_info, info, J_yaw, H_yaw, s, c, g, h);
+
+            score += s;
+        }
+    }
+};
+
+/**
+ * @brief Match in the plane only, see PlanarMatchTraits.
+ */
+template<typename iterator_t, typename ndt_t>
+auto matchPlanar(const iterator_t& points_begin,
+                 const iterator_t& points_end,
+                 const ndt_t& map,
+                 const typename PlanarMatchTraits<ndt_t>::parameter_t& param,
+                 const typename ndt_t::transform_t& initial_transform)
+-> cslibs_ndt::matching::Result<typename ndt_t::transform_t>
+{
+    return cslibs_ndt::matching::match<iterator_t, ndt_t, PlanarMatchTraits<ndt_t>>(
+                points_begin, points_end, map, param, initial_transform);
+}
+}
+}
@@ -0,0 +1,447 @@
+#ifndef CSLIBS_NDT_3D_RELOCALIZATION_HPP
+#define CSLIBS_NDT_3D_RELOCALIZATION_HPP
+
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <cslibs_ndt/common/index_hash.hpp>
+#include <cslibs_ndt/common/thread_pool.hpp>
+#include <cslibs_ndt/matching/match.hpp>
+
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+#include <cslibs_ndt_3d/matching/relocalization_params.hpp>
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Global relocalization on a gridmap by branch and bound over translation and
+ *        yaw, following the fast correlative scan matcher of Hess et al. (Cartographer).
+ *
+ *        The map is sampled once into a grid of scores. Coarser grids store the maximum
+ *        over blocks of 2^h cells, so the score of a scan on such a grid bounds the score
+ *        of every translation within the block. Axes without a translational window are
+ *        not pooled. The grids are stored in hashed chunks, only chunks around the bundles
+ *        of the map are allocated. The scan is rotated once per yaw step and
+ *        discretized; subtrees of the coarsest candidates are searched in parallel and
+ *        pruned against the best candidates found so far. The best candidates are refined
+ *        by matching, the best match is returned.
+ *
+ *        The score grids are computed on construction, the map must not be modified while
+ *        it is in use.
+ */
+template<typename map_t>
+class EIGEN_ALIGN16 Relocalization
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Ptr           = std::shared_ptr<Relocalization>;
+    using traits_t      = cslibs_ndt::matching::MatchTraits<map_t>;
+    using transform_t   = typename traits_t::transform_t;
+    using point_t       = typename traits_t::point_t;
+    using parameter_t   = typename traits_t::parameter_t;
+    using result_t      = cslibs_ndt::matching::Result<transform_t>;
+    using map_ptr_t     = std::shared_ptr<const map_t>;
+    using pool_t        = cslibs_ndt::common::ThreadPool;
+
+    struct EIGEN_ALIGN16 Candidate {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        transform_t transform;
+        double      score;      /// mean score of the points on the finest grid
+    };
+    using candidate_array_t = std::vector<Candidate, Eigen::aligned_allocator<Candidate>>;
+
+    /**
+     * @brief Create a relocalization and precompute the score grids.
+     * @param map   - the map to relocalize in
+     * @param param - search window and resolution
+     * @param pool  - the pool to run on, the shared default if empty
+     */
+    inline explicit Relocalization(const map_ptr_t &map,
+                                   const RelocalizationParameter &param,
+                                   const pool_t::Ptr &pool = pool_t::getDefault()) :
+        map_(map),
+        param_(param),
+        pool_(pool ? pool : pool_t::getDefault()),
+        resolution_(param.resolution() > 0.0 ? param.resolution() : map->getBundleResolution()),
+        resolution_inv_(1.0 / resolution_),
+        w_T_m_(map->getInitialOrigin()),
+        m_T_w_(w_T_m_.inverse()),
+        min_(map->getMin().data())
+    {
+        const int xy = static_cast<int>(std::ceil(param_.linearWindowXY() * resolution_inv_));
+        const int z  = static_cast<int>(std::ceil(param_.linearWindowZ()  * resolution_inv_));
+        window_ = {{xy, xy, z}};
+
+        traits_t::prepare(*map_);
+        precompute();
+    }
+
+    /**
+     * @brief Search for the points around the initial transform and refine the best candidates.
+     * @param points_begin      - the points in the sensor frame
+     * @param points_end        - end of the points
+     * @param initial_transform - center of the search window
+     * @param match_param       - parameter of the refinement
+     * @return the best refined match, Termination::NONE without any candidate
+     */
+    template<typename iterator_t>
+    inline result_t relocalize(const iterator_t &points_begin,
+                               const iterator_t &points_end,
+                               const transform_t &initial_transform,
+                               const parameter_t &match_param)
+    {
+        candidates_.clear();
+        const std::vector<point_t> points(points_begin, points_end);
+        if (points.empty() || grids_.empty())
+            return result_t(0.0, 0, initial_transform, cslibs_ndt::matching::Termination::NONE);
+
+        discretize(points, initial_transform);
+        search();
+
+        /// refine every candidate by matching, keep the best match
+        const pool_t::Ptr serial(new pool_t(1));
+        std::vector<cslibs_ndt::matching::impl::Workspace<traits_t>> workspaces(
+                    pool_->concurrency(), cslibs_ndt::matching::impl::Workspace<traits_t>(serial));
+        std::vector<result_t, Eigen::aligned_allocator<result_t>> results(candidates_.size());
+        pool_->parallelFor(0, candidates_.size(), 1, [&](const std::size_t slot,
+                                                         const std::size_t begin,
+                                                         const std::size_t end) {
+            for (std::size_t i = begin ; i < end ; ++i)
+                results[i] = cslibs_ndt::matching::impl::match<typename std::vector<point_t>::const_iterator, map_t, traits_t>(
+                            points.begin(), points.end(), *map_, match_param, candidates_[i].transform, workspaces[slot]);
+        });
+
+        if (results.empty())
+            return result_t(0.0, 0, initial_transform, cslibs_ndt::matching::Termination::NONE);
+        return *std::max_element(results.begin(), results.end(),
+                                 [](const result_t &a, const result_t &b) { return a.score() < b.score(); });
+    }
+
+    inline result_t relocalize(const cslibs_math_3d::Pointcloud3d::ConstPtr &points,
+                               const transform_t &initial_transform,
+                               const parameter_t &match_param)
+    {
+        return relocalize(points->begin(), points->end(), initial_transform, match_param);
+    }
+
+    /**
+     * @brief The candidates of the last search before refinement, best first.
+     */
+    inline const candidate_array_t& getCandidates() const
+    {
+        return candidates_;
+    }
+
+private:
+    using cell_t = std::array<int, 3>;
+
+    /// grid of level h stores the maximum over [i, i + 2^h) of the base grid along the pooled axes,
+    /// cells outside of the allocated chunks are 0
+    struct Grid {
+        static constexpr int CHUNK_BITS = 3;
+        static constexpr int CHUNK      = 1 << CHUNK_BITS;
+        static constexpr int CHUNK_MASK = CHUNK - 1;
+
+        using chunk_t       = std::array<float, CHUNK * CHUNK * CHUNK>;
+        using chunk_map_t   = std::unordered_map<cell_t, chunk_t, cslibs_ndt::common::IndexHash<3>>;
+        using chunk_set_t   = std::unordered_set<cell_t, cslibs_ndt::common::IndexHash<3>>;
+
+        chunk_map_t chunks;
+
+        /// arithmetic shift, floors negative cells as well
+        inline static cell_t chunkIndex(const int x, const int y, const int z)
+        {
+            return {{x >> CHUNK_BITS, y >> CHUNK_BITS, z >> CHUNK_BITS}};
+        }
+
+        inline static std::size_t cellIndex(const int x, const int y, const int z)
+        {
+            return (static_cast<std::size_t>(z & CHUNK_MASK) * CHUNK + (y & CHUNK_MASK)) * CHUNK + (x & CHUNK_MASK);
+        }
+
+        inline float at(const int x, const int y, const int z) const
+        {
+            const auto c = chunks.find(chunkIndex(x, y, z));
+            return c == chunks.end() ? 0.0f : c->second[cellIndex(x, y, z)];
+        }
+
+        /// allocate the given chunks zeroed, fill them in parallel and drop the empty ones
+        template<typename fill_t>
+        inline void build(const chunk_set_t &keys,
+                          const pool_t::Ptr &pool,
+                          const fill_t &fill)
+        {
+            std::vector<std::pair<cell_t, chunk_t*>> allocated;
+            allocated.reserve(keys.size());
+            chunks.reserve(keys.size());
+            for (const cell_t &k : keys) {
+                chunk_t &chunk = chunks[k];
+                chunk.fill(0.0f);
+                allocated.emplace_back(k, &chunk);
+            }
+
+            pool->parallelFor(0, allocated.size(), 4, [&allocated, &fill](const std::size_t, const std::size_t begin, const std::size_t end) {
+                for (std::size_t i = begin ; i < end ; ++i) {
+                    const cell_t &k = allocated[i].first;
+                    chunk_t &chunk  = *allocated[i].second;
+                    for (int z = 0 ; z < CHUNK ; ++z)
+                        for (int y = 0 ; y < CHUNK ; ++y)
+                            for (int x = 0 ; x < CHUNK ; ++x)
+                                chunk[(static_cast<std::size_t>(z) * CHUNK + y) * CHUNK + x] =
+                                        fill(k[0] * CHUNK + x, k[1] * CHUNK + y, k[2] * CHUNK + z);
+                }
+            });
+
+            for (auto c = chunks.begin() ; c != chunks.end() ;) {
+                if (std::all_of(c->second.begin(), c->second.end(), [](const float v) { return v == 0.0f; }))
+                    c = chunks.erase(c);
+                else
+                    ++c;
+            }
+        }
+    };
+
+    struct Node {
+        std::size_t yaw;
+        cell_t      offset;
+        double      score;
+    };
+
+    map_ptr_t                       map_;
+    RelocalizationParameter         param_;
+    pool_t::Ptr                     pool_;
+    double                          resolution_;
+    double                          resolution_inv_;
+    transform_t                     w_T_m_;
+    transform_t                     m_T_w_;
+    Eigen::Vector3d                 min_;
+    std::vector<Grid>               grids_;
+
+    std::vector<transform_t, Eigen::aligned_allocator<transform_t>> rotated_;
+    std::vector<std::vector<cell_t>> scans_;
+    cell_t                          window_;
+    candidate_array_t               candidates_;
+    std::atomic<double>             threshold_;
+    std::mutex                      candidates_mutex_;
+
+    inline void precompute()
+    {
+        const std::size_t depth = std::max<std::size_t>(1, param_.depth());
+        grids_.resize(depth);
+
+        /// step one: the chunks overlapping any bundle of the map
+        const double bundle_resolution = map_->getBundleResolution();
+        typename Grid::chunk_set_t keys;
+        map_->traverse([this, &keys, bundle_resolution](const typename map_t::index_t &bi,
+                                                       const typename map_t::distribution_bundle_t &) {
+            cell_t lo, hi;
+            for (std::size_t d = 0 ; d < 3 ; ++d) {
+                lo[d] = static_cast<int>(std::floor((bi[d] * bundle_resolution - min_(d)) * resolution_inv_)) >> Grid::CHUNK_BITS;
+                hi[d] = static_cast<int>(std::floor(((bi[d] + 1) * bundle_resolution - min_(d)) * resolution_inv_)) >> Grid::CHUNK_BITS;
+            }
+            for (int z = lo[2] ; z <= hi[2] ; ++z)
+                for (int y = lo[1] ; y <= hi[1] ; ++y)
+                    for (int x = lo[0] ; x <= hi[0] ; ++x)
+                        keys.insert(cell_t{{x, y, z}});
+        });
+
+        /// base grid: the map maximum within each cell, approximated by sampling the
+        /// center and the means of the surrounding distributions clamped into the cell
+        grids_[0].build(keys, pool_, [this](const int x, const int y, const int z) {
+            const auto sample = [this](const point_t &p) {
+                const double v = map_->sampleNonNormalized(p, param_.kernel());
+                return std::isfinite(v) ? v : 0.0;
+            };
+
+            const Eigen::Vector3d lower = min_ + Eigen::Vector3d(x, y, z) * resolution_;
+            const Eigen::Vector3d upper = lower + Eigen::Vector3d::Constant(resolution_);
+            const point_t center = w_T_m_ * point_t(0.5 * (lower + upper));
+
+            typename map_t::distribution_const_bundle_t::data_t bundle;
+            if (!map_->lookupDistributionBundle(center, bundle))
+                return 0.0f;
+
+            double v = sample(center);
+            for (const auto *d : bundle) {
+                if (!d || !d->data().valid())
+                    continue;
+                const Eigen::Vector3d mean = (m_T_w_ * point_t(d->data().getMean())).data();
+                const point_t closest(mean.cwiseMax(lower).cwiseMin(upper));
+                v = std::max(v, sample(w_T_m_ * closest));
+            }
+            return static_cast<float>(v);
+        });
+
+        /// step two: every level doubles the block of its predecessor along the pooled axes
+        for (std::size_t h = 1 ; h < depth ; ++h) {
+            const Grid &prev = grids_[h - 1];
+            const int half = 1 << (h - 1);
+
+            std::vector<cell_t> shifts(1, cell_t{{0, 0, 0}});
+            for (std::size_t d = 0 ; d < 3 ; ++d) {
+                if (window_[d] <= 0)
+                    continue;
+                const std::size_t n = shifts.size();
+                for (std::size_t i = 0 ; i < n ; ++i) {
+                    cell_t s = shifts[i];
+                    s[d] = half;
+                    shifts.emplace_back(s);
+                }
+            }
+
+            /// the cells of a previous chunk are pooled into the cells up to half below them
+            keys.clear();
+            for (const auto &c : prev.chunks) {
+                cell_t lo;
+                for (std::size_t d = 0 ; d < 3 ; ++d)
+                    lo[d] = window_[d] > 0 ? (c.first[d] * Grid::CHUNK - half) >> Grid::CHUNK_BITS : c.first[d];
+                for (int z = lo[2] ; z <= c.first[2] ; ++z)
+                    for (int y = lo[1] ; y <= c.first[1] ; ++y)
+                        for (int x = lo[0] ; x <= c.first[0] ; ++x)
+                            keys.insert(cell_t{{x, y, z}});
+            }
+
+            grids_[h].build(keys, pool_, [&prev, &shifts](const int x, const int y, const int z) {
+                float v = 0.0f;
+                for (const cell_t &s : shifts)
+                    v = std::max(v, prev.at(x + s[0], y + s[1], z + s[2]));
+                return v;
+            });
+        }
+    }
+
+    /// rotate the points once per yaw step about the initial translation and discretize them
+    inline void discretize(const std::vector<point_t> &points,
+                           const transform_t &initial_transform)
+    {
+        double range = 0.0;
+        for (const point_t &p : points)
+            range = std::max(range, p.length());
+
+        double step = param_.angularResolution();
+        if (step <= 0.0) {
+            const double r = std::max(range, resolution_);
+            step = std::acos(1.0 - resolution_ * resolution_ / (2.0 * r * r));
+        }
+        const int steps = static_cast<int>(std::ceil(param_.angularWindow() / step));
+
+        rotated_.clear();
+        for (int k = -steps ; k <= steps ; ++k)
+            rotated_.emplace_back(initial_transform.translation(),
+                                  cslibs_math_3d::Quaternion(0.0, 0.0, k * step) * initial_transform.rotation());
+
+        scans_.resize(rotated_.size());
+        pool_->parallelFor(0, rotated_.size(), 1, [this, &points](const std::size_t, const std::size_t begin, const std::size_t end) {
+            for (std::size_t k = begin ; k < end ; ++k) {
+                const transform_t m_T_s = m_T_w_ * rotated_[k];
+                std::vector<cell_t> &scan = scans_[k];
+                scan.resize(points.size());
+                for (std::size_t i = 0 ; i < points.size() ; ++i) {
+                    const Eigen::Vector3d c = ((m_T_s * points[i]).data() - min_) * resolution_inv_;
+                    scan[i] = {{static_cast<int>(std::floor(c(0))),
+                                static_cast<int>(std::floor(c(1))),
+                                static_cast<int>(std::floor(c(2)))}};
+                }
+            }
+        });
+    }
+
+    inline double score(const Node &node, const std::size_t level) const
+    {
+        const Grid &grid = grids_[level];
+        const std::vector<cell_t> &scan = scans_[node.yaw];
+        double s = 0.0;
+        for (const cell_t &c : scan)
+            s += grid.at(c[0] + node.offset[0], c[1] + node.offset[1], c[2] + node.offset[2]);
+        return s / static_cast<double>(scan.size());
+    }
+
+    inline void search()
+    {
+        const std::size_t top = grids_.size() - 1;
+        const int width = 1 << top;
+
+        /// step one: bound all candidates of the coarsest level
+        std::vector<Node> nodes;
+        for (std::size_t k = 0 ; k < scans_.size() ; ++k)
+            for (int z = -window_[2] ; z <= window_[2] ; z += width)
+                for (int y = -window_[1] ; y <= window_[1] ; y += width)
+                    for (int x = -window_[0] ; x <= window_[0] ; x += width)
+                        nodes.push_back(Node{k, {{x, y, z}}, 0.0});
+
+        pool_->parallelFor(0, nodes.size(), 64, [this, &nodes, top](const std::size_t, const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin ; i < end ; ++i)
+                nodes[i].score = score(nodes[i], top);
+        });
+        std::sort(nodes.begin(), nodes.end(), [](const Node &a, const Node &b) { return a.score > b.score; });
+
+        /// step two: search the subtrees best first, sharing the pruning threshold
+        threshold_ = param_.minScore();
+        pool_->parallelFor(0, nodes.size(), 1, [this, &nodes, top](const std::size_t, const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin ; i < end ; ++i)
+                if (nodes[i].score > threshold_.load())
+                    branch(nodes[i], top);
+        });
+    }
+
+    inline void branch(const Node &node, const std::size_t level)
+    {
+        if (level == 0) {
+            accept(node);
+            return;
+        }
+
+        const int half = 1 << (level - 1);
+        std::vector<Node> children;
+        children.reserve(8);
+        for (int s = 0 ; s < 8 ; ++s) {
+            Node child{node.yaw, {{node.offset[0] + ((s & 1) ? half : 0),
+                                   node.offset[1] + ((s & 2) ? half : 0),
+                                   node.offset[2] + ((s & 4) ? half : 0)}}, 0.0};
+            if (child.offset[0] > window_[0] || child.offset[1] > window_[1] || child.offset[2] > window_[2])
+                continue;
+            child.score = score(child, level - 1);
+            children.push_back(child);
+        }
+        std::sort(children.begin(), children.end(), [](const Node &a, const Node &b) { return a.score > b.score; });
+
+        for (const Node &child : children) {
+            if (child.score <= threshold_.load())
+                break;
+            branch(child, level - 1);
+        }
+    }
+
+    inline void accept(const Node &node)
+    {
+        std::unique_lock<std::mutex> l(candidates_mutex_);
+        if (node.score <= threshold_.load())
+            return;
+
+        const Eigen::Vector3d offset = Eigen::Vector3d(node.offset[0], node.offset[1], node.offset[2]) * resolution_;
+        Candidate c;
+        c.transform = w_T_m_ * transform_t(cslibs_math_3d::Vector3d(offset), cslibs_math_3d::Quaternion()) * m_T_w_ * rotated_[node.yaw];
+        c.score     = node.score;
+
+        candidates_.insert(std::upper_bound(candidates_.begin(), candidates_.end(), c,
+                                            [](const Candidate &a, const Candidate &b) { return a.score > b.score; }), c);
+        const std::size_t max_candidates = std::max<std::size_t>(1, param_.maxCandidates());
+        if (candidates_.size() > max_candidates)
+            candidates_.resize(max_candidates);
+        if (candidates_.size() == max_candidates)
+            threshold_ = std::max(param_.minScore(), candidates_.back().score);
+    }
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_RELOCALIZATION_HPP
@@ -0,0 +1,156 @@
+#ifndef CSLIBS_NDT_3D_RELOCALIZATION_PARAMS_HPP
+#define CSLIBS_NDT_3D_RELOCALIZATION_PARAMS_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+
+namespace cslibs_ndt_3d {
+namespace matching {
+/**
+ * @brief Search window and resolution of the branch and bound relocalization.
+ *        The translational window is centered on the initial transform, the
+ *        angular window on its yaw.
+ */
+class RelocalizationParameter
+{
+public:
+    /**
+     * @param linear_window_xy      - half extent of the search in x and y
+     * @param linear_window_z       - half extent of the search in z
+     * @param angular_window        - half extent of the yaw search
+     * @param resolution            - cell size of the score grids, 0 selects the bundle resolution of the map
+     * @param angular_resolution    - yaw step, 0 derives it from the farthest point
+     * @param depth                 - number of score grids, the coarsest one pools 2^(depth - 1) cells
+     * @param min_score             - minimum mean point score of a candidate
+     * @param max_candidates        - number of candidates which are refined by matching
+     */
+    inline explicit RelocalizationParameter(const double      linear_window_xy = 5.0,
+                                            const double      linear_window_z = 0.0,
+                                            const double      angular_window = M_PI,
+                                            const double      resolution = 0.0,
+                                            const double      angular_resolution = 0.0,
+                                            const std::size_t depth = 5,
+                                            const double      min_score = 0.1,
+                                            const std::size_t max_candidates = 4) :
+        linear_window_xy_(linear_window_xy),
+        linear_window_z_(linear_window_z),
+        angular_window_(angular_window),
+        resolution_(resolution),
+        angular_resolution_(angular_resolution),
+        depth_(depth),
+        min_score_(min_score),
+        max_candidates_(max_candidates),
+        kernel_(cslibs_ndt::common::Kernel::EXACT)
+    {
+    }
+
+    inline double linearWindowXY() const
+    {
+        return linear_window_xy_;
+    }
+
+    inline double & linearWindowXY()
+    {
+        return linear_window_xy_;
+    }
+
+    inline double linearWindowZ() const
+    {
+        return linear_window_z_;
+    }
+
+    inline double & linearWindowZ()
+    {
+        return linear_window_z_;
+    }
+
+    inline double angularWindow() const
+    {
+        return angular_window_;
+    }
+
+    inline double & angularWindow()
+    {
+        return angular_window_;
+    }
+
+    inline double resolution() const
+    {
+        return resolution_;
+    }
+
+    inline double & resolution()
+    {
+        return resolution_;
+    }
+
+    inline double angularResolution() const
+    {
+        return angular_resolution_;
+    }
+
+    inline double & angularResolution()
+    {
+        return angular_resolution_;
+    }
+
+    inline std::size_t depth() const
+    {
+        return depth_;
+    }
+
+    inline std::size_t & depth()
+    {
+        return depth_;
+    }
+
+    inline double minScore() const
+    {
+        return min_score_;
+    }
+
+    inline double & minScore()
+    {
+        return min_score_;
+    }
+
+    inline std::size_t maxCandidates() const
+    {
+        return max_candidates_;
+    }
+
+    inline std::size_t & maxCandidates()
+    {
+        return max_candidates_;
+    }
+
+    /**
+     * @brief Evaluation of the gaussians when the score grids are sampled from the map.
+     */
+    inline cslibs_ndt::common::Kernel kernel() const
+    {
+        return kernel_;
+    }
+
+    inline cslibs_ndt::common::Kernel & kernel()
+    {
+        return kernel_;
+    }
+
+protected:
+    double      linear_window_xy_;
+    double      linear_window_z_;
+    double      angular_window_;
+    double      resolution_;
+    double      angular_resolution_;
+    std::size_t depth_;
+    double      min_score_;
+    std::size_t max_candidates_;
+    cslibs_ndt::common::Kernel kernel_;
+};
+}
+}
+
+#endif // CSLIBS_NDT_3D_RELOCALIZATION_PARAMS_HPP
@@ -1,10 +1,12 @@
 #ifndef CSLIBS_NDT_3D_STATIC_MAPS_OCCUPANCY_GRIDMAP_HPP
 #define CSLIBS_NDT_3D_STATIC_MAPS_OCCUPANCY_GRIDMAP_HPP
 
+#include <cassert>
 #include <array>
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <unordered_set>
 
 #include <cslibs_math_2d/linear/pose.hpp>
 
@@ -13,6 +15,8 @@
 
 #include <cslibs_ndt/common/occupancy_distribution.hpp>
 #include <cslibs_ndt/common/bundle.hpp>
+#include <cslibs_ndt/common/gaussian_kernel.hpp>
+#include <cslibs_ndt/common/index_hash.hpp>
 
 #include <cslibs_math/common/array.hpp>
 #include <cslibs_math/common/div.hpp>
@@ -53,6 +57,7 @@ public:
     using distribution_const_bundle_t       = cslibs_ndt::Bundle<const distribution_t*, 8>;
     using distribution_bundle_storage_t     = cis::Storage<distribution_bundle_t, index_t, cis::backend::array::Array>;
     using distribution_bundle_storage_ptr_t = std::shared_ptr<distribution_bundle_storage_t>;
+    using dirty_bundle_set_t                = std::unordered_set<index_t, cslibs_ndt::common::IndexHash<3>>;
     using simple_iterator_t                 = cslibs_math_3d::algorithms::SimpleIterator;
     using inverse_sensor_model_t            = cslibs_gridmaps::utility::InverseModel;
 
@@ -427,7 +432,8 @@ public:
     }
 
     inline double sampleNonNormalized(const point_t &p,
-                                      const inverse_sensor_model_t::Ptr &ivm) const
+                                      const inverse_sensor_model_t::Ptr &ivm,
+                                      const cslibs_ndt::common::Kernel kernel = cslibs_ndt::common::Kernel::EXACT) const
     {
         index_t bi;
         if(!toBundleIndex(p, bi))
@@ -438,11 +444,11 @@ public:
 
         distribution_bundle_t *bundle = bundle_storage_->get(bi);
 
-        auto sample = [&p, &ivm] (const distribution_t *d) {
-            auto do_sample = [&p, &ivm, &d]() {
+        auto sample = [&p, &ivm, kernel] (const distribution_t *d) {
+            auto do_sample = [&p, &ivm, &d, kernel]() {
                 const auto &handle = d;
                 return handle->getDistribution() ?
-                            handle->getDistribution()->sampleNonNormalized(p) * handle->getOccupancy(ivm) : 0.0;
+                            cslibs_ndt::common::sampleNonNormalized(*handle->getDistribution(), p, kernel) * handle->getOccupancy(ivm) : 0.0;
             };
             return d ? do_sample() : 0.0;
         };
@@ -470,6 +476,58 @@ public:
         return valid(bi) ? getAllocate(bi) : nullptr;
     }
 
+    /**
+     * @brief Get the distributions of a bundle without allocating anything, thus
+     *        safe to call concurrently. Distributions shared with neighbouring bundles
+     *        are found even if the bundle itself was never allocated.
+     * @param bi     - the bundle index
+     * @param bundle - the distributions, nullptr where none exists
+     * @return if at least one distribution exists
+     */
+    inline bool lookupDistributionBundle(const index_t &bi,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        if(!valid(bi))
+            return false;
+
+        const distribution_bundle_t *b = bundle_storage_->get(bi);
+        if(b) {
+            std::copy(b->begin(), b->end(), bundle.begin());
+            return true;
+        }
+
+        bool found = false;
+        for(std::size_t i = 0 ; i < 8 ; ++i) {
+            bundle[i] = storage_[i]->get(toStorageIndex(bi, i));
+            found |= bundle[i] != nullptr;
+        }
+        return found;
+    }
+
+    inline bool lookupDistributionBundle(const point_t &p,
+                                         distribution_const_bundle_t::data_t &bundle) const
+    {
+        index_t bi;
+        if(!toBundleIndex(p, bi))
+            return false;
+        return lookupDistributionBundle(bi, bundle);
+    }
+
+    /**
+     * @brief Get the distribution of one layer at a point without allocating anything.
+     * @param p     - the point
+     * @param layer - the layer / storage index in [0, 8)
+     * @return the distribution or nullptr
+     */
+    inline const distribution_t* lookupDistribution(const point_t &p,
+                                                    const std::size_t layer) const
+    {
+        index_t bi;
+        if(!toBundleIndex(p, bi))
+            return nullptr;
+        return storage_[layer]->get(toStorageIndex(bi, layer));
+    }
+
     inline const distribution_bundle_t* getDistributionBundle(const point_t &p) const
     {
         index_t bi;
@@ -594,6 +652,43 @@ public:
         }
     }
 
+    /**
+     * @brief Record the bundles whose distributions change from now on, e.g. to update
+     *        a conversion of the map incrementally. Tracking is off by default and copies
+     *        of the map start without it. Changes made through getDistributionBundle are
+     *        not recorded.
+     *
+     *        The record has a single consumer, since taking it clears it. Registering
+     *        another consumer drops the record, the previous one then no longer tracks
+     *        the map and has to start over instead of missing changes.
+     * @param consumer - the consumer of the record, nullptr disables tracking
+     */
+    inline void trackDirtyBundles(const void *consumer)
+    {
+        dirty_bundles_consumer_ = consumer;
+        dirty_bundles_.clear();
+    }
+
+    inline bool tracksDirtyBundles(const void *consumer) const
+    {
+        return consumer && dirty_bundles_consumer_ == consumer;
+    }
+
+    /**
+     * @brief Take the bundles changed since the last call and clear the record. The
+     *        changed distributions are shared with the neighbouring bundles, which
+     *        thus change as well.
+     * @param consumer - the consumer which registered the record
+     * @param bundles  - the changed bundle indices, in no particular order
+     */
+    inline void takeDirtyBundles(const void *consumer,
+                                 std::vector<index_t> &bundles)
+    {
+        assert(tracksDirtyBundles(consumer));
+        bundles.assign(dirty_bundles_.begin(), dirty_bundles_.end());
+        dirty_bundles_.clear();
+    }
+
 protected:
     const double                                    resolution_;
     const double                                    bundle_resolution_;
@@ -607,6 +702,8 @@ protected:
 
     mutable distribution_storage_array_t            storage_;
     mutable distribution_bundle_storage_ptr_t       bundle_storage_;
+    const void                                     *dirty_bundles_consumer_ = nullptr;
+    mutable dirty_bundle_set_t                      dirty_bundles_;
 
     inline distribution_t* getAllocate(const distribution_storage_ptr_t &s,
                                        const index_t &i) const
@@ -654,12 +751,19 @@ protected:
         return get_allocate(bi);
     }
 
+    inline void markDirty(const index_t &bi) const
+    {
+        if (dirty_bundles_consumer_)
+            dirty_bundles_.insert(bi);
+    }
+
     inline void updateFree(const index_t &bi) const
     {
         if(!valid(bi))
             return;
 
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateFree();
         bundle->at(1)->updateFree();
         bundle->at(2)->updateFree();
@@ -677,6 +781,7 @@ protected:
             return;
 
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateFree(n);
         bundle->at(1)->updateFree(n);
         bundle->at(2)->updateFree(n);
@@ -694,6 +799,7 @@ protected:
             return;
 
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateOccupied(p);
         bundle->at(1)->updateOccupied(p);
         bundle->at(2)->updateOccupied(p);
@@ -708,6 +814,7 @@ protected:
                                const distribution_t::distribution_ptr_t &d) const
     {
         distribution_bundle_t *bundle = getAllocate(bi);
+        markDirty(bi);
         bundle->at(0)->updateOccupied(d);
         bundle->at(1)->updateOccupied(d);
         bundle->at(2)->updateOccupied(d);
@@ -718,6 +825,20 @@ protected:
         bundle->at(7)->updateOccupied(d);
     }
 
+    inline index_t toStorageIndex(const index_t &bi,
+                                  const std::size_t layer) const
+    {
+        const int divx = cslibs_math::common::div<int>(bi[0], 2);
+        const int divy = cslibs_math::common::div<int>(bi[1], 2);
+        const int divz = cslibs_math::common::div<int>(bi[2], 2);
+        const int modx = cslibs_math::common::mod<int>(bi[0], 2);
+        const int mody = cslibs_math::common::mod<int>(bi[1], 2);
+        const int modz = cslibs_math::common::mod<int>(bi[2], 2);
+        return {{divx + ((layer & 1ul) ? modx : 0),
+                 divy + ((layer & 2ul) ? mody : 0),
+                 divz + ((layer & 4ul) ? modz : 0)}};
+    }
+
     inline index_t toBundleIndex(const point_t &p_w) const
     {
         const point_t p_m = m_T_w_ * p_w;
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/matching/match_dynamic.hpp>
+
+#include <random>
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math_3d::Pointcloud3d;
+using pose_t       = cslibs_math_3d::Transform3d;
+using map_t        = cslibs_ndt_3d::dynamic_maps::Gridmap;
+using gicp_t       = cslibs_ndt_3d::matching::GICP<map_t>;
+
+/// three orthogonal noisy planes, a corner constrains all six degrees of freedom
+pointcloud_t::Ptr generateCloud()
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0.0, 0.01);
+
+    pointcloud_t::Ptr cloud(new pointcloud_t);
+    for (int i = 0 ; i < 40 ; ++i) {
+        for (int j = 0 ; j < 40 ; ++j) {
+            cloud->insert(point_t(0.1 * i, 0.1 * j, noise(rng)));
+            cloud->insert(point_t(0.1 * i, noise(rng), 0.1 * j));
+            cloud->insert(point_t(noise(rng), 0.1 * i, 0.1 * j));
+        }
+    }
+    return cloud;
+}
+
+pointcloud_t::Ptr transformCloud(const pointcloud_t::Ptr &cloud,
+                                 const pose_t &transform)
+{
+    pointcloud_t::Ptr transformed(new pointcloud_t);
+    for (const point_t &p : *cloud)
+        transformed->insert(transform * p);
+    return transformed;
+}
+
+TEST(Test_cslibs_ndt_3d, testGICP)
+{
+    const pointcloud_t::Ptr dst = generateCloud();
+    const pose_t transform(0.15, -0.1, 0.05, 0.02, -0.01, 0.04);
+    const pointcloud_t::Ptr src = transformCloud(dst, transform.inverse());
+
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    map->insert(pointcloud_t::ConstPtr(dst));
+
+    gicp_t gicp;
+    gicp.setTarget(map);
+
+    /// the transform of the source into the target is recovered up to the bias of the
+    /// voxels at the edges, which mix points of two or three planes
+    cslibs_ndt_3d::matching::ParametersWithICP params;
+    cslibs_ndt_3d::matching::ResultWithICP result;
+    gicp.apply(src, params, pose_t(), result);
+    EXPECT_EQ(result.icpTermination(), cslibs_ndt_3d::matching::ICPTermination::DELTA_EPS);
+    EXPECT_GT(result.icpIterations(), 1u);
+    EXPECT_NEAR(result.ICPTransform().tx(),    transform.tx(),    0.03);
+    EXPECT_NEAR(result.ICPTransform().ty(),    transform.ty(),    0.03);
+    EXPECT_NEAR(result.ICPTransform().tz(),    transform.tz(),    0.03);
+    EXPECT_NEAR(result.ICPTransform().roll(),  transform.roll(),  0.005);
+    EXPECT_NEAR(result.ICPTransform().pitch(), transform.pitch(), 0.005);
+    EXPECT_NEAR(result.ICPTransform().yaw(),   transform.yaw(),   0.005);
+
+    /// starting at the solution it stays there
+    gicp.apply(src, params, transform, result);
+    EXPECT_EQ(result.icpTermination(), cslibs_ndt_3d::matching::ICPTermination::DELTA_EPS);
+    EXPECT_NEAR(result.ICPTransform().tx(), transform.tx(), 0.03);
+
+    /// without correspondences the initial transform is kept
+    params.maxDistanceICP() = 1e-6;
+    gicp.apply(src, params, pose_t(), result);
+    EXPECT_EQ(result.icpTermination(), cslibs_ndt_3d::matching::ICPTermination::ASSIGNMENT_SUCCESS);
+    EXPECT_EQ(result.ICPTransform().tx(), 0.0);
+
+    /// and without a target nothing is done
+    gicp.setTarget(map_t::Ptr());
+    gicp.apply(src, params, pose_t(), result);
+    EXPECT_EQ(result.icpTermination(), cslibs_ndt_3d::matching::ICPTermination::NONE);
+    EXPECT_EQ(result.icpIterations(), 0u);
+}
+
+TEST(Test_cslibs_ndt_3d, testGICPPreAlignment)
+{
+    const pointcloud_t::Ptr dst = generateCloud();
+    const pose_t transform(0.3, -0.2, 0.1, 0.0, 0.0, 0.08);
+    const pointcloud_t::Ptr src = transformCloud(dst, transform.inverse());
+
+    cslibs_ndt_3d::matching::ParametersWithICP params;
+    params.preAlignment() = cslibs_ndt_3d::matching::PreAlignment::GICP;
+    params.lineSearch()   = cslibs_ndt::matching::LineSearch::MORE_THUENTE;
+
+    /// the NDT refinement starts at the pre-alignment
+    cslibs_ndt_3d::matching::ResultWithICP result;
+    cslibs_ndt_3d::matching::dynamic_maps::match(src, dst, params, 1.0, pose_t(), result);
+    EXPECT_EQ(result.icpTermination(), cslibs_ndt_3d::matching::ICPTermination::DELTA_EPS);
+    EXPECT_NEAR(result.ICPTransform().tx(), transform.tx(), 0.03);
+    EXPECT_NEAR(result.transform().tx(),  transform.tx(),  0.01);
+    EXPECT_NEAR(result.transform().ty(),  transform.ty(),  0.01);
+    EXPECT_NEAR(result.transform().tz(),  transform.tz(),  0.01);
+    EXPECT_NEAR(result.transform().yaw(), transform.yaw(), 0.005);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt/matching/match_async.hpp>
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+#include <chrono>
+#include <random>
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math_3d::Pointcloud3d;
+using pose_t       = cslibs_math_3d::Transform3d;
+using map_t        = cslibs_ndt_3d::dynamic_maps::Gridmap;
+using pool_t       = cslibs_ndt::common::ThreadPool;
+
+/**
+ * @brief Start a match which does not terminate on its own on the given pool, check that
+ *        matchAsync returns before it is done and that cancelling ends it.
+ */
+void testCancel(const pool_t::Ptr &pool)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(0.0, 10.0);
+
+    pointcloud_t::Ptr cloud(new pointcloud_t);
+    for (std::size_t i = 0 ; i < 20000 ; ++i)
+        cloud->insert(point_t(uniform(rng), uniform(rng), uniform(rng)));
+
+    map_t map(pose_t(), 1.0);
+    for (const point_t &p : *cloud)
+        map.insert(p);
+
+    /// never converges, never gives up
+    cslibs_ndt::matching::Parameter param(std::numeric_limits<std::size_t>::max(), -1.0, -1.0,
+                                          std::numeric_limits<std::size_t>::max(), 1.1);
+
+    const cslibs_ndt::matching::CancellationToken::Ptr token = cslibs_ndt::matching::CancellationToken::create();
+    auto result = cslibs_ndt::matching::matchAsync(pointcloud_t::ConstPtr(cloud), map, param,
+                                                   pose_t(0.1, 0.0, 0.0), token, pool);
+    EXPECT_EQ(result.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+
+    token->cancel();
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(result.get().termination(), cslibs_ndt::matching::Termination::DEADLINE);
+}
+
+TEST(Test_cslibs_ndt_3d, testMatchAsyncSerial)
+{
+    testCancel(pool_t::Ptr(new pool_t(1, cslibs_ndt::common::Backend::SERIAL)));
+}
+
+TEST(Test_cslibs_ndt_3d, testMatchAsyncThreads)
+{
+    testCancel(pool_t::Ptr(new pool_t(2, cslibs_ndt::common::Backend::THREADS)));
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
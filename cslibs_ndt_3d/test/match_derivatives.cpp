@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/matching/gridmap_match_traits.hpp>
+#include <cslibs_ndt_3d/matching/occupancy_gridmap_match_traits.hpp>
+#include <cslibs_ndt_3d/matching/match_dynamic.hpp>
+
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+#include <cmath>
+#include <random>
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math_3d::Pointcloud3d;
+using pose_t       = cslibs_math_3d::Transform3d;
+using vector_t     = Eigen::Matrix<double, 6, 1>;
+
+const double EPSILON = 1e-6;
+
+/// three orthogonal noisy planes, every bundle holds well conditioned distributions
+pointcloud_t::Ptr generateCloud()
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0.0, 0.02);
+
+    pointcloud_t::Ptr cloud(new pointcloud_t);
+    for (int i = 0 ; i < 40 ; ++i) {
+        for (int j = 0 ; j < 40 ; ++j) {
+            cloud->insert(point_t(0.1 * i, 0.1 * j, noise(rng)));
+            cloud->insert(point_t(0.1 * i, noise(rng), 0.1 * j));
+            cloud->insert(point_t(noise(rng), 0.1 * i, 0.1 * j));
+        }
+    }
+    return cloud;
+}
+
+/**
+ * @brief Compare gradient and hessian of the traits to central differences of the score,
+ *        g is the negative gradient of the score, h its hessian.
+ */
+template <typename map_t, typename parameter_t>
+void testDerivatives(const map_t &map,
+                     const parameter_t &param,
+                     const pointcloud_t::Ptr &cloud)
+{
+    using traits_t = cslibs_ndt::matching::MatchTraits<map_t>;
+
+    auto evaluate = [&map, &param, &cloud](const vector_t &x,
+                                           double &score,
+                                           typename traits_t::gradient_t &g,
+                                           typename traits_t::hessian_t &h) {
+        score = 0.0;
+        g.setZero();
+        h.setZero();
+
+        const Eigen::Vector3d linear  = x.head<3>();
+        const Eigen::Vector3d angular = x.tail<3>();
+        const pose_t t = traits_t::makeTransform(linear, angular);
+
+        typename traits_t::Jacobian J;
+        traits_t::Jacobian::get(angular, J);
+        typename traits_t::Hessian H;
+        traits_t::Hessian::get(angular, H);
+
+        for (std::size_t k = 0 ; k < 300 ; ++k) {
+            const point_t &point_prime = *(cloud->begin() + (k * 13) % cloud->size());
+            traits_t::computeGradient(map, t * point_prime, point_prime, J, H, param, score, g, h);
+        }
+    };
+
+    vector_t x;
+    x << 0.05, -0.03, 0.02, 0.01, -0.02, 0.03;
+
+    double score;
+    typename traits_t::gradient_t g;
+    typename traits_t::hessian_t  h;
+    evaluate(x, score, g, h);
+    EXPECT_GT(score, 0.0);
+    EXPECT_GT(g.norm(), 1e-3);
+
+    for (std::size_t i = 0 ; i < 6 ; ++i) {
+        vector_t x_p = x;
+        vector_t x_m = x;
+        x_p(i) += EPSILON;
+        x_m(i) -= EPSILON;
+
+        double score_p, score_m;
+        typename traits_t::gradient_t g_p, g_m;
+        typename traits_t::hessian_t  h_p, h_m;
+        evaluate(x_p, score_p, g_p, h_p);
+        evaluate(x_m, score_m, g_m, h_m);
+
+        EXPECT_NEAR(-(score_p - score_m) / (2.0 * EPSILON), g(i), 1e-3 * (1.0 + g.norm()));
+        for (std::size_t j = 0 ; j < 6 ; ++j)
+            EXPECT_NEAR((g_m(j) - g_p(j)) / (2.0 * EPSILON), h(j, i), 1e-3 * (1.0 + h.norm()));
+    }
+}
+
+TEST(Test_cslibs_ndt_3d, testGridmapDerivatives)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+
+    const pointcloud_t::Ptr cloud = generateCloud();
+    map_t map(pose_t(), 1.0);
+    for (const point_t &p : *cloud)
+        map.insert(p);
+
+    testDerivatives(map, cslibs_ndt::matching::Parameter(), cloud);
+}
+
+TEST(Test_cslibs_ndt_3d, testOccupancyGridmapDerivatives)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+
+    const pointcloud_t::Ptr cloud = generateCloud();
+    map_t map(pose_t(), 1.0);
+    map.insert(cloud->begin(), cloud->end(), pose_t(0.0, 0.0, 1.5));
+
+    const cslibs_gridmaps::utility::InverseModel ivm(0.5, 0.45, 0.65);
+    testDerivatives(map, cslibs_ndt::matching::OccupancyParameter(cslibs_ndt::matching::Parameter(), ivm), cloud);
+}
+
+template <typename map_t>
+double score(const map_t &map,
+             const cslibs_ndt::matching::Parameter &param,
+             const pointcloud_t::Ptr &cloud,
+             const pose_t &t)
+{
+    using traits_t = cslibs_ndt::matching::MatchTraits<map_t>;
+
+    typename traits_t::Jacobian J;
+    traits_t::Jacobian::get(Eigen::Vector3d::Zero(), J);
+    typename traits_t::Hessian H;
+    traits_t::Hessian::get(Eigen::Vector3d::Zero(), H);
+
+    double s = 0.0;
+    typename traits_t::gradient_t g = traits_t::gradient_t::Zero();
+    typename traits_t::hessian_t  h = traits_t::hessian_t::Zero();
+    for (const point_t &p : *cloud)
+        traits_t::computeGradient(map, t * p, p, J, H, param, s, g, h);
+    return s;
+}
+
+TEST(Test_cslibs_ndt_3d, testLineSearchResult)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+
+    const pointcloud_t::Ptr cloud = generateCloud();
+    map_t map(pose_t(), 1.0);
+    for (const point_t &p : *cloud)
+        map.insert(p);
+
+    cslibs_ndt::matching::Parameter param;
+    param.lineSearch()    = cslibs_ndt::matching::LineSearch::MORE_THUENTE;
+    param.maxIterations() = 100;
+
+    /// the result has to be the best parameters found, together with their score
+    const pose_t initial(0.2, -0.15, 0.1, 0.0, 0.0, 0.05);
+    const auto result = cslibs_ndt::matching::match(cloud->begin(), cloud->end(), map, param, initial);
+    EXPECT_NE(result.termination(), cslibs_ndt::matching::Termination::NONE);
+    EXPECT_NEAR(result.score(), score(map, param, cloud, result.transform()), 1e-6 * result.score());
+    EXPECT_GE(result.score(), score(map, param, cloud, initial));
+}
+
+TEST(Test_cslibs_ndt_3d, testDampedSolverResult)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+
+    const pointcloud_t::Ptr cloud = generateCloud();
+    map_t map(pose_t(), 1.0);
+    for (const point_t &p : *cloud)
+        map.insert(p);
+
+    cslibs_ndt::matching::Parameter param;
+    param.solver()        = cslibs_ndt::matching::Solver::DAMPED_LDLT;
+    param.maxIterations() = 100;
+
+    /// every damped step is an ascent step, so even far from the optimum the match has to improve
+    const pose_t initial(0.2, -0.15, 0.1, 0.0, 0.0, 0.05);
+    const auto result = cslibs_ndt::matching::match(cloud->begin(), cloud->end(), map, param, initial);
+    EXPECT_NE(result.termination(), cslibs_ndt::matching::Termination::NONE);
+    EXPECT_GT(score(map, param, cloud, result.transform()), score(map, param, cloud, initial));
+    EXPECT_LT(std::hypot(result.transform().tx(), result.transform().ty()), 0.05);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/matching/match_multi_resolution.hpp>
+
+#include <random>
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math_3d::Pointcloud3d;
+using pose_t       = cslibs_math_3d::Transform3d;
+using map_t        = cslibs_ndt_3d::dynamic_maps::Gridmap;
+
+/// three orthogonal noisy planes
+pointcloud_t::Ptr generateCloud()
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0.0, 0.02);
+
+    pointcloud_t::Ptr cloud(new pointcloud_t);
+    for (int i = 0 ; i < 40 ; ++i) {
+        for (int j = 0 ; j < 40 ; ++j) {
+            cloud->insert(point_t(0.1 * i, 0.1 * j, noise(rng)));
+            cloud->insert(point_t(0.1 * i, noise(rng), 0.1 * j));
+            cloud->insert(point_t(noise(rng), 0.1 * i, 0.1 * j));
+        }
+    }
+    return cloud;
+}
+
+TEST(Test_cslibs_ndt_3d, testCreatePyramid)
+{
+    const pointcloud_t::Ptr cloud = generateCloud();
+    const std::vector<double> resolutions = {2.0, 1.0, 0.5};
+
+    /// every level has to equal a map built point by point
+    const auto maps = cslibs_ndt_3d::matching::dynamic_maps::createPyramid(cloud->begin(), cloud->end(), resolutions);
+    ASSERT_EQ(maps.size(), resolutions.size());
+    for (std::size_t l = 0 ; l < resolutions.size() ; ++l) {
+        map_t reference(pose_t(), resolutions[l]);
+        for (const point_t &p : *cloud)
+            reference.insert(p);
+
+        std::size_t bundles = 0;
+        maps[l]->traverse([&reference, &bundles](const map_t::index_t &bi, const map_t::distribution_bundle_t &b) {
+            const map_t::distribution_bundle_t *r = reference.getDistributionBundle(bi);
+            ASSERT_NE(r, nullptr);
+            for (std::size_t i = 0 ; i < 8 ; ++i) {
+                ASSERT_EQ(b.at(i)->data().getN(), r->at(i)->data().getN());
+                if (r->at(i)->data().getN() > 0) {
+                    EXPECT_LT((b.at(i)->data().getMean() - r->at(i)->data().getMean()).norm(), 1e-9);
+                }
+            }
+            ++bundles;
+        });
+        std::size_t reference_bundles = 0;
+        reference.traverse([&reference_bundles](const map_t::index_t &, const map_t::distribution_bundle_t &) {
+            ++reference_bundles;
+        });
+        EXPECT_EQ(bundles, reference_bundles);
+    }
+}
+
+TEST(Test_cslibs_ndt_3d, testMatchMultiResolution)
+{
+    const pointcloud_t::Ptr dst = generateCloud();
+    const pose_t transform(0.3, -0.2, 0.1, 0.0, 0.0, 0.05);
+
+    pointcloud_t::Ptr src(new pointcloud_t);
+    const pose_t inverse = transform.inverse();
+    for (const point_t &p : *dst)
+        src->insert(inverse * p);
+
+    cslibs_ndt::matching::Parameter param;
+    param.lineSearch() = cslibs_ndt::matching::LineSearch::MORE_THUENTE;
+
+    /// levels are sorted coarse to fine
+    const cslibs_ndt::matching::MultiResolutionParameter params({0.5, 2.0, 1.0}, {50, 50, 50}, param);
+    ASSERT_EQ(params.size(), 3u);
+    EXPECT_EQ(params.levels().front().resolution(), 2.0);
+    EXPECT_EQ(params.levels().back().resolution(),  0.5);
+
+    cslibs_ndt::matching::Result<pose_t> result;
+    cslibs_ndt_3d::matching::dynamic_maps::match(src, dst, params, pose_t(), result);
+    EXPECT_NE(result.termination(), cslibs_ndt::matching::Termination::NONE);
+    EXPECT_GE(result.iterations(), 3u);
+    EXPECT_NEAR(result.transform().tx(),  transform.tx(),  0.02);
+    EXPECT_NEAR(result.transform().ty(),  transform.ty(),  0.02);
+    EXPECT_NEAR(result.transform().tz(),  transform.tz(),  0.02);
+    EXPECT_NEAR(result.transform().yaw(), transform.yaw(), 0.01);
+
+    /// without levels nothing is matched
+    cslibs_ndt_3d::matching::dynamic_maps::match(src, dst, cslibs_ndt::matching::MultiResolutionParameter(),
+                                                 transform, result);
+    EXPECT_EQ(result.termination(), cslibs_ndt::matching::Termination::NONE);
+    EXPECT_EQ(result.iterations(), 0u);
+    EXPECT_EQ(result.transform().tx(), transform.tx());
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/matching/odometry_pipeline.hpp>
+
+#include <random>
+#include <thread>
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math_3d::Pointcloud3d;
+using pose_t       = cslibs_math_3d::Transform3d;
+using map_t        = cslibs_ndt_3d::dynamic_maps::Gridmap;
+using pipeline_t   = cslibs_ndt_3d::matching::OdometryPipeline<map_t>;
+
+const std::size_t NUM_SCANS = 8;
+const double      STEP      = 0.1;
+
+/// a closed box room, seen from the given pose
+pointcloud_t::Ptr generateScan(const pose_t &pose,
+                               std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::normal_distribution<double>       noise(0.0, 0.01);
+
+    const pose_t s_T_w = pose.inverse();
+    pointcloud_t::Ptr scan(new pointcloud_t);
+    for (std::size_t i = 0 ; i < 2000 ; ++i) {
+        const double a = 8.0 * u(rng) - 4.0;
+        const double b = 8.0 * u(rng) - 4.0;
+        const double h = 3.0 * u(rng);
+        scan->insert(s_T_w * point_t(a, b, noise(rng)));
+        scan->insert(s_T_w * point_t(a, 4.0 + noise(rng), h));
+        scan->insert(s_T_w * point_t(a, -4.0 + noise(rng), h));
+        scan->insert(s_T_w * point_t(4.0 + noise(rng), b, h));
+        scan->insert(s_T_w * point_t(-4.0 + noise(rng), b, h));
+    }
+    return scan;
+}
+
+TEST(Test_cslibs_ndt_3d, testOdometryPipeline)
+{
+    std::mt19937 rng(1);
+    std::vector<pointcloud_t::Ptr> scans;
+    for (std::size_t i = 0 ; i < NUM_SCANS ; ++i)
+        scans.emplace_back(generateScan(pose_t(STEP * i, 0.0, 0.5), rng));
+
+    cslibs_ndt::matching::Parameter param;
+    cslibs_ndt::matching::OdometryParameter odometry;
+    odometry.queueCapacity()  = 2;
+    odometry.insertEvery()    = 1;
+    odometry.minTranslation() = 0.0;
+    odometry.minRotation()    = 0.0;
+
+    pipeline_t pipeline(pose_t(), 1.0, param, odometry, pose_t(0.0, 0.0, 0.5));
+
+    /// the queues are shorter than the input, pushing blocks until the stages take over
+    std::vector<pipeline_t::Output, Eigen::aligned_allocator<pipeline_t::Output>> outputs;
+    std::thread consumer([&pipeline, &outputs]() {
+        pipeline_t::Output output;
+        while (pipeline.pop(output))
+            outputs.emplace_back(output);
+    });
+    for (const pointcloud_t::Ptr &scan : scans)
+        EXPECT_TRUE(pipeline.push(scan, pose_t(STEP, 0.0, 0.0)));
+    pipeline.close();
+    consumer.join();
+
+    EXPECT_FALSE(pipeline.push(scans.front()));
+
+    /// results in input order, inserting every scan as the only enabled policy
+    ASSERT_EQ(outputs.size(), NUM_SCANS);
+    map_t reference(pose_t(), 1.0);
+    for (std::size_t i = 0 ; i < NUM_SCANS ; ++i) {
+        const pipeline_t::Output &o = outputs[i];
+        EXPECT_EQ(o.id, i);
+        EXPECT_TRUE(o.inserted);
+        EXPECT_NEAR(o.result.transform().tx(), STEP * i, 0.05);
+        EXPECT_NEAR(o.result.transform().ty(), 0.0,      0.05);
+        EXPECT_NEAR(o.result.transform().tz(), 0.5,      0.05);
+        reference.insert(pointcloud_t::ConstPtr(scans[i]), o.result.transform());
+    }
+
+    /// after closing the published map holds every inserted scan exactly once, in order
+    const map_t &map = pipeline.getMap();
+    std::size_t bundles = 0;
+    map.traverse([&reference, &bundles](const map_t::index_t &bi, const map_t::distribution_bundle_t &b) {
+        const map_t::distribution_bundle_t *r = reference.getDistributionBundle(bi);
+        ASSERT_NE(r, nullptr);
+        for (std::size_t i = 0 ; i < 8 ; ++i)
+            EXPECT_EQ(b.at(i)->data().getN(), r->at(i)->data().getN());
+        ++bundles;
+    });
+    std::size_t reference_bundles = 0;
+    reference.traverse([&reference_bundles](const map_t::index_t &, const map_t::distribution_bundle_t &) {
+        ++reference_bundles;
+    });
+    EXPECT_EQ(bundles, reference_bundles);
+}
+
+TEST(Test_cslibs_ndt_3d, testOdometryPipelineShutdown)
+{
+    std::mt19937 rng(2);
+    const pointcloud_t::Ptr scan = generateScan(pose_t(0.0, 0.0, 0.5), rng);
+
+    cslibs_ndt::matching::Parameter param;
+    cslibs_ndt::matching::OdometryParameter odometry;
+    odometry.queueCapacity() = 1;
+
+    /// destroying a pipeline with pending scans and untaken results must not block
+    for (std::size_t pending = 0 ; pending < 4 ; ++pending) {
+        pipeline_t pipeline(pose_t(), 1.0, param, odometry);
+        for (std::size_t i = 0 ; i < pending ; ++i)
+            EXPECT_TRUE(pipeline.push(scan));
+    }
+
+    /// results can be taken after closing, then pop reports the end
+    pipeline_t pipeline(pose_t(), 1.0, param, odometry);
+    EXPECT_TRUE(pipeline.push(scan));
+    EXPECT_TRUE(pipeline.push(scan));
+    pipeline.close();
+
+    pipeline_t::Output output;
+    EXPECT_TRUE(pipeline.pop(output));
+    EXPECT_EQ(output.id, 0u);
+    EXPECT_TRUE(pipeline.pop(output));
+    EXPECT_EQ(output.id, 1u);
+    EXPECT_FALSE(pipeline.pop(output));
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
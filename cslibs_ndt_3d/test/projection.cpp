@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/conversion/probability_gridmap.hpp>
+
+#include <cmath>
+#include <random>
+
+using point_t       = cslibs_math_3d::Point3d;
+using pose_t        = cslibs_math_3d::Transform3d;
+using map_t         = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+using projection_t  = cslibs_ndt_3d::conversion::Projection<map_t>;
+using gridmap_t     = cslibs_gridmaps::static_maps::ProbabilityGridmap;
+
+const double Z_MIN = 0.0;
+const double Z_MAX = 1.0;
+
+namespace {
+/// a wall of points in [x0, x1) x [y0, y1) x [z0, z1), seen from the sensor
+void insert(map_t &map,
+            const pose_t &sensor,
+            const double x0, const double x1,
+            const double y0, const double y1,
+            const double z0, const double z1,
+            std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> x(x0, x1);
+    std::uniform_real_distribution<double> y(y0, y1);
+    std::uniform_real_distribution<double> z(z0, z1);
+
+    const pose_t s_T_w = sensor.inverse();
+    std::vector<point_t> points;
+    for (std::size_t i = 0 ; i < 500 ; ++i)
+        points.emplace_back(s_T_w * point_t(x(rng), y(rng), z(rng)));
+    map.insert(points.begin(), points.end(), sensor);
+}
+
+/// the output cell at a point of the map plane, 0 outside of the output
+double at(const gridmap_t::Ptr &gridmap,
+          const double x,
+          const double y)
+{
+    const double resolution = gridmap->getResolution();
+    const long cx = static_cast<long>(std::floor((x - gridmap->getOrigin().tx()) / resolution));
+    const long cy = static_cast<long>(std::floor((y - gridmap->getOrigin().ty()) / resolution));
+    if (cx < 0 || cy < 0 ||
+            cx >= static_cast<long>(gridmap->getWidth()) || cy >= static_cast<long>(gridmap->getHeight()))
+        return 0.0;
+    return gridmap->at(static_cast<std::size_t>(cx), static_cast<std::size_t>(cy));
+}
+
+void compare(const gridmap_t::Ptr &incremental,
+             const gridmap_t::Ptr &reference)
+{
+    ASSERT_TRUE(incremental);
+    ASSERT_TRUE(reference);
+    const double resolution = reference->getResolution();
+    for (std::size_t y = 0 ; y < reference->getHeight() ; ++y) {
+        for (std::size_t x = 0 ; x < reference->getWidth() ; ++x) {
+            EXPECT_EQ(at(incremental, reference->getOrigin().tx() + (x + 0.5) * resolution,
+                                      reference->getOrigin().ty() + (y + 0.5) * resolution),
+                      reference->at(x, y));
+        }
+    }
+}
+}
+
+TEST(Test_cslibs_ndt_3d, testProjectionHeightBand)
+{
+    const cslibs_gridmaps::utility::InverseModel::Ptr inverse_model(
+                new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    std::mt19937 rng(1);
+
+    /// a wall within the band and one above it, the rays to the upper one leave the band
+    /// close to the sensor
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    insert(*map, pose_t(0.0, 0.0, 0.5), 2.0, 3.0, -1.0, 1.0, 0.2, 0.8, rng);
+    insert(*map, pose_t(0.0, 0.0, 0.5), -3.0, -2.0, -1.0, 1.0, 3.2, 3.8, rng);
+
+    gridmap_t::Ptr band;
+    cslibs_ndt_3d::conversion::from(map, band, inverse_model, Z_MIN, Z_MAX);
+    ASSERT_TRUE(band);
+    EXPECT_GT(at(band,  2.5, 0.0), 0.5);
+    EXPECT_EQ(at(band, -2.5, 0.0), 0.0);
+
+    gridmap_t::Ptr above;
+    cslibs_ndt_3d::conversion::from(map, above, inverse_model, 3.0, 4.0);
+    ASSERT_TRUE(above);
+    EXPECT_GT(at(above, -2.5, 0.0), 0.5);
+}
+
+TEST(Test_cslibs_ndt_3d, testProjectionZNeighbours)
+{
+    const cslibs_gridmaps::utility::InverseModel::Ptr inverse_model(
+                new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    std::mt19937 rng(2);
+
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    insert(*map, pose_t(0.0, 0.0, 0.5), 2.0, 3.0, -2.0, 2.0, 0.2, 0.8, rng);
+    projection_t projection(inverse_model, Z_MIN, Z_MAX);
+    EXPECT_TRUE(projection.update(*map).reallocated);
+
+    /// changes in the bundles right above the band share distributions with the band
+    insert(*map, pose_t(0.0, 0.0, 1.25), 1.0, 1.5, -2.0, 2.0, 1.05, 1.45, rng);
+    EXPECT_FALSE(projection.update(*map).empty());
+
+    projection_t reference(inverse_model, Z_MIN, Z_MAX);
+    reference.compute(*map);
+    compare(projection.getGridmap(), reference.getGridmap());
+    EXPECT_GT(at(projection.getGridmap(), 1.25, 0.0), 0.0);
+
+    /// changes farther away do not touch the band
+    insert(*map, pose_t(0.0, 0.0, 3.25), -3.0, 3.0, -3.0, 3.0, 3.05, 3.45, rng);
+    EXPECT_TRUE(projection.update(*map).empty());
+    compare(projection.getGridmap(), reference.getGridmap());
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
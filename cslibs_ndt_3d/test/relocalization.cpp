@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/matching/relocalization.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+
+#include <random>
+
+using point_t          = cslibs_math_3d::Point3d;
+using pointcloud_t     = cslibs_math_3d::Pointcloud3d;
+using pose_t           = cslibs_math_3d::Transform3d;
+using map_t            = cslibs_ndt_3d::dynamic_maps::Gridmap;
+using relocalization_t = cslibs_ndt_3d::matching::Relocalization<map_t>;
+
+/// three orthogonal noisy planes
+pointcloud_t::Ptr generateCloud()
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0.0, 0.02);
+
+    pointcloud_t::Ptr cloud(new pointcloud_t);
+    for (int i = 0 ; i < 40 ; ++i) {
+        for (int j = 0 ; j < 40 ; ++j) {
+            cloud->insert(point_t(0.1 * i, 0.1 * j, noise(rng)));
+            cloud->insert(point_t(0.1 * i, noise(rng), 0.1 * j));
+            cloud->insert(point_t(noise(rng), 0.1 * i, 0.1 * j));
+        }
+    }
+    return cloud;
+}
+
+/// a small window, so that a single level visits every candidate
+cslibs_ndt_3d::matching::RelocalizationParameter parameter(const std::size_t depth)
+{
+    return cslibs_ndt_3d::matching::RelocalizationParameter(1.0, 0.5, 0.3, 0.25, 0.1, depth, 0.0, 5);
+}
+
+TEST(Test_cslibs_ndt_3d, testRelocalizationBruteForce)
+{
+    const pointcloud_t::Ptr dst = generateCloud();
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    map->insert(pointcloud_t::ConstPtr(dst));
+
+    const pose_t transform(0.5, -0.25, 0.0, 0.0, 0.0, 0.1);
+    pointcloud_t::Ptr src(new pointcloud_t);
+    const pose_t inverse = transform.inverse();
+    for (const point_t &p : *dst)
+        src->insert(inverse * p);
+
+    cslibs_ndt::matching::Parameter match_param;
+    match_param.lineSearch() = cslibs_ndt::matching::LineSearch::MORE_THUENTE;
+
+    /// without pooling every candidate is scored, branch and bound has to find the same best ones
+    relocalization_t brute_force(map, parameter(1));
+    brute_force.relocalize(src, pose_t(), match_param);
+    const relocalization_t::candidate_array_t &expected = brute_force.getCandidates();
+    ASSERT_EQ(expected.size(), 5u);
+
+    for (const std::size_t depth : std::vector<std::size_t>{2, 3, 4}) {
+        relocalization_t relocalization(map, parameter(depth));
+        const cslibs_ndt::matching::Result<pose_t> result = relocalization.relocalize(src, pose_t(), match_param);
+        const relocalization_t::candidate_array_t &candidates = relocalization.getCandidates();
+        ASSERT_EQ(candidates.size(), expected.size());
+        for (std::size_t i = 0 ; i < candidates.size() ; ++i)
+            EXPECT_EQ(candidates[i].score, expected[i].score);
+
+        EXPECT_NE(result.termination(), cslibs_ndt::matching::Termination::NONE);
+        EXPECT_NEAR(result.transform().tx(),  transform.tx(),  0.02);
+        EXPECT_NEAR(result.transform().ty(),  transform.ty(),  0.02);
+        EXPECT_NEAR(result.transform().tz(),  transform.tz(),  0.02);
+        EXPECT_NEAR(result.transform().yaw(), transform.yaw(), 0.01);
+    }
+
+    /// nothing to relocalize
+    const pointcloud_t::Ptr empty(new pointcloud_t);
+    const cslibs_ndt::matching::Result<pose_t> result = brute_force.relocalize(empty, transform, match_param);
+    EXPECT_EQ(result.termination(), cslibs_ndt::matching::Termination::NONE);
+    EXPECT_TRUE(brute_force.getCandidates().empty());
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
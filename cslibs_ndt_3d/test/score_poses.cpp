@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt/matching/score_poses.hpp>
+
+#include <cslibs_ndt_3d/dynamic_maps/gridmap.hpp>
+#include <cslibs_ndt_3d/dynamic_maps/occupancy_gridmap.hpp>
+#include <cslibs_math_3d/linear/pointcloud.hpp>
+
+#include <random>
+
+using point_t      = cslibs_math_3d::Point3d;
+using pointcloud_t = cslibs_math_3d::Pointcloud3d;
+using pose_t       = cslibs_math_3d::Transform3d;
+using poses_t      = std::vector<pose_t, Eigen::aligned_allocator<pose_t>>;
+
+namespace {
+pointcloud_t::Ptr generateCloud(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> u(0.0, 4.0);
+    std::normal_distribution<double>       noise(0.0, 0.05);
+
+    pointcloud_t::Ptr cloud(new pointcloud_t);
+    for (std::size_t i = 0 ; i < 1000 ; ++i) {
+        cloud->insert(point_t(u(rng), u(rng), noise(rng)));
+        cloud->insert(point_t(u(rng), noise(rng), u(rng)));
+    }
+    return cloud;
+}
+
+/// a number of poses which is no multiple of the block size, scattered over the map
+poses_t generatePoses(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> t(-1.0, 1.0);
+    std::uniform_real_distribution<double> r(-0.2, 0.2);
+
+    poses_t poses;
+    for (std::size_t i = 0 ; i < 37 ; ++i)
+        poses.emplace_back(pose_t(t(rng), t(rng), t(rng), r(rng), r(rng), r(rng)));
+    return poses;
+}
+
+/**
+ * @brief Every score has to be the sum of the point samples under its pose.
+ */
+template<typename sample_t>
+void compare(const std::vector<double> &scores,
+             const pointcloud_t::Ptr &points,
+             const poses_t &poses,
+             const sample_t &sample)
+{
+    ASSERT_EQ(scores.size(), poses.size());
+    for (std::size_t k = 0 ; k < poses.size() ; ++k) {
+        double expected = 0.0;
+        for (const point_t &p : *points)
+            expected += sample(poses[k] * p);
+        EXPECT_GT(expected, 0.0);
+        EXPECT_NEAR(scores[k], expected, 1e-9 * expected);
+    }
+}
+}
+
+TEST(Test_cslibs_ndt_3d, testScorePoses)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::Gridmap;
+
+    std::mt19937 rng(1);
+    const pointcloud_t::Ptr cloud = generateCloud(rng);
+    map_t map(pose_t(), 1.0);
+    for (const point_t &p : *cloud)
+        map.insert(p);
+
+    const poses_t poses = generatePoses(rng);
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    for (const cslibs_ndt::common::Kernel kernel : {cslibs_ndt::common::Kernel::EXACT,
+                                                     cslibs_ndt::common::Kernel::APPROXIMATE}) {
+        const std::vector<double> scores = cslibs_ndt::matching::scorePoses(cloud->begin(), cloud->end(),
+                                                                            poses, map, pool, kernel);
+        compare(scores, cloud, poses, [&map, kernel](const point_t &p) {
+            return map.sampleNonNormalized(p, kernel);
+        });
+    }
+
+    /// nothing to score
+    EXPECT_TRUE(cslibs_ndt::matching::scorePoses(cloud->begin(), cloud->end(), poses_t(), map, pool).empty());
+    const std::vector<double> empty = cslibs_ndt::matching::scorePoses(cloud->end(), cloud->end(), poses, map, pool);
+    ASSERT_EQ(empty.size(), poses.size());
+    for (const double s : empty)
+        EXPECT_EQ(s, 0.0);
+}
+
+TEST(Test_cslibs_ndt_3d, testScorePosesOccupancy)
+{
+    using map_t = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+
+    std::mt19937 rng(2);
+    const pointcloud_t::Ptr cloud = generateCloud(rng);
+    /// the sensor sees the planes from above
+    const pose_t sensor(2.0, 2.0, 2.0);
+    std::vector<point_t> local;
+    for (const point_t &p : *cloud)
+        local.emplace_back(sensor.inverse() * p);
+    map_t map(pose_t(), 1.0);
+    map.insert(local.begin(), local.end(), sensor);
+
+    const cslibs_gridmaps::utility::InverseModel::Ptr inverse_model(
+                new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    const poses_t poses = generatePoses(rng);
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    const std::vector<double> scores = cslibs_ndt::matching::scorePoses(cloud->begin(), cloud->end(),
+                                                                        poses, map, inverse_model, pool);
+    compare(scores, cloud, poses, [&map, &inverse_model](const point_t &p) {
+        return map.sampleNonNormalized(p, inverse_model);
+    });
+
+    EXPECT_THROW(cslibs_ndt::matching::scorePoses(cloud->begin(), cloud->end(), poses, map,
+                                                  cslibs_gridmaps::utility::InverseModel::Ptr(), pool),
+                 std::runtime_error);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
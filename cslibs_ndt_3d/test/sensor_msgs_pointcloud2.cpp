@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/conversion/sensor_msgs_pointcloud2.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+using point_t        = cslibs_math_3d::Point3d;
+using pose_t         = cslibs_math_3d::Transform3d;
+using gridmap_t      = cslibs_ndt_3d::dynamic_maps::Gridmap;
+using occupancy_t    = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+using statistics_t   = cslibs_math::statistics::Distribution<3, 3>;
+
+const double THRESHOLD = 0.169;
+
+namespace {
+/// a floor and a wall in world coordinates
+std::vector<point_t> generatePoints()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> u(0.0, 3.0);
+    std::normal_distribution<double>       noise(0.0, 0.03);
+
+    std::vector<point_t> points;
+    for (std::size_t i = 0 ; i < 2000 ; ++i) {
+        points.emplace_back(u(rng), u(rng), noise(rng));
+        points.emplace_back(u(rng), 3.0 + noise(rng), u(rng));
+    }
+    return points;
+}
+
+struct Point
+{
+    gridmap_t::index_t bi;
+    float              values[4];
+
+    inline bool operator < (const Point &other) const
+    {
+        return bi < other.bi;
+    }
+};
+
+/// the message written by the conversion before the two passes, points ordered by bundle
+void serialize(std::vector<Point> &points,
+               sensor_msgs::PointCloud2 &dst)
+{
+    std::sort(points.begin(), points.end());
+    std::vector<float> tmp;
+    for (const Point &p : points)
+        tmp.insert(tmp.end(), p.values, p.values + 4);
+    cslibs_ndt_3d::conversion::from(tmp, dst);
+}
+
+/// allocate the partially allocated bundles, then traverse them
+void reference(gridmap_t &src,
+               sensor_msgs::PointCloud2 &dst)
+{
+    src.allocatePartiallyAllocatedBundles();
+
+    std::vector<Point> points;
+    src.traverse([&points](const gridmap_t::index_t &bi, const gridmap_t::distribution_bundle_t &b) {
+        statistics_t d;
+        for (std::size_t i = 0 ; i < 8 ; ++i)
+            d += b.at(i)->data();
+        if (d.getN() == 0)
+            return;
+
+        const point_t mean(d.getMean());
+        double intensity = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++i)
+            intensity += b.at(i)->data().sampleNonNormalized(mean);
+
+        points.emplace_back(Point{bi, {static_cast<float>(mean(0)),
+                                       static_cast<float>(mean(1)),
+                                       static_cast<float>(mean(2)),
+                                       static_cast<float>(0.125 * intensity)}});
+    });
+    serialize(points, dst);
+}
+
+void reference(occupancy_t &src,
+               sensor_msgs::PointCloud2 &dst,
+               const cslibs_gridmaps::utility::InverseModel::Ptr &ivm)
+{
+    src.allocatePartiallyAllocatedBundles();
+
+    std::vector<Point> points;
+    src.traverse([&points, &ivm](const occupancy_t::index_t &bi, const occupancy_t::distribution_bundle_t &b) {
+        statistics_t d;
+        double occupancy = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++i) {
+            occupancy += 0.125 * b.at(i)->getOccupancy(ivm);
+            if (const auto &d_tmp = b.at(i)->getDistribution())
+                d += *d_tmp;
+        }
+        if (d.getN() == 0 || occupancy < THRESHOLD)
+            return;
+
+        const point_t mean(d.getMean());
+        double intensity = 0.0;
+        for (std::size_t i = 0 ; i < 8 ; ++i) {
+            if (const auto &d_tmp = b.at(i)->getDistribution())
+                intensity += d_tmp->sampleNonNormalized(mean) * b.at(i)->getOccupancy(ivm);
+        }
+
+        points.emplace_back(Point{bi, {static_cast<float>(mean(0)),
+                                       static_cast<float>(mean(1)),
+                                       static_cast<float>(mean(2)),
+                                       static_cast<float>(0.125 * intensity)}});
+    });
+    serialize(points, dst);
+}
+
+/// the same points and layout, the field counts are 1 now
+void compare(const sensor_msgs::PointCloud2 &msg,
+             const sensor_msgs::PointCloud2 &expected)
+{
+    EXPECT_EQ(msg.height,       expected.height);
+    EXPECT_EQ(msg.width,        expected.width);
+    EXPECT_EQ(msg.point_step,   expected.point_step);
+    EXPECT_EQ(msg.row_step,     expected.row_step);
+    EXPECT_EQ(msg.is_dense,     expected.is_dense);
+    EXPECT_EQ(msg.is_bigendian, expected.is_bigendian);
+
+    ASSERT_EQ(msg.fields.size(), expected.fields.size());
+    for (std::size_t i = 0 ; i < msg.fields.size() ; ++i) {
+        EXPECT_EQ(msg.fields[i].name,     expected.fields[i].name);
+        EXPECT_EQ(msg.fields[i].offset,   expected.fields[i].offset);
+        EXPECT_EQ(msg.fields[i].datatype, expected.fields[i].datatype);
+        EXPECT_EQ(msg.fields[i].count,    1u);
+    }
+
+    ASSERT_EQ(msg.data.size(), expected.data.size());
+    EXPECT_EQ(std::memcmp(msg.data.data(), expected.data.data(), msg.data.size()), 0);
+}
+}
+
+TEST(Test_cslibs_ndt_3d, testPointCloud2Gridmap)
+{
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    const std::vector<point_t> points = generatePoints();
+    gridmap_t::Ptr map(new gridmap_t(pose_t(), 1.0));
+    map->insert(points.begin(), points.end());
+
+    std::vector<gridmap_t::index_t> before;
+    map->getBundleIndices(before);
+
+    sensor_msgs::PointCloud2 msg;
+    cslibs_ndt_3d::conversion::from(map, msg, cslibs_ndt_3d::conversion::PointCloud2Fields(), pool);
+    EXPECT_GT(msg.width, 0u);
+
+    /// the map is not changed
+    std::vector<gridmap_t::index_t> after;
+    map->getBundleIndices(after);
+    EXPECT_EQ(after.size(), before.size());
+
+    sensor_msgs::PointCloud2 expected;
+    reference(*map, expected);
+    std::vector<gridmap_t::index_t> allocated;
+    map->getBundleIndices(allocated);
+    EXPECT_GT(allocated.size(), before.size());
+    compare(msg, expected);
+
+    /// an empty map
+    gridmap_t empty(pose_t(), 1.0);
+    sensor_msgs::PointCloud2 empty_msg;
+    cslibs_ndt_3d::conversion::from(empty, empty_msg);
+    EXPECT_EQ(empty_msg.width, 0u);
+    EXPECT_EQ(empty_msg.row_step, 0u);
+    EXPECT_TRUE(empty_msg.data.empty());
+    EXPECT_EQ(empty_msg.fields.size(), 4u);
+}
+
+TEST(Test_cslibs_ndt_3d, testPointCloud2OccupancyGridmap)
+{
+    const cslibs_gridmaps::utility::InverseModel::Ptr inverse_model(
+                new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+
+    const pose_t sensor(1.5, 1.5, 1.0);
+    const pose_t s_T_w = sensor.inverse();
+    std::vector<point_t> points = generatePoints();
+    for (point_t &p : points)
+        p = s_T_w * p;
+
+    occupancy_t::Ptr map(new occupancy_t(pose_t(), 1.0));
+    map->insert(points.begin(), points.end(), sensor);
+
+    std::vector<occupancy_t::index_t> before;
+    map->getBundleIndices(before);
+
+    sensor_msgs::PointCloud2 msg;
+    cslibs_ndt_3d::conversion::from(map, msg, inverse_model, THRESHOLD,
+                                    cslibs_ndt_3d::conversion::PointCloud2Fields(), pool);
+    EXPECT_GT(msg.width, 0u);
+
+    std::vector<occupancy_t::index_t> after;
+    map->getBundleIndices(after);
+    EXPECT_EQ(after.size(), before.size());
+
+    sensor_msgs::PointCloud2 expected;
+    reference(*map, expected, inverse_model);
+    compare(msg, expected);
+
+    /// the optional fields follow the ones of the previous output
+    cslibs_ndt_3d::conversion::PointCloud2Fields fields;
+    fields.covariance = true;
+    fields.occupancy  = true;
+    fields.n          = true;
+    sensor_msgs::PointCloud2 extended;
+    cslibs_ndt_3d::conversion::from(map, extended, inverse_model, THRESHOLD, fields, pool);
+    ASSERT_EQ(extended.width, expected.width);
+    ASSERT_EQ(extended.point_step, 4 * sizeof(float) + 7 * sizeof(float) + sizeof(uint32_t));
+    for (std::size_t i = 0 ; i < extended.width ; ++i) {
+        EXPECT_EQ(std::memcmp(&extended.data[i * extended.point_step],
+                              &expected.data[i * expected.point_step],
+                              expected.point_step), 0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
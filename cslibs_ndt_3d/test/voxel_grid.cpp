@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <cslibs_ndt_3d/conversion/voxel_grid.hpp>
+
+#include <cmath>
+#include <random>
+#include <set>
+
+using point_t   = cslibs_math_3d::Point3d;
+using pose_t    = cslibs_math_3d::Transform3d;
+using map_t     = cslibs_ndt_3d::dynamic_maps::OccupancyGridmap;
+using voxels_t  = cslibs_ndt_3d::conversion::VoxelGrid;
+
+const double SAMPLING_RESOLUTION = 0.125;
+const double THRESHOLD           = 0.169;
+
+namespace {
+/// a floor and a wall seen from above the floor
+map_t::Ptr generateMap()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> u(0.0, 3.0);
+    std::normal_distribution<double>       noise(0.0, 0.03);
+
+    const pose_t sensor(1.5, 1.5, 1.0);
+    const pose_t s_T_w = sensor.inverse();
+    std::vector<point_t> points;
+    for (std::size_t i = 0 ; i < 2000 ; ++i) {
+        points.emplace_back(s_T_w * point_t(u(rng), u(rng), noise(rng)));
+        points.emplace_back(s_T_w * point_t(u(rng), 3.0 + noise(rng), u(rng)));
+    }
+
+    map_t::Ptr map(new map_t(pose_t(), 1.0));
+    map->insert(points.begin(), points.end(), sensor);
+    return map;
+}
+}
+
+TEST(Test_cslibs_ndt_3d, testVoxelRasterization)
+{
+    const cslibs_gridmaps::utility::InverseModel::Ptr inverse_model(
+                new cslibs_gridmaps::utility::InverseModel(0.5, 0.45, 0.65));
+    const cslibs_ndt::common::ThreadPool::Ptr pool(new cslibs_ndt::common::ThreadPool(3));
+    const map_t::Ptr map = generateMap();
+
+    voxels_t::Ptr voxels;
+    cslibs_ndt_3d::conversion::from(map, voxels, inverse_model, SAMPLING_RESOLUTION, THRESHOLD,
+                                    cslibs_ndt::common::Kernel::EXACT, pool);
+    ASSERT_TRUE(voxels);
+
+    std::vector<map_t::index_t> allocated;
+    map->getBundleIndices(allocated);
+    const std::set<map_t::index_t> bundles(allocated.begin(), allocated.end());
+
+    /// within allocated bundles every voxel is the map sampled at its center
+    const int steps = static_cast<int>(std::lround(map->getBundleResolution() / SAMPLING_RESOLUTION));
+    std::size_t occupied = 0;
+    for (const map_t::index_t &bi : allocated) {
+        for (int z = bi[2] * steps ; z < (bi[2] + 1) * steps ; ++z) {
+            for (int y = bi[1] * steps ; y < (bi[1] + 1) * steps ; ++y) {
+                for (int x = bi[0] * steps ; x < (bi[0] + 1) * steps ; ++x) {
+                    const voxels_t::index_t vi{{x, y, z}};
+                    const double expected = map->sampleNonNormalized(voxels->getCenter(vi), inverse_model);
+                    if (std::fabs(expected - THRESHOLD) < 1e-9)
+                        continue;
+
+                    EXPECT_EQ(voxels->isOccupied(vi), expected >= THRESHOLD);
+                    if (expected >= THRESHOLD) {
+                        EXPECT_NEAR(voxels->getOccupancy(vi), std::min(expected, 1.0), 0.5 / 255.0 + 1e-9);
+                        ++occupied;
+                    }
+                }
+            }
+        }
+    }
+    EXPECT_GT(occupied, 0u);
+
+    /// the voxels of the other bundles lie next to allocated ones
+    voxels->traverse([&bundles, steps](const voxels_t::index_t &vi, const double) {
+        const map_t::index_t bi{{static_cast<int>(std::floor(vi[0] / static_cast<double>(steps))),
+                                 static_cast<int>(std::floor(vi[1] / static_cast<double>(steps))),
+                                 static_cast<int>(std::floor(vi[2] / static_cast<double>(steps)))}};
+        bool neighbour = false;
+        for (int dx = -1 ; dx <= 1 ; ++dx) {
+            for (int dy = -1 ; dy <= 1 ; ++dy) {
+                for (int dz = -1 ; dz <= 1 ; ++dz)
+                    neighbour |= bundles.count(map_t::index_t{{bi[0] + dx, bi[1] + dy, bi[2] + dz}}) > 0;
+            }
+        }
+        EXPECT_TRUE(neighbour);
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}